@@ -0,0 +1,102 @@
+#include "AutomataArena.h"
+
+#include "MyProject.h"
+
+#if PLATFORM_LINUX
+#include <sys/mman.h>
+#elif PLATFORM_WINDOWS
+#include "Windows/AllowWindowsPlatformTypes.h"
+#include <windows.h>
+#include "Windows/HideWindowsPlatformTypes.h"
+#endif
+
+constexpr int64 FAutomataArena::PageSize;
+constexpr int64 FAutomataArena::Alignment;
+
+FAutomataArena::FAutomataArena(int64 InCapacity)
+{
+	Capacity = Align(FMath::Max<int64>(InCapacity, 1), PageSize);
+
+	// Pages are left untouched here, so whichever thread first writes a buffer decides where it lives.
+	// Explicit huge pages need a reserved pool, so transparent ones are asked for when that's empty
+#if PLATFORM_LINUX
+	void* Region = mmap(nullptr, Capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	bHugePages = Region != MAP_FAILED;
+
+	if (!bHugePages)
+	{
+		Region = mmap(nullptr, Capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		bHugePages = Region != MAP_FAILED && madvise(Region, Capacity, MADV_HUGEPAGE) == 0;
+	}
+	Base = Region != MAP_FAILED ? (uint8*)Region : nullptr;
+#elif PLATFORM_WINDOWS
+	// large pages need the lock pages privilege, which most accounts don't have
+	SIZE_T LargePage = GetLargePageMinimum();
+	if (LargePage > 0)
+	{
+		Base = (uint8*)VirtualAlloc(nullptr, Align(Capacity, int64(LargePage)), MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+		bHugePages = Base != nullptr;
+	}
+	if (Base == nullptr)
+	{
+		Base = (uint8*)VirtualAlloc(nullptr, Capacity, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	}
+#else
+	Base = (uint8*)FMemory::Malloc(Capacity, PageSize);
+#endif
+
+	if (Base == nullptr)
+	{
+		UE_LOG(LogAutomata, Fatal, TEXT("Could not reserve a %lld byte automata arena"), Capacity);
+	}
+
+	UE_LOG(LogAutomata, Verbose, TEXT("Automata arena of %lld bytes, %s"), Capacity, bHugePages ? TEXT("huge pages") : TEXT("regular pages"));
+}
+
+FAutomataArena::~FAutomataArena()
+{
+	Release();
+}
+
+FAutomataArena::FAutomataArena(FAutomataArena&& Other)
+{
+	*this = MoveTemp(Other);
+}
+
+FAutomataArena& FAutomataArena::operator=(FAutomataArena&& Other)
+{
+	if (this != &Other)
+	{
+		Release();
+
+		Base = Other.Base;
+		Capacity = Other.Capacity;
+		Used = Other.Used;
+		bHugePages = Other.bHugePages;
+
+		Other.Base = nullptr;
+		Other.Capacity = 0;
+		Other.Used = 0;
+	}
+	return *this;
+}
+
+void FAutomataArena::Release()
+{
+	if (Base == nullptr)
+	{
+		return;
+	}
+
+#if PLATFORM_LINUX
+	munmap(Base, Capacity);
+#elif PLATFORM_WINDOWS
+	VirtualFree(Base, 0, MEM_RELEASE);
+#else
+	FMemory::Free(Base);
+#endif
+
+	Base = nullptr;
+	Capacity = 0;
+	Used = 0;
+}
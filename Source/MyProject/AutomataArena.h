@@ -0,0 +1,58 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// One region holding a grid's fixed-size buffers, carved out front to back and released all at once.
+// The region is backed by 2MB pages where the OS allows it, so a whole grid's flags and neighbor lists
+// sit under a handful of TLB entries. Buffers are never freed or resized individually:
+// a layout change builds a new arena and drops the old one
+class FAutomataArena
+{
+public:
+
+	static constexpr int64 PageSize = 2 * 1024 * 1024;
+	static constexpr int64 Alignment = PLATFORM_CACHE_LINE_SIZE;
+
+	FAutomataArena() {}
+	explicit FAutomataArena(int64 Capacity);
+	~FAutomataArena();
+
+	FAutomataArena(FAutomataArena&& Other);
+	FAutomataArena& operator=(FAutomataArena&& Other);
+
+	FAutomataArena(const FAutomataArena&) = delete;
+	FAutomataArena& operator=(const FAutomataArena&) = delete;
+
+	// bytes an Allocate of Num elements uses up, for sizing the arena beforehand
+	template<typename T>
+	static int64 SizeFor(int Num)
+	{
+		return Align(int64(Num) * sizeof(T), Alignment);
+	}
+
+	// Uninitialized, and only for types that need no destructor
+	template<typename T>
+	TArrayView<T> Allocate(int Num)
+	{
+		static_assert(TIsTriviallyDestructible<T>::Value, "Arena buffers are never destructed");
+
+		int64 Bytes = SizeFor<T>(Num);
+		check(Used + Bytes <= Capacity);
+
+		T* Data = (T*)(Base + Used);
+		Used += Bytes;
+		return TArrayView<T>(Data, Num);
+	}
+
+	int64 GetCapacity() const { return Capacity; }
+	bool UsesHugePages() const { return bHugePages; }
+
+private:
+
+	uint8* Base = nullptr;
+	int64 Capacity = 0;
+	int64 Used = 0;
+	bool bHugePages = false;
+
+	void Release();
+};
@@ -0,0 +1,106 @@
+#include "AutomataBenchmarkCommandlet.h"
+
+#include "AutomataFactory.h"
+#include "AutomataNuma.h"
+#include "MyProject.h"
+#include "Rulesets.h"
+
+int32 UAutomataBenchmarkCommandlet::Main(const FString& Params)
+{
+	FBasicGrid Grid;
+	Grid.NumXCells = 4096;
+	Grid.NumZCells = 4096;
+	int32 NumSteps = 200;
+	int32 NumWarmup = 20;
+	FString ThreadList = TEXT("1,2,4,8,16");
+	FString BirthString = TEXT("3");
+	FString SurviveString = TEXT("23");
+	float Probability = 0.3;
+	int32 Seed = 1;
+	bool bBlockLookup = true;
+
+	FParse::Value(*Params, TEXT("X="), Grid.NumXCells);
+	FParse::Value(*Params, TEXT("Z="), Grid.NumZCells);
+	FParse::Value(*Params, TEXT("Steps="), NumSteps);
+	FParse::Value(*Params, TEXT("Warmup="), NumWarmup);
+	FParse::Value(*Params, TEXT("Threads="), ThreadList, false);
+	FParse::Value(*Params, TEXT("Birth="), BirthString);
+	FParse::Value(*Params, TEXT("Survive="), SurviveString);
+	FParse::Value(*Params, TEXT("Probability="), Probability);
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+	FParse::Bool(*Params, TEXT("Lookup="), bBlockLookup);
+
+	TArray<FString> ThreadCounts;
+	ThreadList.ParseIntoArray(ThreadCounts, TEXT(","));
+
+	TArray<TArray<int>> Neighborhoods;
+	FNeighborhoodMaker(&Grid).MakeNeighborhoods(Neighborhoods, RelativeMooreNeighborhood, BoundGridRuleset::Torus);
+
+	int64 NumCells = Neighborhoods.Num();
+	UE_LOG(LogAutomata, Display, TEXT("%dx%d torus, %d NUMA nodes, %d steps per run"), Grid.NumXCells, Grid.NumZCells, AutomataNuma::GetNodeCores().Num(), NumSteps);
+
+	// seconds for NumSteps steps, on NumThreads threads counting the one waiting on each step
+	auto TimeRun = [&](int NumThreads, bool bPinned, bool bPlaced)
+	{
+		ULifelikeRule* Rule = NewObject<ULifelikeRule>();
+		Rule->AddToRoot();
+
+		Rule->SetBaseMembers({ Neighborhoods, nullptr });
+		Rule->InitializeCellRules(BirthString, SurviveString);
+		if (bBlockLookup)
+		{
+			Rule->SetGrid(Grid, BoundGridRuleset::Torus);
+		}
+		Rule->SetWorkerThreads(NumThreads, bPinned, bPlaced);
+		Rule->InitializeCellStates(Probability, Seed);
+
+		for (int Step = 0; Step < NumWarmup; ++Step)
+		{
+			Rule->StartNewStep();
+			Rule->StepComplete();
+		}
+
+		double Start = FPlatformTime::Seconds();
+		for (int Step = 0; Step < NumSteps; ++Step)
+		{
+			Rule->StartNewStep();
+			Rule->StepComplete();
+		}
+		double Seconds = FPlatformTime::Seconds() - Start;
+
+		// frees the grid and the pool's threads before the next run allocates its own
+		Rule->RemoveFromRoot();
+		Rule->MarkPendingKill();
+		CollectGarbage(RF_NoFlags);
+
+		return Seconds;
+	};
+
+	// Every row's speedup is over one thread with every page touched by that thread, whatever the thread list holds.
+	// "serial" rows keep pages where the calling thread touched them, "any" rows let unpinned workers touch their own
+	// rows first, and "numa" rows pin those workers across nodes
+	double BaselineSeconds = TimeRun(1, false, false);
+
+	UE_LOG(LogAutomata, Display, TEXT("Threads  Placement  ms/step  Mcells/s  Speedup"));
+	UE_LOG(LogAutomata, Display, TEXT("%7d  %9s  %7.3f  %8.1f  %6.2fx"), 1, TEXT("baseline"), BaselineSeconds * 1000 / NumSteps, NumCells * NumSteps / BaselineSeconds / 1e6, 1.0);
+
+	for (const FString& Count : ThreadCounts)
+	{
+		int NumThreads = FCString::Atoi(*Count);
+
+		const TCHAR* Placements[] = { TEXT("serial"), TEXT("any"), TEXT("numa") };
+		for (int Placement = 0; Placement < 3; ++Placement)
+		{
+			double Seconds = TimeRun(NumThreads, Placement == 2, Placement > 0);
+
+			UE_LOG(LogAutomata, Display, TEXT("%7d  %9s  %7.3f  %8.1f  %6.2fx"),
+				NumThreads,
+				Placements[Placement],
+				Seconds * 1000 / NumSteps,
+				NumCells * NumSteps / Seconds / 1e6,
+				BaselineSeconds / Seconds);
+		}
+	}
+
+	return 0;
+}
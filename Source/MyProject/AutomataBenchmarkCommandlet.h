@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+#include "AutomataBenchmarkCommandlet.generated.h"
+
+// Times headless lifelike stepping across thread counts, each counting the thread that waits on the step.
+// Every count runs with pages touched by the calling thread alone, with unpinned workers touching their own rows,
+// and with workers pinned across NUMA nodes, all against a single threaded baseline.
+//   UE4Editor-Cmd MyProject -run=AutomataBenchmark -X=8192 -Z=8192 -Steps=200 -Threads=1,2,4,8,16,32
+// On a multi-socket machine the pinned rows should keep scaling once the workers spill past the first node,
+// where serially placed pages all sit on the calling thread's socket.
+// -Lookup=false steps every cell through its neighborhood instead of the 2x2 block lookup, for comparison.
+// Other options: -Warmup= -Birth= -Survive= -Probability= -Seed=
+UCLASS()
+class UAutomataBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	int32 Main(const FString& Params) override;
+};
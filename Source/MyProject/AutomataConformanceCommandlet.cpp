@@ -0,0 +1,872 @@
+#include "AutomataConformanceCommandlet.h"
+
+#include "AutomataEnsemble.h"
+#include "AutomataFactory.h"
+#include "AutomataRandom.h"
+#include "HenselNotation.h"
+#include "MyProject.h"
+#include "OutOfCoreLife.h"
+#include "Rulesets.h"
+#include "SparseLife.h"
+#include "StatePacking.h"
+
+namespace
+{
+	struct FConformanceCase
+	{
+		FBasicGrid Grid;
+		BoundGridRuleset GridRule = BoundGridRuleset::Torus;
+		FString BirthString = TEXT("3");
+		FString SurviveString = TEXT("23");
+		float Probability = 0.4;
+		int32 Seed = 1;
+
+		// ants run on the grid instead of a lifelike rule
+		bool bAnts = false;
+		int NumAnts = 1;
+		TArray<int> AntSequence = { 1, 3 };
+
+		bool IsIsotropic() const
+		{
+			return AutomataHensel::IsNonTotalistic(BirthString) || AutomataHensel::IsNonTotalistic(SurviveString);
+		}
+
+		// the options that rerun this case alone
+		FString Describe() const
+		{
+			FString Description = FString::Printf(TEXT("-X=%d -Z=%d -Shape=%s -Rule=%s -Seed=%d"),
+				Grid.NumXCells,
+				Grid.NumZCells,
+				*StaticEnum<CellShape>()->GetNameStringByValue(int64(Grid.Shape)),
+				*StaticEnum<BoundGridRuleset>()->GetNameStringByValue(int64(GridRule)),
+				Seed);
+
+			if (bAnts)
+			{
+				TArray<FString> Turns;
+				for (int Turn : AntSequence)
+				{
+					Turns.Add(FString::FromInt(Turn));
+				}
+				return Description + FString::Printf(TEXT(" -Ants -NumAnts=%d -Sequence=%s"), NumAnts, *FString::Join(Turns, TEXT(",")));
+			}
+			return Description + FString::Printf(TEXT(" -Birth=%s -Survive=%s -Probability=%g"), *BirthString, *SurviveString, Probability);
+		}
+	};
+
+	// Zobrist hash over every nonzero cell and its state, so any single difference changes it
+	uint64 HashStates(const TArray<int>& States)
+	{
+		uint64 Hash = AutomataRandom::Mix(States.Num());
+		for (int CellID = 0; CellID < States.Num(); ++CellID)
+		{
+			if (States[CellID] != 0)
+			{
+				Hash ^= AutomataRandom::Hash(uint64(States[CellID]), AutomataRandom::StateHashKeys, CellID);
+			}
+		}
+		return Hash;
+	}
+
+	// the same draw as ULifelikeRule::InitializeCellStates
+	TArray<int> InitialStates(const FConformanceCase& Case)
+	{
+		int NumCells = Case.Grid.NumXCells * Case.Grid.NumZCells;
+
+		TArray<uint64> Words;
+		TArray<int> States;
+		AutomataRandom::FillBernoulli(uint32(Case.Seed), AutomataRandom::CellStates, Case.Probability, NumCells, Words);
+		AutomataPacking::UnpackStates(Words.GetData(), NumCells, 1, States);
+		return States;
+	}
+
+	TArray<TArray<int>> MakeNeighborhoods(const FConformanceCase& Case)
+	{
+		FBasicGrid Grid = Case.Grid;
+
+		TArray<FIntPoint> Relative = Case.bAnts ? RelativeCardinalNeighborhood :
+									 Grid.Shape == CellShape::Hex ? RelativeAxialNeighborhood :
+									 RelativeMooreNeighborhood;
+
+		TArray<TArray<int>> Neighborhoods;
+		FNeighborhoodMaker(&Grid).MakeNeighborhoods(Neighborhoods, Relative, Case.GridRule);
+		return Neighborhoods;
+	}
+
+	class FEngine
+	{
+	public:
+
+		virtual ~FEngine() {}
+
+		virtual void Step() = 0;
+
+		// states laid out as the case's grid
+		virtual void ReadStates(TArray<int>& OutStates) = 0;
+
+		// false once the engine can no longer be expected to match the reference from these states on
+		virtual bool IsComparable(const TArray<int>& ReferenceStates) const { return true; }
+	};
+
+	// The definition every lifelike engine is held to: neighborhoods straight from FNeighborhoodMaker, counted one cell at a time.
+	// Non-totalistic rules read each cell's 3x3 window through the edge rule instead
+	class FReferenceEngine : public FEngine
+	{
+	public:
+
+		explicit FReferenceEngine(const FConformanceCase& InCase)
+			: Case(InCase)
+			, Maker(&Case.Grid)
+		{
+			Neighborhoods = MakeNeighborhoods(Case);
+			Maker.SetRule(Case.GridRule);
+
+			BirthRules = AutomataFuncs::StringToRule(Case.BirthString);
+			SurviveRules = AutomataFuncs::StringToRule(Case.SurviveString);
+
+			TArray<bool> BirthArrangements;
+			TArray<bool> SurviveArrangements;
+			AutomataHensel::ParseRule(Case.BirthString, BirthArrangements);
+			AutomataHensel::ParseRule(Case.SurviveString, SurviveArrangements);
+			Transitions = AutomataHensel::MakeTransitions(BirthArrangements, SurviveArrangements);
+
+			States = InitialStates(Case);
+		}
+
+		void Step() override
+		{
+			TArray<int> Next;
+			Next.SetNumUninitialized(States.Num());
+
+			for (int CellID = 0; CellID < States.Num(); ++CellID)
+			{
+				if (Case.IsIsotropic())
+				{
+					Next[CellID] = Transitions[GetWindow(CellID)];
+					continue;
+				}
+
+				int AliveNeighbors = 0;
+				for (int Neighbor : Neighborhoods[CellID])
+				{
+					AliveNeighbors += States[Neighbor];
+				}
+				Next[CellID] = States[CellID] ? SurviveRules[AliveNeighbors] : BirthRules[AliveNeighbors];
+			}
+
+			States = MoveTemp(Next);
+		}
+
+		void ReadStates(TArray<int>& OutStates) override
+		{
+			OutStates = States;
+		}
+
+	private:
+
+		FConformanceCase Case;
+		FNeighborhoodMaker Maker;
+		TArray<TArray<int>> Neighborhoods;
+
+		TArray<bool> BirthRules;
+		TArray<bool> SurviveRules;
+		TArray<bool> Transitions;
+
+		TArray<int> States;
+
+		int GetWindow(int CellID)
+		{
+			int x = CellID % Case.Grid.NumXCells;
+			int z = CellID / Case.Grid.NumXCells;
+
+			int Window = 0;
+			for (int Bit = 0; Bit < 9; ++Bit)
+			{
+				FIntPoint Coord(x + Bit % 3 - 1, z + Bit / 3 - 1);
+				if (Maker.MapCoord(Coord))
+				{
+					Window |= States[Case.Grid.CoordToCellID(Coord)] << Bit;
+				}
+			}
+			return Window;
+		}
+	};
+
+	// ULifelikeRule on its worker pool, either counting every cell through its neighborhood or through the block lookup
+	class FLifelikeEngine : public FEngine
+	{
+	public:
+
+		FLifelikeEngine(const FConformanceCase& Case, int NumThreads, bool bBlockLookup)
+		{
+			Rule = NewObject<ULifelikeRule>();
+			Rule->AddToRoot();
+
+			Rule->SetBaseMembers({ MakeNeighborhoods(Case), nullptr });
+			Rule->InitializeCellRules(Case.BirthString, Case.SurviveString);
+			if (bBlockLookup)
+			{
+				Rule->SetGrid(Case.Grid, Case.GridRule);
+			}
+			Rule->SetWorkerThreads(NumThreads, false);
+			Rule->InitializeCellStates(Case.Probability, Case.Seed);
+		}
+
+		~FLifelikeEngine()
+		{
+			Rule->RemoveFromRoot();
+			Rule->MarkPendingKill();
+		}
+
+		void Step() override
+		{
+			Rule->StartNewStep();
+			Rule->StepComplete();
+		}
+
+		void ReadStates(TArray<int>& OutStates) override
+		{
+			OutStates = Rule->GetBaseMembers()->CurrentStates;
+		}
+
+	private:
+
+		ULifelikeRule* Rule = nullptr;
+	};
+
+	// FOutOfCoreLife on planes in a scratch directory, in bands of a third of the grid so band edges get crossed
+	class FOutOfCoreEngine : public FEngine
+	{
+	public:
+
+		explicit FOutOfCoreEngine(const FConformanceCase& Case)
+		{
+			FOutOfCoreConfig Config;
+			Config.Grid = Case.Grid;
+			Config.GridRule = Case.GridRule;
+			Config.BirthString = Case.BirthString;
+			Config.SurviveString = Case.SurviveString;
+			Config.Directory = Directory = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Conformance"));
+			Config.BandRows = FMath::Max(1, Case.Grid.NumZCells / 3);
+			Config.ResidentBands = 1;
+
+			NumXCells = Case.Grid.NumXCells;
+			NumZCells = Case.Grid.NumZCells;
+
+			Life = MakeUnique<FOutOfCoreLife>(Config);
+			if (!Life->Open(true))
+			{
+				UE_LOG(LogAutomata, Error, TEXT("Couldn't create out of core planes in %s"), *Directory);
+			}
+			Life->InitializeCellStates(Case.Probability, Case.Seed);
+		}
+
+		~FOutOfCoreEngine()
+		{
+			Life.Reset();
+			IFileManager::Get().DeleteDirectory(*Directory, false, true);
+		}
+
+		void Step() override
+		{
+			Life->Step();
+		}
+
+		void ReadStates(TArray<int>& OutStates) override
+		{
+			Life->ReadWindow(FIntPoint(0, 0), NumXCells, NumZCells, OutStates);
+		}
+
+	private:
+
+		TUniquePtr<FOutOfCoreLife> Life;
+		FString Directory;
+		int NumXCells = 0;
+		int NumZCells = 0;
+	};
+
+	// FSparseLife seeded with the grid at an origin straddling chunk boundaries.
+	// Matches a finite grid until a cell on its edge comes alive, after which the plane may grow past it
+	class FSparseEngine : public FEngine
+	{
+	public:
+
+		explicit FSparseEngine(const FConformanceCase& Case)
+		{
+			NumXCells = Case.Grid.NumXCells;
+			NumZCells = Case.Grid.NumZCells;
+
+			Life.SetRules(AutomataFuncs::StringToRule(Case.BirthString), AutomataFuncs::StringToRule(Case.SurviveString));
+			Life.WriteWindow(Origin, NumXCells, NumZCells, InitialStates(Case));
+		}
+
+		void Step() override
+		{
+			Life.Step();
+		}
+
+		void ReadStates(TArray<int>& OutStates) override
+		{
+			Life.ReadWindow(Origin, NumXCells, NumZCells, OutStates);
+		}
+
+		bool IsComparable(const TArray<int>& ReferenceStates) const override
+		{
+			for (int z = 0; z < NumZCells; ++z)
+			{
+				bool bEdgeRow = z == 0 || z == NumZCells - 1;
+				for (int x = 0; x < NumXCells; x += bEdgeRow ? 1 : NumXCells - 1)
+				{
+					if (ReferenceStates[z * NumXCells + x])
+					{
+						return false;
+					}
+				}
+			}
+			return true;
+		}
+
+	private:
+
+		const FIntPoint Origin = FIntPoint(-FSparseLife::ChunkSize / 2 - 5, FSparseLife::ChunkSize - 7);
+
+		FSparseLife Life;
+		int NumXCells = 0;
+		int NumZCells = 0;
+	};
+
+	// FAutomataEnsemble with the case in one lane of a batch, among other runs with their own rules and seeds.
+	// Its lane is picked by its seed, and the others die out or settle at different times and get moved aside,
+	// so a lane leaking into another or lost when the batch compacts shows up as a mismatch
+	class FEnsembleEngine : public FEngine
+	{
+	public:
+
+		explicit FEnsembleEngine(const FConformanceCase& Case)
+			: Ensemble(Case.Grid.NumXCells, Case.Grid.NumZCells, Case.Grid.Shape)
+		{
+			static const TCHAR* const OtherRules[][2] = {
+				{ TEXT("3"), TEXT("23") },
+				{ TEXT("36"), TEXT("23") },
+				{ TEXT("2"), TEXT("") },
+				{ TEXT("3"), TEXT("012345678") },
+				{ TEXT("1"), TEXT("1") },
+				{ TEXT("378"), TEXT("235678") },
+			};
+
+			FRandomStream Stream(Case.Seed);
+			int NumRuns = Stream.RandRange(2, FAutomataEnsemble::BatchWidth);
+			int CaseLane = Stream.RandRange(0, NumRuns - 1);
+
+			// runs sharing an edge rule fill a batch in the order they're added
+			for (int Lane = 0; Lane < NumRuns; ++Lane)
+			{
+				FEnsembleRunConfig Config;
+				Config.GridRule = Case.GridRule;
+
+				if (Lane == CaseLane)
+				{
+					Config.BirthString = Case.BirthString;
+					Config.SurviveString = Case.SurviveString;
+					Config.Probability = Case.Probability;
+					Config.Seed = Case.Seed;
+					CaseRun = Ensemble.AddRun(Config);
+					continue;
+				}
+
+				int RuleID = Stream.RandRange(0, UE_ARRAY_COUNT(OtherRules) - 1);
+				Config.BirthString = OtherRules[RuleID][0];
+				Config.SurviveString = OtherRules[RuleID][1];
+				Config.Probability = Stream.FRandRange(0.05f, 0.6f);
+				Config.Seed = int32(Stream.GetUnsignedInt());
+				Ensemble.AddRun(Config);
+			}
+
+			Ensemble.Start();
+		}
+
+		void Step() override
+		{
+			Ensemble.Step();
+		}
+
+		void ReadStates(TArray<int>& OutStates) override
+		{
+			Ensemble.ReadStates(CaseRun, OutStates);
+		}
+
+		// a finished lane is no longer stepped
+		bool IsComparable(const TArray<int>& ReferenceStates) const override
+		{
+			return !Ensemble.IsFinished(CaseRun);
+		}
+
+	private:
+
+		FAutomataEnsemble Ensemble;
+		int CaseRun = 0;
+	};
+
+	// UAntRule, either reading neighbors from its table or computing them inline from the ant's coordinate
+	class FAntEngine : public FEngine
+	{
+	public:
+
+		FAntEngine(const FConformanceCase& Case, bool bInline)
+		{
+			Rule = NewObject<UAntRule>();
+			Rule->AddToRoot();
+
+			Rule->SetBaseMembers({ MakeNeighborhoods(Case), nullptr });
+			if (bInline)
+			{
+				Rule->SetGrid(Case.Grid, Case.GridRule);
+			}
+			Rule->InitializeAnts(Case.NumAnts, Case.Seed);
+			Rule->InitializeSequence(Case.AntSequence);
+		}
+
+		~FAntEngine()
+		{
+			Rule->RemoveFromRoot();
+			Rule->MarkPendingKill();
+		}
+
+		void Step() override
+		{
+			Rule->StartNewStep();
+			Rule->StepComplete();
+		}
+
+		void ReadStates(TArray<int>& OutStates) override
+		{
+			OutStates = Rule->GetBaseMembers()->CurrentStates;
+		}
+
+	private:
+
+		UAntRule* Rule = nullptr;
+	};
+
+	struct FEngineSpec
+	{
+		FString Name;
+		int NumThreads = 0;
+
+		FString Describe() const
+		{
+			return NumThreads > 0 ? FString::Printf(TEXT("%s on %d threads"), *Name, NumThreads) : Name;
+		}
+
+		bool Supports(const FConformanceCase& Case) const
+		{
+			bool bSquare = Case.Grid.Shape == CellShape::Square;
+
+			if (Name == TEXT("ants"))
+			{
+				// the inline path is what's under test, and it only exists on square tori
+				return Case.bAnts && bSquare && Case.GridRule == BoundGridRuleset::Torus;
+			}
+			if (Case.bAnts)
+			{
+				return false;
+			}
+			if (Name == TEXT("cells"))
+			{
+				return !Case.IsIsotropic();
+			}
+			if (Name == TEXT("lookup"))
+			{
+				return true;
+			}
+			if (Name == TEXT("outofcore"))
+			{
+				return bSquare && !Case.IsIsotropic();
+			}
+			if (Name == TEXT("ensemble"))
+			{
+				return !Case.IsIsotropic();
+			}
+			if (Name == TEXT("sparse"))
+			{
+				return bSquare && !Case.IsIsotropic() && Case.GridRule == BoundGridRuleset::Finite && !AutomataFuncs::StringToRule(Case.BirthString)[0];
+			}
+			return false;
+		}
+
+		TUniquePtr<FEngine> Make(const FConformanceCase& Case) const
+		{
+			if (Name == TEXT("cells") || Name == TEXT("lookup"))
+			{
+				return MakeUnique<FLifelikeEngine>(Case, NumThreads, Name == TEXT("lookup"));
+			}
+			if (Name == TEXT("outofcore"))
+			{
+				return MakeUnique<FOutOfCoreEngine>(Case);
+			}
+			if (Name == TEXT("sparse"))
+			{
+				return MakeUnique<FSparseEngine>(Case);
+			}
+			if (Name == TEXT("ensemble"))
+			{
+				return MakeUnique<FEnsembleEngine>(Case);
+			}
+			return MakeUnique<FAntEngine>(Case, true);
+		}
+	};
+
+	TUniquePtr<FEngine> MakeReference(const FConformanceCase& Case)
+	{
+		if (Case.bAnts)
+		{
+			return MakeUnique<FAntEngine>(Case, false);
+		}
+		return MakeUnique<FReferenceEngine>(Case);
+	}
+
+	// One window per letter, drawn from the published Hensel notation table rather than derived from ParseRule's own,
+	// since the reference reads isotropic rules through the same tables as the engines under test.
+	// Rows run top to bottom, with 'o' for a live neighbor and the center left empty
+	struct FKnownWindow
+	{
+		const TCHAR* Rule;
+		const TCHAR* Picture;
+	};
+
+	const FKnownWindow KnownWindows[] =
+	{
+		{ TEXT("1c"), TEXT("o.." "..." "...") },
+		{ TEXT("1e"), TEXT(".o." "..." "...") },
+		{ TEXT("2a"), TEXT("oo." "..." "...") },
+		{ TEXT("2c"), TEXT("o.o" "..." "...") },
+		{ TEXT("2e"), TEXT(".o." "o.." "...") },
+		{ TEXT("2i"), TEXT("..." "o.o" "...") },
+		{ TEXT("2k"), TEXT("o.." "..o" "...") },
+		{ TEXT("2n"), TEXT("..o" "..." "o..") },
+		{ TEXT("3a"), TEXT("oo." "o.." "...") },
+		{ TEXT("3c"), TEXT("o.o" "..." "o..") },
+		{ TEXT("3e"), TEXT(".o." "o.o" "...") },
+		{ TEXT("3i"), TEXT("ooo" "..." "...") },
+		{ TEXT("4c"), TEXT("o.o" "..." "o.o") },
+		{ TEXT("4e"), TEXT(".o." "o.o" ".o.") },
+		{ TEXT("5c"), TEXT(".o." "o.o" ".oo") },
+	};
+
+	int KnownWindow(const FKnownWindow& Known)
+	{
+		int Window = 0;
+		for (int Bit = 0; Bit < 9; ++Bit)
+		{
+			Window |= int(Known.Picture[Bit] == TEXT('o')) << Bit;
+		}
+		return Window;
+	}
+
+	// Number of known letters whose parsed arrangements don't take their own window, or do take another's.
+	// Every window is checked both as a birth and, with the center set, as a survival
+	int CheckKnownWindows()
+	{
+		int NumFailed = 0;
+		for (const FKnownWindow& Known : KnownWindows)
+		{
+			TArray<bool> Arrangements;
+			bool bParsed = AutomataHensel::ParseRule(Known.Rule, Arrangements);
+
+			TArray<bool> None;
+			None.Init(false, 256);
+			TArray<bool> Births = AutomataHensel::MakeTransitions(Arrangements, None);
+			TArray<bool> Survivals = AutomataHensel::MakeTransitions(None, Arrangements);
+
+			for (const FKnownWindow& Other : KnownWindows)
+			{
+				int Window = KnownWindow(Other);
+				bool bExpected = FCString::Strcmp(Known.Rule, Other.Rule) == 0;
+
+				if (!bParsed || Births[Window] != bExpected || Survivals[Window | (1 << AutomataHensel::CenterBit)] != bExpected)
+				{
+					UE_LOG(LogAutomata, Error, TEXT("%s %s the published window of %s"), Known.Rule, bExpected ? TEXT("misses") : TEXT("takes"), Other.Rule);
+					++NumFailed;
+					break;
+				}
+			}
+		}
+		return NumFailed;
+	}
+
+	// first step on which the engine's states differ from the reference's, or INDEX_NONE if they agree throughout
+	int FindMismatch(const FConformanceCase& Case, const FEngineSpec& Spec, int NumSteps)
+	{
+		TUniquePtr<FEngine> Reference = MakeReference(Case);
+		TUniquePtr<FEngine> Engine = Spec.Make(Case);
+
+		TArray<int> Expected;
+		TArray<int> Actual;
+		for (int Step = 0; ; ++Step)
+		{
+			Reference->ReadStates(Expected);
+			Engine->ReadStates(Actual);
+			if (HashStates(Expected) != HashStates(Actual))
+			{
+				return Step;
+			}
+
+			if (Step == NumSteps || !Engine->IsComparable(Expected))
+			{
+				return INDEX_NONE;
+			}
+
+			Reference->Step();
+			Engine->Step();
+		}
+	}
+
+	// Shrinks a failing case to the smallest grid that still fails, halving each axis first and then trimming single rows and columns.
+	// The sphere only wraps square grids, so both axes shrink together there
+	FConformanceCase Minimize(FConformanceCase Case, const FEngineSpec& Spec, int NumSteps, int MinCells, int& InOutStep)
+	{
+		bool bShrunk = true;
+		while (bShrunk)
+		{
+			bShrunk = false;
+
+			int X = Case.Grid.NumXCells;
+			int Z = Case.Grid.NumZCells;
+
+			TArray<FIntPoint> Sizes;
+			if (Case.GridRule == BoundGridRuleset::Sphere)
+			{
+				Sizes = { { X / 2, Z / 2 }, { X - 1, Z - 1 } };
+			}
+			else
+			{
+				Sizes = { { X / 2, Z }, { X, Z / 2 }, { X - 1, Z }, { X, Z - 1 } };
+			}
+
+			for (FIntPoint Size : Sizes)
+			{
+				if (Size.X < MinCells || Size.Y < MinCells)
+				{
+					continue;
+				}
+
+				FConformanceCase Smaller = Case;
+				Smaller.Grid.NumXCells = Size.X;
+				Smaller.Grid.NumZCells = Size.Y;
+
+				int Step = FindMismatch(Smaller, Spec, NumSteps);
+				CollectGarbage(RF_NoFlags);
+
+				if (Step != INDEX_NONE)
+				{
+					Case = Smaller;
+					InOutStep = Step;
+					bShrunk = true;
+					break;
+				}
+			}
+		}
+		return Case;
+	}
+
+	FString RandomRule(FRandomStream& Stream, int FirstCount, bool bIsotropic)
+	{
+		FString Rule;
+		for (int Count = FirstCount; Count <= 8; ++Count)
+		{
+			if (Stream.FRand() >= 0.3f)
+			{
+				continue;
+			}
+
+			Rule.AppendInt(Count);
+
+			// some counts keep or drop a random subset of their letters
+			FString Letters = AutomataHensel::LettersFor(Count);
+			if (bIsotropic && !Letters.IsEmpty() && Stream.FRand() < 0.5f)
+			{
+				FString Picked;
+				for (TCHAR Letter : Letters)
+				{
+					if (Stream.FRand() < 0.4f)
+					{
+						Picked.AppendChar(Letter);
+					}
+				}
+				if (Picked.IsEmpty())
+				{
+					Picked.AppendChar(Letters[Stream.RandHelper(Letters.Len())]);
+				}
+				Rule += (Stream.FRand() < 0.5f ? TEXT("-") : TEXT("")) + Picked;
+			}
+		}
+		return Rule;
+	}
+
+	FConformanceCase RandomCase(FRandomStream& Stream, bool bAnts, int MinCells, int MaxCells)
+	{
+		FConformanceCase Case;
+		Case.bAnts = bAnts;
+		Case.Seed = int32(Stream.GetUnsignedInt());
+		Case.Grid.NumXCells = Stream.RandRange(MinCells, MaxCells);
+		Case.Grid.NumZCells = Stream.RandRange(MinCells, MaxCells);
+
+		if (bAnts)
+		{
+			Case.NumAnts = Stream.RandRange(1, 8);
+			Case.AntSequence.Reset();
+			for (int Color = Stream.RandRange(2, 5); Color > 0; --Color)
+			{
+				Case.AntSequence.Add(Stream.FRand() < 0.5f ? 1 : 3);
+			}
+			return Case;
+		}
+
+		Case.Grid.Shape = Stream.FRand() < 0.25f ? CellShape::Hex : CellShape::Square;
+		Case.GridRule = BoundGridRuleset(Stream.RandRange(0, int(BoundGridRuleset::Sphere)));
+		if (Case.GridRule == BoundGridRuleset::Sphere)
+		{
+			Case.Grid.NumZCells = Case.Grid.NumXCells;
+		}
+
+		// Hensel letters only hold where the block lookup runs: square Moore grids whose edge rule
+		// maps every neighbor to a different cell, which the sphere's corners don't
+		bool bIsotropic = Case.Grid.Shape == CellShape::Square && Case.GridRule != BoundGridRuleset::Sphere && Stream.FRand() < 0.3f;
+
+		Case.BirthString = RandomRule(Stream, 1, bIsotropic);
+		Case.SurviveString = RandomRule(Stream, 0, bIsotropic);
+		Case.Probability = 0.2f + 0.5f * Stream.FRand();
+		return Case;
+	}
+
+	// a single case from the command line, for rerunning one that failed
+	bool ParseCase(const FString& Params, FConformanceCase& OutCase)
+	{
+		if (!FParse::Value(*Params, TEXT("X="), OutCase.Grid.NumXCells))
+		{
+			return false;
+		}
+
+		OutCase.Grid.NumZCells = OutCase.Grid.NumXCells;
+		FParse::Value(*Params, TEXT("Z="), OutCase.Grid.NumZCells);
+		FParse::Value(*Params, TEXT("Birth="), OutCase.BirthString);
+		FParse::Value(*Params, TEXT("Survive="), OutCase.SurviveString);
+		FParse::Value(*Params, TEXT("Probability="), OutCase.Probability);
+		FParse::Value(*Params, TEXT("Seed="), OutCase.Seed);
+		FParse::Value(*Params, TEXT("NumAnts="), OutCase.NumAnts);
+		OutCase.bAnts = FParse::Param(*Params, TEXT("Ants"));
+
+		FString Name;
+		if (FParse::Value(*Params, TEXT("Shape="), Name))
+		{
+			int64 Value = StaticEnum<CellShape>()->GetValueByNameString(Name);
+			OutCase.Grid.Shape = Value != INDEX_NONE ? CellShape(Value) : OutCase.Grid.Shape;
+		}
+		if (FParse::Value(*Params, TEXT("Rule="), Name))
+		{
+			int64 Value = StaticEnum<BoundGridRuleset>()->GetValueByNameString(Name);
+			OutCase.GridRule = Value != INDEX_NONE ? BoundGridRuleset(Value) : OutCase.GridRule;
+		}
+
+		FString Sequence;
+		if (FParse::Value(*Params, TEXT("Sequence="), Sequence, false))
+		{
+			TArray<FString> Turns;
+			Sequence.ParseIntoArray(Turns, TEXT(","));
+			OutCase.AntSequence.Reset();
+			for (const FString& Turn : Turns)
+			{
+				OutCase.AntSequence.Add(FCString::Atoi(*Turn));
+			}
+		}
+		return true;
+	}
+}
+
+int32 UAutomataConformanceCommandlet::Main(const FString& Params)
+{
+	int32 NumCases = 100;
+	int32 NumSteps = 64;
+	int32 Seed = 1;
+	int32 MinCells = 4;
+	int32 MaxCells = 40;
+	FString EngineList = TEXT("cells,lookup,outofcore,sparse,ensemble,ants");
+	FString ThreadList = TEXT("1,2,4");
+
+	FParse::Value(*Params, TEXT("Cases="), NumCases);
+	FParse::Value(*Params, TEXT("Steps="), NumSteps);
+	FParse::Value(*Params, TEXT("MinCells="), MinCells);
+	FParse::Value(*Params, TEXT("MaxCells="), MaxCells);
+	FParse::Value(*Params, TEXT("Engines="), EngineList, false);
+	FParse::Value(*Params, TEXT("Threads="), ThreadList, false);
+
+	TArray<FString> EngineNames;
+	TArray<FString> ThreadCounts;
+	EngineList.ParseIntoArray(EngineNames, TEXT(","));
+	ThreadList.ParseIntoArray(ThreadCounts, TEXT(","));
+
+	// the engines on the worker pool are run at every thread count, since a task split is where they'd go wrong
+	TArray<FEngineSpec> Specs;
+	for (const FString& Name : EngineNames)
+	{
+		if (Name == TEXT("cells") || Name == TEXT("lookup"))
+		{
+			for (const FString& Count : ThreadCounts)
+			{
+				Specs.Add({ Name, FCString::Atoi(*Count) });
+			}
+		}
+		else
+		{
+			Specs.Add({ Name, 0 });
+		}
+	}
+
+	FConformanceCase Single;
+	bool bSingle = ParseCase(Params, Single);
+	if (bSingle)
+	{
+		NumCases = 1;
+	}
+	else
+	{
+		// without a case, -Seed= picks the sequence of random ones
+		FParse::Value(*Params, TEXT("Seed="), Seed);
+	}
+
+	bool bAnyAnts = EngineNames.Contains(TEXT("ants"));
+	FRandomStream Stream(Seed);
+
+	int NumFailed = CheckKnownWindows();
+	int NumRuns = 0;
+	for (int CaseIndex = 0; CaseIndex < NumCases; ++CaseIndex)
+	{
+		FConformanceCase Case = bSingle ? Single : RandomCase(Stream, bAnyAnts && Stream.FRand() < 0.2f, MinCells, MaxCells);
+
+		for (const FEngineSpec& Spec : Specs)
+		{
+			if (!Spec.Supports(Case))
+			{
+				continue;
+			}
+
+			++NumRuns;
+			int Step = FindMismatch(Case, Spec, NumSteps);
+			CollectGarbage(RF_NoFlags);
+
+			if (Step == INDEX_NONE)
+			{
+				continue;
+			}
+
+			++NumFailed;
+			UE_LOG(LogAutomata, Error, TEXT("%s differs from the reference at step %d: %s"), *Spec.Describe(), Step, *Case.Describe());
+
+			FConformanceCase Smallest = Minimize(Case, Spec, NumSteps, Case.bAnts ? 3 : MinCells, Step);
+			UE_LOG(LogAutomata, Error, TEXT("  smallest failing grid differs at step %d: %s -Engines=%s"), Step, *Smallest.Describe(), *Spec.Name);
+		}
+	}
+
+	UE_LOG(LogAutomata, Display, TEXT("%d cases, %d engine runs of up to %d steps, %d failed"), NumCases, NumRuns, NumSteps, NumFailed);
+	return NumFailed;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+#include "AutomataConformanceCommandlet.generated.h"
+
+// Differential test of every stepping engine against a plain reference built from FNeighborhoodMaker.
+//   UE4Editor-Cmd MyProject -run=AutomataConformance -Cases=200 -Steps=64 -Threads=1,2,4
+// Each case draws a grid size, shape, edge rule, rule string (Hensel letters included) and seed, then steps
+// the reference and each engine side by side, comparing state hashes every step. A failing case is shrunk
+// to the smallest grid that still fails, and logged with the options that rerun just that case:
+//   -X= -Z= -Shape=Square|Hex -Rule=Torus|... -Birth= -Survive= -Probability= -Seed=, or -Ants -NumAnts= -Sequence=1,3
+// Before any case, a window per letter from the published Hensel table is checked against the rule parser, which the reference shares.
+// Engines are chosen with -Engines=cells,lookup,outofcore,sparse,ensemble,ants, and grid sizes with -MinCells= -MaxCells=.
+// Returns the number of failing engine runs
+UCLASS()
+class UAutomataConformanceCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	int32 Main(const FString& Params) override;
+};
@@ -37,6 +37,15 @@ void UAutomataDisplay::InitializeNiagaraSystem(USceneComponent* Root, FDisplayMe
 	NiagaraComponent->ActivateSystem();
 }
 
+void UAutomataDisplay::UpdateGrid(FDisplayMembers& DisplayParams, const FBasicGrid& Grid)
+{
+	NiagaraFuncs::SetNiagaraArrayVector(NiagaraComponent, "User.Transforms", Grid.CellTransforms);
+	NiagaraComponent->SetVariableMaterial(FName("User.Material"), MakeMaterial(DisplayParams, Grid));
+
+	// particles are spawned per transform, so the system restarts with the new count
+	NiagaraComponent->ReinitializeSystem();
+}
+
 void UAutomataDisplay::UpdateSwitchTimes(const TArray<float>& SwitchSteps)
 {
 	NiagaraFuncs::SetNiagaraArrayFloat(NiagaraComponent, "User.SwitchSteps", SwitchSteps);
@@ -37,6 +37,11 @@ struct FDisplayMembers
 	UPROPERTY(Blueprintable, EditAnywhere)
 		float StepsToFade = 1000;
 
+	// Automata steps run per displayed frame, each frame lasting StepPeriod times this.
+	// Switch steps are still uploaded once per frame, so cells that lived and died between frames show as just switched
+	UPROPERTY(Blueprintable, EditAnywhere)
+		int StepsPerFrame = 1;
+
 	TMap<FName, float> MatFloats();
 
 };
@@ -67,6 +72,9 @@ class UAutomataDisplay : public UObject
 	
 	void InitializeNiagaraSystem(USceneComponent* Root, FDisplayMembers& DisplayParams, const FBasicGrid& Grid);
 
+	// points the running system at a resized or reshaped grid, without spawning it again
+	void UpdateGrid(FDisplayMembers& DisplayParams, const FBasicGrid& Grid);
+
 	void UpdateSwitchTimes(const TArray<float> & SwitchSteps);
 	void UpdateEndFadeState(const TArray<int>& EndFadeStates);
 };
\ No newline at end of file
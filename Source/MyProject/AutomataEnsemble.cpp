@@ -0,0 +1,303 @@
+#include "AutomataEnsemble.h"
+
+#include "AutomataFactory.h"
+#include "AutomataRandom.h"
+#include "HenselNotation.h"
+#include "LifeLanes.h"
+#include "MyProject.h"
+#include "Rulesets.h"
+
+constexpr int FAutomataEnsemble::BatchWidth;
+
+FAutomataEnsemble::FAutomataEnsemble(int NumXCells, int NumZCells, CellShape Shape)
+{
+	Grid.NumXCells = NumXCells;
+	Grid.NumZCells = NumZCells;
+	Grid.Shape = Shape;
+	Grid.SetCoords();
+
+	// the same keys ULifelikeRule hashes its states with, drawn apart from the initial states
+	CellKeys.SetNumUninitialized(Grid.NumCells());
+	for (int CellID = 0; CellID < CellKeys.Num(); ++CellID)
+	{
+		CellKeys[CellID] = AutomataRandom::Hash(0, AutomataRandom::StateHashKeys, CellID);
+	}
+}
+
+int FAutomataEnsemble::AddRun(const FEnsembleRunConfig& Config)
+{
+	Stats.AddDefaulted();
+	return Configs.Add(Config);
+}
+
+const FAutomataEnsemble::FNeighborTable& FAutomataEnsemble::GetTable(BoundGridRuleset GridRule)
+{
+	if (const FNeighborTable* Existing = Tables.Find(GridRule))
+	{
+		return *Existing;
+	}
+
+	TArray<TArray<int>> Neighborhoods;
+	const TArray<FIntPoint>& Relative = Grid.Shape == CellShape::Hex ? RelativeAxialNeighborhood : RelativeMooreNeighborhood;
+	FNeighborhoodMaker(&Grid).MakeNeighborhoods(Neighborhoods, Relative, GridRule);
+
+	FNeighborTable& Table = Tables.Add(GridRule);
+	Table.Offsets.Reserve(Neighborhoods.Num() + 1);
+	Table.Offsets.Add(0);
+	for (const TArray<int>& Neighborhood : Neighborhoods)
+	{
+		Table.Indices.Append(Neighborhood);
+		Table.Offsets.Add(Table.Indices.Num());
+	}
+
+	return Table;
+}
+
+void FAutomataEnsemble::InitBatch(FBatch& Batch)
+{
+	int NumCells = Grid.NumCells();
+
+	Batch.States.SetNumZeroed(NumCells * BatchWidth);
+	Batch.NextStates.SetNumZeroed(NumCells * BatchWidth);
+	Batch.HashHistory.SetNum(Batch.RunIDs.Num());
+	Batch.NumActive = Batch.RunIDs.Num();
+
+	bool bFinished[BatchWidth] = {};
+	for (int Lane = 0; Lane < Batch.RunIDs.Num(); ++Lane)
+	{
+		const FEnsembleRunConfig& Config = Configs[Batch.RunIDs[Lane]];
+
+		if (AutomataHensel::IsNonTotalistic(Config.BirthString) || AutomataHensel::IsNonTotalistic(Config.SurviveString))
+		{
+			UE_LOG(LogAutomata, Warning, TEXT("Ensemble runs only step outer totalistic rules, so the letters in B%s/S%s are ignored"), *Config.BirthString, *Config.SurviveString);
+		}
+
+		Batch.BirthMasks[Lane] = uint16(LifeLanes::RuleMask(AutomataFuncs::StringToRule(Config.BirthString)));
+		Batch.SurviveMasks[Lane] = uint16(LifeLanes::RuleMask(AutomataFuncs::StringToRule(Config.SurviveString)));
+
+		// same draw as ULifelikeRule::InitializeCellStates, so a run can be reproduced on a displayed grid
+		TArray<uint64> Words;
+		AutomataRandom::FillBernoulli(uint32(Config.Seed), AutomataRandom::CellStates, Config.Probability, NumCells, Words);
+
+		uint64 Hash = 0;
+		int Population = 0;
+		for (int CellID = 0; CellID < NumCells; ++CellID)
+		{
+			uint8 Alive = (Words[CellID / 64] >> (CellID % 64)) & 1;
+			Batch.States[CellID * BatchWidth + Lane] = Alive;
+			Hash ^= Alive ? CellKeys[CellID] : 0;
+			Population += Alive;
+		}
+
+		FEnsembleRunStats& RunStats = Stats[Batch.RunIDs[Lane]];
+		RunStats.Population = Population;
+		if (Population == 0)
+		{
+			RunStats.ExtinctionStep = 0;
+			RunStats.Period = 1;
+			RunStats.CycleStartStep = 0;
+			bFinished[Lane] = true;
+		}
+		Batch.HashHistory[Lane].Add(Hash, 0);
+	}
+
+	RetireLanes(Batch, bFinished);
+}
+
+void FAutomataEnsemble::RetireLanes(FBatch& Batch, const bool* bFinished)
+{
+	int NumCells = Grid.NumCells();
+
+	// Going down from the top, the last running lane has always been checked already,
+	// so whatever is swapped down into a finished lane's place is still running
+	for (int Lane = Batch.NumActive - 1; Lane >= 0; --Lane)
+	{
+		if (!bFinished[Lane])
+		{
+			continue;
+		}
+
+		int Last = --Batch.NumActive;
+		for (int CellID = 0; CellID < NumCells; ++CellID)
+		{
+			uint8* Cell = Batch.States.GetData() + CellID * BatchWidth;
+			Swap(Cell[Lane], Cell[Last]);
+			Batch.NextStates[CellID * BatchWidth + Last] = Cell[Last];
+		}
+
+		Swap(Batch.RunIDs[Lane], Batch.RunIDs[Last]);
+		Swap(Batch.BirthMasks[Lane], Batch.BirthMasks[Last]);
+		Swap(Batch.SurviveMasks[Lane], Batch.SurviveMasks[Last]);
+		Swap(Batch.HashHistory[Lane], Batch.HashHistory[Last]);
+		Batch.HashHistory[Last].Empty();
+	}
+}
+
+bool FAutomataEnsemble::StepBatch(FBatch& Batch, const FNeighborTable& Table, int Step)
+{
+	int NumCells = Grid.NumCells();
+	int NumActive = Batch.NumActive;
+
+	if (NumActive == 0)
+	{
+		return false;
+	}
+
+	uint64 Hashes[BatchWidth] = {};
+	int32 Populations[BatchWidth] = {};
+
+	for (int CellID = 0; CellID < NumCells; ++CellID)
+	{
+		uint8 Counts[BatchWidth] = {};
+		for (int i = Table.Offsets[CellID]; i < Table.Offsets[CellID + 1]; ++i)
+		{
+			const uint8* Neighbor = Batch.States.GetData() + Table.Indices[i] * BatchWidth;
+			for (int Lane = 0; Lane < NumActive; ++Lane)
+			{
+				Counts[Lane] += Neighbor[Lane];
+			}
+		}
+
+		const uint8* Self = Batch.States.GetData() + CellID * BatchWidth;
+		uint8* Out = Batch.NextStates.GetData() + CellID * BatchWidth;
+		uint64 Key = CellKeys[CellID];
+
+		for (int Lane = 0; Lane < NumActive; ++Lane)
+		{
+			uint16 Mask = Self[Lane] ? Batch.SurviveMasks[Lane] : Batch.BirthMasks[Lane];
+			uint8 Alive = (Mask >> Counts[Lane]) & 1;
+			Out[Lane] = Alive;
+			Hashes[Lane] ^= Key & (0 - uint64(Alive));
+			Populations[Lane] += Alive;
+		}
+	}
+
+	Swap(Batch.States, Batch.NextStates);
+
+	bool bFinished[BatchWidth] = {};
+	for (int Lane = 0; Lane < NumActive; ++Lane)
+	{
+		FEnsembleRunStats& RunStats = Stats[Batch.RunIDs[Lane]];
+		RunStats.Population = Populations[Lane];
+		RunStats.StepsRun = Step;
+
+		if (Populations[Lane] == 0)
+		{
+			RunStats.ExtinctionStep = Step;
+			RunStats.Period = 1;
+			RunStats.CycleStartStep = Step;
+			bFinished[Lane] = true;
+		}
+		else if (const int* SeenStep = Batch.HashHistory[Lane].Find(Hashes[Lane]))
+		{
+			RunStats.Period = Step - *SeenStep;
+			RunStats.CycleStartStep = *SeenStep;
+			bFinished[Lane] = true;
+		}
+		else
+		{
+			Batch.HashHistory[Lane].Add(Hashes[Lane], Step);
+		}
+	}
+
+	RetireLanes(Batch, bFinished);
+	return Batch.NumActive > 0;
+}
+
+void FAutomataEnsemble::Start()
+{
+	Batches.Reset();
+	BatchTables.Reset();
+	RunBatches.SetNumUninitialized(Configs.Num());
+	StepsTaken = 0;
+
+	// group runs by topology, since a batch shares one neighbor table
+	TMap<BoundGridRuleset, int> OpenBatch;
+
+	for (int RunID = 0; RunID < Configs.Num(); ++RunID)
+	{
+		BoundGridRuleset GridRule = Configs[RunID].GridRule;
+		int* BatchID = OpenBatch.Find(GridRule);
+
+		if (BatchID == nullptr || Batches[*BatchID].RunIDs.Num() == BatchWidth)
+		{
+			FBatch& NewBatch = Batches.AddDefaulted_GetRef();
+			NewBatch.GridRule = GridRule;
+			BatchID = &OpenBatch.Add(GridRule, Batches.Num() - 1);
+		}
+
+		Batches[*BatchID].RunIDs.Add(RunID);
+		RunBatches[RunID] = *BatchID;
+	}
+
+	// tables are built up front, since GetTable isn't thread-safe,
+	// and only then looked up, since adding to the map can move earlier tables
+	for (FBatch& Batch : Batches)
+	{
+		GetTable(Batch.GridRule);
+	}
+
+	for (FBatch& Batch : Batches)
+	{
+		BatchTables.Add(&GetTable(Batch.GridRule));
+	}
+
+	ParallelFor(Batches.Num(), [&](int32 BatchID)
+	{
+		InitBatch(Batches[BatchID]);
+	});
+}
+
+bool FAutomataEnsemble::Step()
+{
+	int Step = ++StepsTaken;
+
+	TAtomic<bool> bAnyRunning(false);
+	ParallelFor(Batches.Num(), [&](int32 BatchID)
+	{
+		if (StepBatch(Batches[BatchID], *BatchTables[BatchID], Step))
+		{
+			bAnyRunning = true;
+		}
+	}, EParallelForFlags::Unbalanced);
+
+	return bAnyRunning;
+}
+
+void FAutomataEnsemble::Run(int MaxSteps)
+{
+	Start();
+
+	// Each batch runs all its steps as a single task. Runs finish at different times, so workers pull the next
+	// unstarted batch as they free up rather than being handed a fixed share.
+	ParallelFor(Batches.Num(), [&](int32 BatchID)
+	{
+		for (int Step = 1; Step <= MaxSteps; ++Step)
+		{
+			if (!StepBatch(Batches[BatchID], *BatchTables[BatchID], Step))
+			{
+				break;
+			}
+		}
+	}, EParallelForFlags::Unbalanced);
+
+	StepsTaken = MaxSteps;
+}
+
+bool FAutomataEnsemble::IsFinished(int RunID) const
+{
+	const FBatch& Batch = Batches[RunBatches[RunID]];
+	return Batch.RunIDs.Find(RunID) >= Batch.NumActive;
+}
+
+void FAutomataEnsemble::ReadStates(int RunID, TArray<int>& OutStates) const
+{
+	const FBatch& Batch = Batches[RunBatches[RunID]];
+	int Lane = Batch.RunIDs.Find(RunID);
+
+	OutStates.SetNumUninitialized(Grid.NumCells());
+	for (int CellID = 0; CellID < OutStates.Num(); ++CellID)
+	{
+		OutStates[CellID] = Batch.States[CellID * BatchWidth + Lane];
+	}
+}
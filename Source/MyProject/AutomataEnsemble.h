@@ -0,0 +1,126 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GridRules.h"
+
+// one parameter set of a sweep
+struct FEnsembleRunConfig
+{
+	FString BirthString = TEXT("3");
+	FString SurviveString = TEXT("23");
+	float Probability = 0.4;
+	BoundGridRuleset GridRule = BoundGridRuleset::Torus;
+	int32 Seed = 1;
+};
+
+struct FEnsembleRunStats
+{
+	int Population = 0;
+
+	// step on which every cell was dead, or -1
+	int ExtinctionStep = -1;
+
+	// period of the cycle the run settled into, or 0 if it never repeated. Still lifes have a period of 1
+	int Period = 0;
+
+	// first step of that cycle
+	int CycleStartStep = -1;
+
+	int StepsRun = 0;
+};
+
+// Steps many independent small lifelike grids at once, with no display.
+// Runs sharing a topology are grouped into batches of up to BatchWidth lanes.
+// A batch stores its states cell-major, every lane of a cell next to each other,
+// so the per-cell neighbor sum and rule lookup are unit-stride loops over lanes.
+// Batches are independent tasks, pulled by workers as they free up.
+// Lanes that finish are moved past the batch's running ones, so the lane loops stop covering them.
+// UAutomataEnsembleCommandlet runs a sweep and writes these stats out
+class FAutomataEnsemble
+{
+public:
+
+	static constexpr int BatchWidth = 64;
+
+	FAutomataEnsemble(int NumXCells, int NumZCells, CellShape Shape = CellShape::Square);
+
+	// returns the run's index into GetStats
+	int AddRun(const FEnsembleRunConfig& Config);
+
+	// steps every run until it dies out, settles into a cycle, or reaches MaxSteps
+	void Run(int MaxSteps);
+
+	// Groups the runs into batches and draws their initial states, to then be stepped one step at a time.
+	// Run does this itself
+	void Start();
+
+	// steps every unfinished run once, returning false once all have finished
+	bool Step();
+
+	bool IsFinished(int RunID) const;
+
+	// the run's states as of the step it finished on, or of the last step if it's still running
+	void ReadStates(int RunID, TArray<int>& OutStates) const;
+
+	const TArray<FEnsembleRunConfig>& GetConfigs() const { return Configs; }
+	const TArray<FEnsembleRunStats>& GetStats() const { return Stats; }
+
+private:
+
+	// neighborhoods flattened into one array, shared by every batch with the same topology
+	struct FNeighborTable
+	{
+		TArray<int> Offsets;
+		TArray<int> Indices;
+	};
+
+	struct FBatch
+	{
+		BoundGridRuleset GridRule;
+
+		// run in each lane. Lanes below NumActive are still running
+		TArray<int> RunIDs;
+		int NumActive = 0;
+
+		// Indexed by CellID * BatchWidth + Lane.
+		// A finished lane's column is the same in both, since stepping no longer writes it
+		TArray<uint8> States;
+		TArray<uint8> NextStates;
+
+		// per lane, bit n set if a cell with n live neighbors is born/survives
+		uint16 BirthMasks[BatchWidth] = {};
+		uint16 SurviveMasks[BatchWidth] = {};
+
+		// per lane, the step each state hash was first seen
+		TArray<TMap<uint64, int>> HashHistory;
+	};
+
+	FBasicGrid Grid;
+
+	TArray<FEnsembleRunConfig> Configs;
+	TArray<FEnsembleRunStats> Stats;
+
+	TMap<BoundGridRuleset, FNeighborTable> Tables;
+
+	TArray<FBatch> Batches;
+	TArray<const FNeighborTable*> BatchTables;
+
+	// batch each run was put in
+	TArray<int> RunBatches;
+
+	// steps taken by Step since Start
+	int StepsTaken = 0;
+
+	// Zobrist key of each cell, XORed into a lane's hash while the cell is alive
+	TArray<uint64> CellKeys;
+
+	const FNeighborTable& GetTable(BoundGridRuleset GridRule);
+
+	void InitBatch(FBatch& Batch);
+
+	// steps the batch's running lanes to Step, returning false once none are left running
+	bool StepBatch(FBatch& Batch, const FNeighborTable& Table, int Step);
+
+	// moves each lane flagged in bFinished past the running ones
+	void RetireLanes(FBatch& Batch, const bool* bFinished);
+};
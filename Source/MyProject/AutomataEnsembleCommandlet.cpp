@@ -0,0 +1,108 @@
+#include "AutomataEnsembleCommandlet.h"
+
+#include "Misc/FileHelper.h"
+
+#include "AutomataEnsemble.h"
+#include "MyProject.h"
+
+int32 UAutomataEnsembleCommandlet::Main(const FString& Params)
+{
+	int32 NumXCells = 64;
+	int32 NumZCells = 64;
+	CellShape Shape = CellShape::Square;
+	int32 NumSteps = 1000;
+	int32 NumSeeds = 10;
+	FString RuleList = TEXT("3/23");
+	FString ProbabilityList = TEXT("0.4");
+	FString EdgeList = TEXT("Torus");
+	FString OutputPath = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Ensemble.csv"));
+
+	FParse::Value(*Params, TEXT("X="), NumXCells);
+	FParse::Value(*Params, TEXT("Z="), NumZCells);
+	FParse::Value(*Params, TEXT("Steps="), NumSteps);
+	FParse::Value(*Params, TEXT("Seeds="), NumSeeds);
+	FParse::Value(*Params, TEXT("Rules="), RuleList, false);
+	FParse::Value(*Params, TEXT("Probabilities="), ProbabilityList, false);
+	FParse::Value(*Params, TEXT("Edges="), EdgeList, false);
+	FParse::Value(*Params, TEXT("Output="), OutputPath);
+
+	FString Name;
+	if (FParse::Value(*Params, TEXT("Shape="), Name))
+	{
+		int64 Value = StaticEnum<CellShape>()->GetValueByNameString(Name);
+		Shape = Value != INDEX_NONE ? CellShape(Value) : Shape;
+	}
+
+	TArray<FString> Rules;
+	TArray<FString> Probabilities;
+	TArray<FString> Edges;
+	RuleList.ParseIntoArray(Rules, TEXT(","));
+	ProbabilityList.ParseIntoArray(Probabilities, TEXT(","));
+	EdgeList.ParseIntoArray(Edges, TEXT(","));
+
+	FAutomataEnsemble Ensemble(NumXCells, NumZCells, Shape);
+
+	for (const FString& Rule : Rules)
+	{
+		FEnsembleRunConfig Config;
+		if (!Rule.Split(TEXT("/"), &Config.BirthString, &Config.SurviveString))
+		{
+			UE_LOG(LogAutomata, Error, TEXT("Rule %s is not of the form Birth/Survive"), *Rule);
+			return 1;
+		}
+
+		for (const FString& Edge : Edges)
+		{
+			int64 Value = StaticEnum<BoundGridRuleset>()->GetValueByNameString(Edge);
+			if (Value == INDEX_NONE)
+			{
+				UE_LOG(LogAutomata, Error, TEXT("%s is not an edge rule"), *Edge);
+				return 1;
+			}
+			Config.GridRule = BoundGridRuleset(Value);
+
+			for (const FString& Probability : Probabilities)
+			{
+				Config.Probability = FCString::Atof(*Probability);
+
+				for (int32 Seed = 1; Seed <= NumSeeds; ++Seed)
+				{
+					Config.Seed = Seed;
+					Ensemble.AddRun(Config);
+				}
+			}
+		}
+	}
+
+	double Start = FPlatformTime::Seconds();
+	Ensemble.Run(NumSteps);
+	double Seconds = FPlatformTime::Seconds() - Start;
+
+	FString Out = TEXT("Birth,Survive,Edge,Probability,Seed,Population,ExtinctionStep,Period,CycleStartStep,StepsRun\n");
+	for (int RunID = 0; RunID < Ensemble.GetConfigs().Num(); ++RunID)
+	{
+		const FEnsembleRunConfig& Config = Ensemble.GetConfigs()[RunID];
+		const FEnsembleRunStats& Stats = Ensemble.GetStats()[RunID];
+
+		Out += FString::Printf(TEXT("%s,%s,%s,%g,%d,%d,%d,%d,%d,%d\n"),
+			*Config.BirthString,
+			*Config.SurviveString,
+			*StaticEnum<BoundGridRuleset>()->GetNameStringByValue(int64(Config.GridRule)),
+			Config.Probability,
+			Config.Seed,
+			Stats.Population,
+			Stats.ExtinctionStep,
+			Stats.Period,
+			Stats.CycleStartStep,
+			Stats.StepsRun);
+	}
+
+	if (!FFileHelper::SaveStringToFile(Out, *OutputPath))
+	{
+		UE_LOG(LogAutomata, Error, TEXT("Couldn't write %s"), *OutputPath);
+		return 1;
+	}
+
+	UE_LOG(LogAutomata, Display, TEXT("%d runs of up to %d steps on %dx%d in %.2fs, written to %s"), Ensemble.GetConfigs().Num(), NumSteps, NumXCells, NumZCells, Seconds, *OutputPath);
+	return 0;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+#include "AutomataEnsembleCommandlet.generated.h"
+
+// Sweeps rules, densities, edge rules and seeds over many small headless grids, and writes how each run ended as CSV.
+//   UE4Editor-Cmd MyProject -run=AutomataEnsemble -X=64 -Z=64 -Rules=3/23,36/23 -Probabilities=0.2,0.4 -Seeds=100
+// Every combination is one run. Each row gives the run's final population, the step it died out on (-1 if it didn't),
+// and the period and first step of the cycle it settled into (0 and -1 if it never repeated within -Steps=).
+// Other options: -Shape=Square|Hex -Edges=Torus,Finite,... -Steps= -Output=
+UCLASS()
+class UAutomataEnsembleCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	int32 Main(const FString& Params) override;
+};
@@ -4,6 +4,9 @@
 #include "AutomataDisplay.h"
 #include "AutomataStepDriver.h"
 #include "AutomataInterface.h"
+#include "AutomataReplay.h"
+#include "PatternIO.h"
+#include "MyProject.h"
 
 // Sets default values
 AAutomataFactory::AAutomataFactory()
@@ -17,9 +20,29 @@ void AAutomataFactory::BeginPlay()
 {
 	Super::BeginPlay();
 
+	if (!RecordingPath.IsEmpty())
+	{
+		Driver->StartRecording(RecordingPath, KeyframeInterval);
+	}
+
+	if (!SharedExportName.IsEmpty())
+	{
+		Driver->StartSharedExport(SharedExportName, SharedExportSlots);
+	}
+
+	if (bTrackStatistics)
+	{
+		Driver->EnableStatistics(Grid.NumXCells, Grid.NumZCells);
+	}
+
+	if (bTrackFrameActivity)
+	{
+		Driver->EnableFrameAggregate();
+	}
+
 	AutomataInterfacePtr->BroadcastData();
 	AutomataInterfacePtr->StartNewStep();
-	Driver->SetTimer(DisplayParameters.StepPeriod);
+	Driver->SetTimer(DisplayParameters.StepPeriod, DisplayParameters.StepsPerFrame);
 }
 
 void AAutomataFactory::PreInitializeComponents()
@@ -48,7 +71,8 @@ TArray<FIntPoint> AAutomataFactory::GetRelativeNeighborhood()
 {
 	if (AutomataType == UAntRule::StaticClass())
 	{
-		return RelativeCardinalNeighborhood;
+		// ants turn by stepping through their neighborhood, so it has to be in rotational order
+		return Grid.Shape == CellShape::Hex ? RelativeAxialNeighborhood : RelativeCardinalNeighborhood;
 	}
 
 	switch (Grid.Shape)
@@ -64,6 +88,29 @@ TArray<FIntPoint> AAutomataFactory::GetRelativeNeighborhood()
 
 void AAutomataFactory::RuleCalcSetup()
 {
+	if (!ReplayPath.IsEmpty())
+	{
+		UAutomataReplay* Replay = NewObject<UAutomataReplay>(GetWorld());
+		if (Replay->OpenRecording(ReplayPath, Display))
+		{
+			Automata = Replay;
+			AutomataInterfacePtr = Replay;
+		}
+		return;
+	}
+
+	if (Seed == 0)
+	{
+		Seed = int32(FPlatformTime::Cycles() | 1);
+		UE_LOG(LogAutomata, Log, TEXT("%s initialized with seed %d"), *GetName(), Seed);
+	}
+
+	if (bUnbounded && AutomataType == ULifelikeRule::StaticClass())
+	{
+		UnboundedSetup();
+		return;
+	}
+
 	if (AutomataType != nullptr)
 	{
 		Automata = NewObject<UObject>(GetWorld(), AutomataType);
@@ -79,26 +126,227 @@ void AAutomataFactory::RuleCalcSetup()
 		TArray<TArray<int>> Neighborhoods;
 		FNeighborhoodMaker(&Grid).MakeNeighborhoods(Neighborhoods, GetRelativeNeighborhood(), SelectedGridRule);
 
-		AutomataInterfacePtr->SetBaseMembers({Neighborhoods, Display});
+		AutomataInterfacePtr->SetBaseMembers({MoveTemp(Neighborhoods), Display});
 	}
-	
+
 
 	ULifelikeRule* Lifelike = Cast<ULifelikeRule>(Automata);
 	if (Lifelike != nullptr)
 	{
 		Lifelike->InitializeCellRules(BirthString, SurviveString);
-		Lifelike->InitializeCellStates(Probability);
-		return;
+		Lifelike->SetGrid(Grid, SelectedGridRule);
+		Lifelike->SetCycleResponse(CycleResponse);
+		if (NumWorkerThreads != 0 || bPinWorkerThreads)
+		{
+			Lifelike->SetWorkerThreads(NumWorkerThreads, bPinWorkerThreads);
+		}
+		if (PatternPath.IsEmpty())
+		{
+			Lifelike->InitializeCellStates(Probability, Seed);
+		}
 	}
 
 	UAntRule* Ant = Cast<UAntRule>(Automata);
 	if (Ant != nullptr)
 	{
-		Ant->InitializeAnts(NumAnts);
-		Ant->InitializeSequence(CellSequence);
+		Ant->SetGrid(Grid, SelectedGridRule);
+		Ant->InitializeAnts(NumAnts, Seed);
+		if (TurmiteTable.Num() > 0)
+		{
+			Ant->InitializeTurmite(TurmiteTable);
+		}
+		else
+		{
+			Ant->InitializeSequence(CellSequence);
+		}
+	}
+
+	if (AutomataInterfacePtr != nullptr && !PatternPath.IsEmpty())
+	{
+		AutomataInterfacePtr->LoadPattern(PatternPath, Grid, PatternOffset);
+	}
+
+	if (AutomataInterfacePtr != nullptr && !SnapshotToRestore.IsEmpty())
+	{
+		AutomataInterfacePtr->LoadSnapshot(SnapshotToRestore);
+	}
+}
+
+void AAutomataFactory::UnboundedSetup()
+{
+	if (Grid.Shape != CellShape::Square)
+	{
+		UE_LOG(LogAutomata, Warning, TEXT("%s: unbounded automata only use square cells"), *GetName());
+	}
+
+	USparseLifeRule* Sparse = NewObject<USparseLifeRule>(GetWorld());
+	Automata = Sparse;
+	AutomataInterfacePtr = Sparse;
+
+	// the window's cells stand in for the grid, with no neighborhoods to build
+	Sparse->SetBaseMembers({ TArray<TArray<int>>(), Display });
+	Sparse->SetWindow(Grid, WindowOrigin);
+	Sparse->InitializeCellRules(BirthString, SurviveString);
+
+	if (PatternPath.IsEmpty())
+	{
+		Sparse->InitializeCellStates(Probability, Seed);
+	}
+	else
+	{
+		Sparse->LoadPattern(PatternPath, Grid, PatternOffset);
+	}
+}
+
+void AAutomataFactory::SetWindowOrigin(FIntPoint Origin)
+{
+	USparseLifeRule* Sparse = Cast<USparseLifeRule>(Automata);
+	if (Driver == nullptr || Sparse == nullptr)
+	{
+		return;
+	}
+
+	WindowOrigin = Origin;
+	Driver->RunBetweenSteps([Sparse, Origin]()
+	{
+		Sparse->SetWindowOrigin(Origin);
+	});
+}
+
+void AAutomataFactory::SaveSnapshot(FString Path, bool bCompress)
+{
+	if (Driver == nullptr || AutomataInterfacePtr == nullptr)
+	{
+		return;
+	}
+
+	IAutomata* Target = AutomataInterfacePtr;
+	Driver->RunBetweenSteps([Target, Path, bCompress]()
+	{
+		Target->SaveSnapshot(Path, bCompress);
+	});
+}
+
+void AAutomataFactory::SkipSteps(int Steps)
+{
+	ULifelikeRule* Lifelike = Cast<ULifelikeRule>(Automata);
+	if (Driver == nullptr || Lifelike == nullptr)
+	{
+		return;
+	}
+
+	Driver->RunBetweenSteps([Lifelike, Steps]()
+	{
+		Lifelike->AdvanceCycle(Steps);
+	});
+}
+
+void AAutomataFactory::Reconfigure(int NumXCells, int NumZCells, CellShape Shape, BoundGridRuleset Rule)
+{
+	if (Driver == nullptr || AutomataInterfacePtr == nullptr || NumXCells < 1 || NumZCells < 1)
+	{
 		return;
 	}
 
+	Driver->RunBetweenSteps([this, NumXCells, NumZCells, Shape, Rule]()
+	{
+		ApplyReconfigure(NumXCells, NumZCells, Shape, Rule);
+	});
+}
+
+void AAutomataFactory::ApplyReconfigure(int NumXCells, int NumZCells, CellShape Shape, BoundGridRuleset Rule)
+{
+	FGridChange Change;
+	Change.Grid = &Grid;
+	Change.OldNumXCells = Grid.NumXCells;
+	Change.OldNumZCells = Grid.NumZCells;
+	Change.OldShape = Grid.Shape;
+	Change.OldRule = SelectedGridRule;
+	Change.NewRule = Rule;
+
+	Grid.NumXCells = NumXCells;
+	Grid.NumZCells = NumZCells;
+	Grid.Shape = Shape;
+	SelectedGridRule = Rule;
+	Change.RelativeNeighborhood = GetRelativeNeighborhood();
+
+	if (Change.ChangesCells())
+	{
+		GridSetup();
+	}
+
+	if (!AutomataInterfacePtr->Reconfigure(Change))
+	{
+		// automata that can't adapt start over, as they would at startup
+		RuleCalcSetup();
+		Driver->SetAutomata(AutomataInterfacePtr);
+	}
+
+	if (Change.ChangesCells())
+	{
+		Display->UpdateGrid(DisplayParameters, Grid);
+
+		// recordings and exports are laid out for a fixed number of cells
+		Driver->StopRecording();
+		Driver->StopSharedExport();
+
+		if (bTrackStatistics)
+		{
+			Driver->EnableStatistics(Grid.NumXCells, Grid.NumZCells);
+		}
+	}
+}
+
+int AAutomataFactory::GetPopulation() const
+{
+	const FAutomataStatistics* Statistics = Driver != nullptr ? Driver->GetStatistics() : nullptr;
+	return Statistics != nullptr ? Statistics->GetPopulation() : 0;
+}
+
+int AAutomataFactory::GetStateCount(int State) const
+{
+	const FAutomataStatistics* Statistics = Driver != nullptr ? Driver->GetStatistics() : nullptr;
+	return Statistics != nullptr ? Statistics->GetStateCount(State) : 0;
+}
+
+bool AAutomataFactory::GetLiveBounds(FIntPoint& Min, FIntPoint& Max) const
+{
+	const FAutomataStatistics* Statistics = Driver != nullptr ? Driver->GetStatistics() : nullptr;
+	return Statistics != nullptr && Statistics->GetBoundingBox(Min, Max);
+}
+
+float AAutomataFactory::GetRegionDensity(FIntPoint MinTile, FIntPoint MaxTile) const
+{
+	const FAutomataStatistics* Statistics = Driver != nullptr ? Driver->GetStatistics() : nullptr;
+	return Statistics != nullptr ? Statistics->GetRegionDensity(MinTile, MaxTile) : 0;
+}
+
+TArray<float> AAutomataFactory::GetFrameActivity() const
+{
+	const FAutomataFrameAggregate* Aggregate = Driver != nullptr ? Driver->GetFrameAggregate() : nullptr;
+	return Aggregate != nullptr ? Aggregate->GetActivity() : TArray<float>();
+}
+
+TArray<float> AAutomataFactory::GetFrameMaxAges() const
+{
+	const FAutomataFrameAggregate* Aggregate = Driver != nullptr ? Driver->GetFrameAggregate() : nullptr;
+	return Aggregate != nullptr ? Aggregate->GetMaxAges() : TArray<float>();
+}
+
+void AAutomataFactory::ExportPattern(FString Path)
+{
+	if (Driver == nullptr || AutomataInterfacePtr == nullptr)
+	{
+		return;
+	}
+
+	IAutomata* Target = AutomataInterfacePtr;
+	FString Rule = Cast<ULifelikeRule>(Automata) != nullptr ? AutomataPatterns::MakeRuleString(BirthString, SurviveString) : FString();
+
+	Driver->RunBetweenSteps([this, Target, Path, Rule]()
+	{
+		AutomataPatterns::SavePattern(Path, Grid, Target->GetBaseMembers()->CurrentStates, Rule);
+	});
 }
 
 void AAutomataFactory::DisplaySetup()
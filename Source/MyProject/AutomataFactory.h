@@ -4,6 +4,7 @@
 #include "GameFramework/Actor.h"
 #include "GridRules.h"
 #include "AutomataDisplay.h"
+#include "Rulesets.h"
 #include "AutomataFactory.generated.h"
 
 class UNiagaraSystem;
@@ -57,6 +58,11 @@ protected:
 	void DisplaySetup();
 	void DriverSetup();
 
+	// RuleCalcSetup for a lifelike automata on the unbounded plane
+	void UnboundedSetup();
+
+	void ApplyReconfigure(int NumXCells, int NumZCells, CellShape Shape, BoundGridRuleset Rule);
+
 	UPROPERTY(Blueprintable, EditAnywhere, meta = (MustImplement = "Automata"))
 	UClass* AutomataType;
 
@@ -89,28 +95,147 @@ protected:
 	UPROPERTY(Blueprintable, EditAnywhere)
 		TArray<int> CellSequence = { 1,1,3,3 };
 
+	// If set, ants follow this turmite table instead of CellSequence
+	UPROPERTY(Blueprintable, EditAnywhere)
+		TArray<FTurmiteTransition> TurmiteTable;
+
 	// Probability when initializing that a cell will start off alive.
 	// Functionally ranges from 0 to 1.
 	UPROPERTY(Blueprintable, EditAnywhere)
 		float Probability = 0.4;
 
+	// Seed for the random initial cells and ants. The same seed always produces the same start.
+	// 0 draws a fresh seed, which is logged so the run can be reproduced
+	UPROPERTY(Blueprintable, EditAnywhere)
+		int32 Seed = 0;
+
 	// User-set string that defines the birth rules for the automata
-	// Capable of accepting non-digit characters, but they will be ignored
+	// Hensel letters after a count, e.g. "2n3" or "23-q", make the rule non-totalistic. Any other characters are ignored
 	UPROPERTY(Blueprintable, EditAnywhere)
 		FString BirthString = TEXT("3");
 
 	// User-set string that defines the survival rules for the automata
-	// Capable of accepting non-digit characters, but they will be ignored
+	// Hensel letters after a count, e.g. "2n3" or "23-q", make the rule non-totalistic. Any other characters are ignored
 	UPROPERTY(Blueprintable, EditAnywhere)
 		FString SurviveString = TEXT("23");
 
-	
+	// Threads stepping a lifelike automata, counting the one that waits on each step. 0 uses one per core
+	UPROPERTY(Blueprintable, EditAnywhere)
+		int NumWorkerThreads = 0;
 
+	// Whether each of those threads is pinned to its own core
+	UPROPERTY(Blueprintable, EditAnywhere)
+		bool bPinWorkerThreads = false;
 
+	// What a lifelike automata does once its board repeats an earlier state
+	UPROPERTY(Blueprintable, EditAnywhere)
+		ECycleResponse CycleResponse = ECycleResponse::Continue;
 
-	
+	// If set, the automata's state is restored from this snapshot after initialization
+	UPROPERTY(Blueprintable, EditAnywhere)
+		FString SnapshotToRestore;
+
+	// If set, cell states are loaded from this RLE (.rle), Macrocell (.mc) or plaintext pattern
+	// instead of being randomized
+	UPROPERTY(Blueprintable, EditAnywhere)
+		FString PatternPath;
+
+	// Grid coordinate of the top-left of the pattern's live area
+	UPROPERTY(Blueprintable, EditAnywhere)
+		FIntPoint PatternOffset = FIntPoint(0, 0);
+
+	// If set, every generation is recorded to this file
+	UPROPERTY(Blueprintable, EditAnywhere)
+		FString RecordingPath;
+
+	// Number of recorded frames between full keyframes. Bounds the cost of seeking a recording
+	UPROPERTY(Blueprintable, EditAnywhere)
+		int KeyframeInterval = 256;
+
+	// If set, every generation is published bit-packed to a shared memory region of this name,
+	// which other local processes can map with FSharedStateReader
+	UPROPERTY(Blueprintable, EditAnywhere)
+		FString SharedExportName;
+
+	// Generations kept in the shared ring. Readers have this many steps to finish a read
+	UPROPERTY(Blueprintable, EditAnywhere)
+		int SharedExportSlots = 4;
+
+	// If set, population and region counts are kept up to date each frame, see the Get functions below
+	UPROPERTY(Blueprintable, EditAnywhere)
+		bool bTrackStatistics = false;
+
+	// If set, each cell's births, deaths and lifespans over every step of a frame are kept, see GetFrameActivity.
+	// Only of use with more than one step per frame; otherwise switch steps already show every change
+	UPROPERTY(Blueprintable, EditAnywhere)
+		bool bTrackFrameActivity = false;
+
+	// If set, this recording is played back instead of running the automata
+	UPROPERTY(Blueprintable, EditAnywhere)
+		FString ReplayPath;
 
+	// Runs a lifelike automata on an unbounded plane, with the grid as a window onto it, instead of on the grid itself.
+	// Square Moore neighborhoods only; the edge rule is ignored
+	UPROPERTY(Blueprintable, EditAnywhere)
+		bool bUnbounded = false;
 
+	// plane coordinate of the window's first cell, when unbounded
+	UPROPERTY(Blueprintable, EditAnywhere)
+		FIntPoint WindowOrigin = FIntPoint(0, 0);
 
+	
 public:
+
+	// Saves the automata's full state once the step currently in flight completes.
+	// Encoding and writing happen asynchronously.
+	UFUNCTION(BlueprintCallable)
+	void SaveSnapshot(FString Path, bool bCompress = true);
+
+	// Writes the current cell states as a pattern once the step in flight completes.
+	// The format is chosen by extension: .rle, .mc, or plaintext for anything else
+	UFUNCTION(BlueprintCallable)
+	void ExportPattern(FString Path);
+
+	// Jumps a lifelike automata that has settled into a replayed cycle forward by Steps,
+	// without stepping through them
+	UFUNCTION(BlueprintCallable)
+	void SkipSteps(int Steps);
+
+	// Changes the grid's size, cell shape or edge rule once the step in flight completes, without rebuilding the actor.
+	// Cells keep their states where the old and new grids overlap. A change of edge rule alone leaves the display
+	// untouched and only rebuilds the neighborhoods along the edges
+	UFUNCTION(BlueprintCallable)
+	void Reconfigure(int NumXCells, int NumZCells, CellShape Shape, BoundGridRuleset Rule);
+
+	// Moves an unbounded automata's window across the plane once the step in flight completes
+	UFUNCTION(BlueprintCallable)
+	void SetWindowOrigin(FIntPoint Origin);
+
+	// The following read the statistics enabled by bTrackStatistics, and return 0 or false without them.
+	// All are O(1) apart from the bounding box, O(rows + columns), and region density, O(tiles)
+
+	// number of cells in a nonzero state
+	UFUNCTION(BlueprintPure)
+	int GetPopulation() const;
+
+	UFUNCTION(BlueprintPure)
+	int GetStateCount(int State) const;
+
+	// inclusive grid coordinates bounding every nonzero cell. False if there are none
+	UFUNCTION(BlueprintPure)
+	bool GetLiveBounds(FIntPoint& Min, FIntPoint& Max) const;
+
+	// fraction of nonzero cells over an inclusive range of tiles, each 32x32 cells
+	UFUNCTION(BlueprintPure)
+	float GetRegionDensity(FIntPoint MinTile, FIntPoint MaxTile) const;
+
+	// The following read the last frame's aggregate enabled by bTrackFrameActivity, indexed by cell, and are empty without it
+
+	// times each cell switched between zero and nonzero over the frame's steps
+	UFUNCTION(BlueprintPure)
+	TArray<float> GetFrameActivity() const;
+
+	// longest life, in steps, of those that ended during the frame. 0 for cells where none did
+	UFUNCTION(BlueprintPure)
+	TArray<float> GetFrameMaxAges() const;
 };
@@ -0,0 +1,65 @@
+#include "AutomataFrameAggregate.h"
+
+void FAutomataFrameAggregate::Reset(const TArray<int>& States, int Step)
+{
+	int NumCells = States.Num();
+
+	Activity.Init(0, NumCells);
+	MaxAges.Init(0, NumCells);
+	PublishedActivity.Init(0, NumCells);
+	PublishedMaxAges.Init(0, NumCells);
+	Alive.SetNumUninitialized(NumCells);
+	BirthSteps.Init(Step, NumCells);
+	Touched.Reset();
+	PublishedTouched.Reset();
+
+	for (int CellID = 0; CellID < NumCells; ++CellID)
+	{
+		Alive[CellID] = States[CellID] != 0;
+	}
+}
+
+void FAutomataFrameAggregate::PublishFrame()
+{
+	Swap(Activity, PublishedActivity);
+	Swap(MaxAges, PublishedMaxAges);
+	Swap(Touched, PublishedTouched);
+
+	// the buffers swapped in still hold the frame published before this one
+	for (int CellID : Touched)
+	{
+		Activity[CellID] = 0;
+		MaxAges[CellID] = 0;
+	}
+	Touched.Reset();
+}
+
+void FAutomataFrameAggregate::AddStep(const TArray<int>& States, TArrayView<const int> ChangedCells, int Step)
+{
+	check(States.Num() == Alive.Num());
+
+	for (int CellID : ChangedCells)
+	{
+		uint8 bAlive = States[CellID] != 0;
+		if (bAlive == Alive[CellID])
+		{
+			continue;
+		}
+		Alive[CellID] = bAlive;
+
+		if (Activity[CellID] == 0)
+		{
+			Touched.Add(CellID);
+		}
+		Activity[CellID] += 1;
+
+		if (bAlive)
+		{
+			BirthSteps[CellID] = Step;
+		}
+		else
+		{
+			MaxAges[CellID] = FMath::Max(MaxAges[CellID], float(Step - BirthSteps[CellID]));
+		}
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// What each cell did over the steps of one displayed frame, folded in a step at a time from the cells that changed.
+// When several steps run per frame, births and deaths that come and go between frames would otherwise be lost to anything reading once a frame.
+// Has no engine dependencies beyond Core, like FAutomataStatistics.
+class FAutomataFrameAggregate
+{
+public:
+
+	// starts over from States, with cells alive now counted as born on Step
+	void Reset(const TArray<int>& States, int Step);
+
+	// Makes the frame folded in so far the one the getters return, and starts a new one.
+	// The frame being folded and the published one are separate buffers, so the published one can be read
+	// while the next frame's steps are folded in on another thread. Only the cells a frame touched are cleared
+	void PublishFrame();
+
+	// Folds in a completed step whose changes were made on Step.
+	// ChangedCells may contain duplicates and cells that didn't actually change.
+	void AddStep(const TArray<int>& States, TArrayView<const int> ChangedCells, int Step);
+
+	int GetNumCells() const { return Alive.Num(); }
+
+	// times each cell switched between zero and nonzero during the last published frame
+	const TArray<float>& GetActivity() const { return PublishedActivity; }
+
+	// longest life, in steps, of those that ended during the last published frame. 0 for cells where none did
+	const TArray<float>& GetMaxAges() const { return PublishedMaxAges; }
+
+private:
+
+	// the frame being folded in
+	TArray<float> Activity;
+	TArray<float> MaxAges;
+
+	TArray<float> PublishedActivity;
+	TArray<float> PublishedMaxAges;
+
+	// whether each cell was nonzero as of the last step, and the step it last became so
+	TArray<uint8> Alive;
+	TArray<int> BirthSteps;
+
+	// cells with activity in the frame being folded in, and in the published one
+	TArray<int> Touched;
+	TArray<int> PublishedTouched;
+};
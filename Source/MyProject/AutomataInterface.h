@@ -3,6 +3,8 @@
 #include "AutomataInterface.generated.h"
 
 class UAutomataDisplay;
+struct FBasicGrid;
+struct FGridChange;
 
 // contains members common to virtually all automata
 USTRUCT()
@@ -34,7 +36,7 @@ public:
 
 	FBaseAutomataStruct(TArray<TArray<int>> NewNeighborhoods, UAutomataDisplay* NewDisplay)
 	{
-		Neighborhoods = NewNeighborhoods;
+		Neighborhoods = MoveTemp(NewNeighborhoods);
 		Display = NewDisplay;
 
 		int NumCells = Neighborhoods.Num();
@@ -63,8 +65,39 @@ public:
 	virtual void BroadcastData() {}
 	virtual void StartNewStep() {}
 
+	// taken by value, so a caller that moves its buffers in hands them over without a copy
 	virtual void SetBaseMembers(FBaseAutomataStruct NewBaseMembers) {}
 
+	// writes the full simulation state to disk. Only valid between steps
+	virtual void SaveSnapshot(const FString& Path, bool bCompress) {}
+
+	// replaces the simulation state with a snapshot. Only valid between steps
+	virtual bool LoadSnapshot(const FString& Path) { return false; }
+
+	// replaces cell states with a pattern file, placed at Offset. Only valid between steps
+	virtual bool LoadPattern(const FString& Path, const FBasicGrid& Grid, FIntPoint Offset) { return false; }
+
+	// Adapts to a resized or re-ruled grid in place, keeping states where the old and new grids overlap.
+	// False if the automata can't, and has to be rebuilt. Only valid between steps
+	virtual bool Reconfigure(const FGridChange& Change) { return false; }
+
+	// read access to the state shared by all automata, for recording and analysis. Only valid between steps
+	virtual const FBaseAutomataStruct* GetBaseMembers() const { return nullptr; }
+
+	// Brings SwitchStepBuffer up to date, for automata that only work it out when a frame is broadcast.
+	// Anything else reading the switch steps calls this first. Only valid between steps
+	virtual void CatchUpSwitchSteps() {}
+
+	// number of distinct values a cell's state can take
+	virtual int GetNumStates() const { return 2; }
+
+	// whether BroadcastData sends cell states to the display, as well as switch steps
+	virtual bool BroadcastsStates() const { return false; }
+
+	// Cells that may have changed state since the previous step completed, duplicates allowed.
+	// nullptr when the changes aren't known, e.g. after a load. Only valid between steps
+	virtual const TArray<int>* GetChangedCells() const { return nullptr; }
+
 };
 
 
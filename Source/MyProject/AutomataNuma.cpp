@@ -0,0 +1,99 @@
+#include "AutomataNuma.h"
+
+#if PLATFORM_WINDOWS
+#include "Windows/AllowWindowsPlatformTypes.h"
+#include <windows.h>
+#include "Windows/HideWindowsPlatformTypes.h"
+#endif
+
+namespace
+{
+	TArray<TArray<int>> SingleNode()
+	{
+		TArray<TArray<int>> Nodes;
+		TArray<int>& Cores = Nodes.AddDefaulted_GetRef();
+		for (int Core = 0; Core < FPlatformMisc::NumberOfCoresIncludingHyperthreads(); ++Core)
+		{
+			Cores.Add(Core);
+		}
+		return Nodes;
+	}
+
+#if PLATFORM_LINUX
+	// parses sysfs cpu lists such as "0-15,32-47"
+	TArray<int> ParseCpuList(const FString& List)
+	{
+		TArray<int> Cores;
+		TArray<FString> Spans;
+		List.TrimStartAndEnd().ParseIntoArray(Spans, TEXT(","));
+
+		for (const FString& Span : Spans)
+		{
+			FString First;
+			FString Last;
+			if (!Span.Split(TEXT("-"), &First, &Last))
+			{
+				First = Last = Span;
+			}
+
+			for (int Core = FCString::Atoi(*First); Core <= FCString::Atoi(*Last); ++Core)
+			{
+				Cores.Add(Core);
+			}
+		}
+		return Cores;
+	}
+#endif
+}
+
+TArray<TArray<int>> AutomataNuma::GetNodeCores()
+{
+	TArray<TArray<int>> Nodes;
+
+#if PLATFORM_LINUX
+	for (int Node = 0; ; ++Node)
+	{
+		FString List;
+		if (!FFileHelper::LoadFileToString(List, *FString::Printf(TEXT("/sys/devices/system/node/node%d/cpulist"), Node)))
+		{
+			break;
+		}
+
+		TArray<int> Cores = ParseCpuList(List);
+		if (Cores.Num() > 0)
+		{
+			Nodes.Add(MoveTemp(Cores));
+		}
+	}
+#elif PLATFORM_WINDOWS
+	// only processor group 0 is considered, which covers up to 64 cores
+	ULONG HighestNode = 0;
+	if (GetNumaHighestNodeNumber(&HighestNode))
+	{
+		for (ULONG Node = 0; Node <= HighestNode; ++Node)
+		{
+			ULONGLONG Mask = 0;
+			if (!GetNumaNodeProcessorMask(UCHAR(Node), &Mask))
+			{
+				continue;
+			}
+
+			TArray<int> Cores;
+			for (int Core = 0; Core < 64; ++Core)
+			{
+				if (Mask & (1ull << Core))
+				{
+					Cores.Add(Core);
+				}
+			}
+
+			if (Cores.Num() > 0)
+			{
+				Nodes.Add(MoveTemp(Cores));
+			}
+		}
+	}
+#endif
+
+	return Nodes.Num() > 0 ? Nodes : SingleNode();
+}
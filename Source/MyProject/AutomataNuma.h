@@ -0,0 +1,10 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Minimal NUMA topology queries. Platforms that don't report their topology appear as one node holding every core
+namespace AutomataNuma
+{
+	// logical cores of each node, lowest node first
+	TArray<TArray<int>> GetNodeCores();
+}
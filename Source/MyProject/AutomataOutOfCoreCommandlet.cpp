@@ -0,0 +1,117 @@
+#include "AutomataOutOfCoreCommandlet.h"
+
+#include "MyProject.h"
+#include "OutOfCoreLife.h"
+
+namespace
+{
+	// sequential read rate of a file, in MB/s
+	double MeasureReadBandwidth(const FString& Path)
+	{
+		TUniquePtr<IFileHandle> File(FPlatformFileManager::Get().GetPlatformFile().OpenRead(*Path));
+		if (!File)
+		{
+			return 0;
+		}
+
+		TArray<uint8> Buffer;
+		Buffer.SetNumUninitialized(16 << 20);
+
+		int64 Remaining = File->Size();
+		double Start = FPlatformTime::Seconds();
+		while (Remaining > 0)
+		{
+			int64 Chunk = FMath::Min<int64>(Remaining, Buffer.Num());
+			if (!File->Read(Buffer.GetData(), Chunk))
+			{
+				return 0;
+			}
+			Remaining -= Chunk;
+		}
+		return File->Size() / (FPlatformTime::Seconds() - Start) / (1 << 20);
+	}
+}
+
+int32 UAutomataOutOfCoreCommandlet::Main(const FString& Params)
+{
+	FOutOfCoreConfig Config;
+	Config.Grid.NumXCells = 65536;
+	Config.Grid.NumZCells = 65536;
+	Config.Directory = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("OutOfCore"));
+
+	int32 NumSteps = 10;
+	float Probability = 0.3;
+	int32 Seed = 1;
+	double DiskMBps = 0;
+
+	FParse::Value(*Params, TEXT("X="), Config.Grid.NumXCells);
+	FParse::Value(*Params, TEXT("Z="), Config.Grid.NumZCells);
+	FParse::Value(*Params, TEXT("Dir="), Config.Directory);
+	FParse::Value(*Params, TEXT("Birth="), Config.BirthString);
+	FParse::Value(*Params, TEXT("Survive="), Config.SurviveString);
+	FParse::Value(*Params, TEXT("BandRows="), Config.BandRows);
+	FParse::Value(*Params, TEXT("ResidentBands="), Config.ResidentBands);
+	FParse::Value(*Params, TEXT("Steps="), NumSteps);
+	FParse::Value(*Params, TEXT("Probability="), Probability);
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+	FParse::Value(*Params, TEXT("DiskMBps="), DiskMBps);
+	bool bResume = FParse::Param(*Params, TEXT("Resume"));
+
+	FString Name;
+	if (FParse::Value(*Params, TEXT("Rule="), Name))
+	{
+		int64 Value = StaticEnum<BoundGridRuleset>()->GetValueByNameString(Name);
+		Config.GridRule = Value != INDEX_NONE ? BoundGridRuleset(Value) : Config.GridRule;
+	}
+
+	FOutOfCoreLife Life(Config);
+	if (!Life.Open(!bResume))
+	{
+		return 1;
+	}
+
+	if (!bResume)
+	{
+		double Start = FPlatformTime::Seconds();
+		Life.InitializeCellStates(Probability, Seed);
+		UE_LOG(LogAutomata, Display, TEXT("Seeded %lld cells in %.1fs"), Life.GetNumCells(), FPlatformTime::Seconds() - Start);
+	}
+
+	Life.DropCaches();
+	if (DiskMBps <= 0)
+	{
+		DiskMBps = MeasureReadBandwidth(Life.GetPlanePath(0));
+		Life.DropCaches();
+	}
+
+	// a step reads one plane and writes the other
+	double StepMB = 2.0 * Life.GetPlaneBytes() / (1 << 20);
+	UE_LOG(LogAutomata, Display, TEXT("%lld cells, %.0f MB per plane, disk %.0f MB/s"), Life.GetNumCells(), StepMB / 2, DiskMBps);
+
+	double TotalSeconds = 0;
+	for (int Step = 0; Step < NumSteps; ++Step)
+	{
+		double Start = FPlatformTime::Seconds();
+		Life.Step();
+		double Seconds = FPlatformTime::Seconds() - Start;
+		TotalSeconds += Seconds;
+
+		UE_LOG(LogAutomata, Display, TEXT("Step %lld: %.2fs, %.1f Mcells/s, %.0f MB/s (%.0f%% of disk)"),
+			Life.GetStep(),
+			Seconds,
+			Life.GetNumCells() / Seconds / 1e6,
+			StepMB / Seconds,
+			DiskMBps > 0 ? 100 * StepMB / Seconds / DiskMBps : 0.0);
+	}
+
+	if (NumSteps > 0)
+	{
+		UE_LOG(LogAutomata, Display, TEXT("Sustained %.1f Mcells/s, %.0f MB/s (%.0f%% of disk)"),
+			Life.GetNumCells() * NumSteps / TotalSeconds / 1e6,
+			StepMB * NumSteps / TotalSeconds,
+			DiskMBps > 0 ? 100 * StepMB * NumSteps / TotalSeconds / DiskMBps : 0.0);
+	}
+
+	Life.DropCaches();
+	return 0;
+}
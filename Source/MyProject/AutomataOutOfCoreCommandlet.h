@@ -0,0 +1,19 @@
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+#include "AutomataOutOfCoreCommandlet.generated.h"
+
+// Steps a board larger than memory from memory-mapped planes, and reports throughput against disk bandwidth.
+//   UE4Editor-Cmd MyProject -run=AutomataOutOfCore -X=200000 -Z=200000 -Dir=D:/Automata -Steps=10
+// Planes are created and seeded unless -Resume is given, which continues from the step the ones already there were left at.
+// Disk bandwidth is measured with a cold sequential read of a plane unless given with -DiskMBps=.
+// Other options: -Rule=Torus|Finite|... -Birth= -Survive= -Probability= -Seed= -BandRows= -ResidentBands=
+UCLASS()
+class UAutomataOutOfCoreCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	int32 Main(const FString& Params) override;
+};
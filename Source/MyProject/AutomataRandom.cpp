@@ -0,0 +1,21 @@
+#include "AutomataRandom.h"
+
+void AutomataRandom::FillBernoulli(uint64 Seed, uint64 Stream, float Probability, int NumCells, TArray<uint64>& OutWords)
+{
+	uint64 Threshold = BernoulliThreshold(Probability);
+
+	OutWords.SetNumUninitialized((NumCells + 63) / 64);
+
+	ParallelFor(OutWords.Num(), [&](int32 WordID)
+	{
+		int FirstCell = WordID * 64;
+		int NumBits = FMath::Min(64, NumCells - FirstCell);
+
+		uint64 Word = 0;
+		for (int Bit = 0; Bit < NumBits; ++Bit)
+		{
+			Word |= uint64(Hash(Seed, Stream, FirstCell + Bit) < Threshold) << Bit;
+		}
+		OutWords[WordID] = Word;
+	});
+}
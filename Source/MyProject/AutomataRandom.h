@@ -0,0 +1,50 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Counter-based random numbers: every value is a pure function of (seed, stream, counter),
+// so results don't depend on how work is split across threads or what order it runs in.
+namespace AutomataRandom
+{
+	// independent streams, so that e.g. ant positions don't correlate with cell states
+	enum EStream : uint64
+	{
+		CellStates = 1,
+		AntPositions = 2,
+		AntOrientations = 3,
+		StateHashKeys = 4
+	};
+
+	// SplitMix64 finalizer, a bijective mix of all 64 bits
+	inline uint64 Mix(uint64 Value)
+	{
+		Value ^= Value >> 30;
+		Value *= 0xBF58476D1CE4E5B9ull;
+		Value ^= Value >> 27;
+		Value *= 0x94D049BB133111EBull;
+		Value ^= Value >> 31;
+		return Value;
+	}
+
+	inline uint64 Hash(uint64 Seed, uint64 Stream, uint64 Counter)
+	{
+		uint64 Key = Mix(Seed ^ (Stream * 0x9E3779B97F4A7C15ull));
+		return Mix(Key + Counter * 0x9E3779B97F4A7C15ull);
+	}
+
+	// uniform in [0, Max), without the bias of a modulo
+	inline int Range(uint64 Bits, int Max)
+	{
+		return int(((Bits >> 32) * uint64(Max)) >> 32);
+	}
+
+	// a hash below this value happens with the given probability
+	inline uint64 BernoulliThreshold(float Probability)
+	{
+		double Clamped = FMath::Clamp<double>(Probability, 0, 1);
+		return Clamped >= 1 ? TNumericLimits<uint64>::Max() : uint64(Clamped * 18446744073709551616.0);
+	}
+
+	// bit-packed plane with each bit set with the given probability, generated one word per task
+	void FillBernoulli(uint64 Seed, uint64 Stream, float Probability, int NumCells, TArray<uint64>& OutWords);
+}
@@ -0,0 +1,474 @@
+#include "AutomataRecorder.h"
+
+#include "HAL/FileManager.h"
+
+#include "AutomataInterface.h"
+#include "MyProject.h"
+#include "StatePacking.h"
+
+constexpr uint32 FAutomataRecorder::Magic;
+constexpr uint32 FAutomataRecorder::FooterMagic;
+constexpr uint32 FAutomataRecorder::Version;
+
+namespace
+{
+	void AppendBytes(TArray<uint8>& Buffer, const void* Data, int Bytes)
+	{
+		Buffer.Append(static_cast<const uint8*>(Data), Bytes);
+	}
+
+	template<typename ValueType>
+	ValueType ReadValue(const uint8*& Cursor)
+	{
+		ValueType Value;
+		FMemory::Memcpy(&Value, Cursor, sizeof(ValueType));
+		Cursor += sizeof(ValueType);
+		return Value;
+	}
+
+	// calls Visit(CellID) for every cell whose bits are set in a word of XORed states
+	template<typename VisitorType>
+	void ForEachChangedCell(uint64 Changed, int WordID, int BitsPerCell, int NumCells, VisitorType Visit)
+	{
+		int PerWord = AutomataPacking::CellsPerWord(BitsPerCell);
+		uint64 CellMask = (uint64(1) << BitsPerCell) - 1;
+
+		while (Changed)
+		{
+			int CellInWord = int(FMath::CountTrailingZeros64(Changed)) / BitsPerCell;
+			int CellID = WordID * PerWord + CellInWord;
+			if (CellID < NumCells)
+			{
+				Visit(CellID);
+			}
+			Changed &= ~(CellMask << (CellInWord * BitsPerCell));
+		}
+	}
+}
+
+FAutomataRecorder::~FAutomataRecorder()
+{
+	Close();
+}
+
+bool FAutomataRecorder::Open(const FString& Path, int NumCells, int NumStates, int KeyframeInterval, bool bBroadcastStates)
+{
+	Close();
+
+	Writer.Reset(IFileManager::Get().CreateFileWriter(*Path));
+	if (!Writer)
+	{
+		UE_LOG(LogAutomata, Error, TEXT("Could not open recording %s"), *Path);
+		return false;
+	}
+
+	Header.Magic = Magic;
+	Header.Version = Version;
+	Header.NumStates = NumStates;
+	Header.NumCells = NumCells;
+	Header.KeyframeInterval = FMath::Max(1, KeyframeInterval);
+	Header.BitsPerCell = AutomataPacking::BitsForStates(NumStates);
+	Header.bBroadcastStates = bBroadcastStates;
+
+	Writer->Serialize(&Header, sizeof(Header));
+
+	NumFrames = 0;
+	Index.Reset();
+	LastWords.Reset();
+
+	return true;
+}
+
+void FAutomataRecorder::RecordFrame(const FBaseAutomataStruct& BaseMembers)
+{
+	if (!Writer)
+	{
+		return;
+	}
+
+	AutomataPacking::PackStates(BaseMembers.CurrentStates, Header.BitsPerCell, CurrentWords);
+
+	FRecordedFrameHeader FrameHeader;
+	FrameHeader.FrameNumber = NumFrames;
+	FrameHeader.Step = BaseMembers.NextStep;
+	FrameHeader.Type = NumFrames % Header.KeyframeInterval == 0 ? ERecordedFrameType::Keyframe : ERecordedFrameType::Delta;
+
+	FrameBuffer.Reset();
+
+	if (FrameHeader.Type == ERecordedFrameType::Keyframe)
+	{
+		Index.Add({ NumFrames, 0, Writer->Tell() });
+
+		AppendBytes(FrameBuffer, CurrentWords.GetData(), CurrentWords.Num() * sizeof(uint64));
+		AppendBytes(FrameBuffer, BaseMembers.SwitchStepBuffer.GetData(), BaseMembers.SwitchStepBuffer.Num() * sizeof(float));
+	}
+	else
+	{
+		// runs of changed words, each preceded by the number of unchanged words skipped to reach it
+		uint32 NumRuns = 0;
+		AppendBytes(FrameBuffer, &NumRuns, sizeof(NumRuns));
+
+		int NumWords = CurrentWords.Num();
+		int WordID = 0;
+		while (WordID < NumWords)
+		{
+			int RunStart = WordID;
+			while (WordID < NumWords && CurrentWords[WordID] == LastWords[WordID])
+			{
+				++WordID;
+			}
+			if (WordID == NumWords)
+			{
+				break;
+			}
+
+			uint32 Skip = WordID - RunStart;
+			int ChangedStart = WordID;
+			while (WordID < NumWords && CurrentWords[WordID] != LastWords[WordID])
+			{
+				++WordID;
+			}
+			uint32 Length = WordID - ChangedStart;
+
+			AppendBytes(FrameBuffer, &Skip, sizeof(Skip));
+			AppendBytes(FrameBuffer, &Length, sizeof(Length));
+			for (int ChangedID = ChangedStart; ChangedID < WordID; ++ChangedID)
+			{
+				uint64 Delta = CurrentWords[ChangedID] ^ LastWords[ChangedID];
+				AppendBytes(FrameBuffer, &Delta, sizeof(Delta));
+			}
+			++NumRuns;
+		}
+		FMemory::Memcpy(FrameBuffer.GetData(), &NumRuns, sizeof(NumRuns));
+
+		// switch steps of changed cells follow, in cell order
+		for (WordID = 0; WordID < NumWords; ++WordID)
+		{
+			ForEachChangedCell(CurrentWords[WordID] ^ LastWords[WordID], WordID, Header.BitsPerCell, Header.NumCells, [&](int CellID)
+			{
+				AppendBytes(FrameBuffer, &BaseMembers.SwitchStepBuffer[CellID], sizeof(float));
+			});
+		}
+	}
+
+	FrameHeader.PayloadBytes = FrameBuffer.Num();
+	Writer->Serialize(&FrameHeader, sizeof(FrameHeader));
+	Writer->Serialize(FrameBuffer.GetData(), FrameBuffer.Num());
+
+	Swap(LastWords, CurrentWords);
+	++NumFrames;
+}
+
+void FAutomataRecorder::Close()
+{
+	if (!Writer)
+	{
+		return;
+	}
+
+	FRecordingFooter Footer;
+	Footer.IndexOffset = Writer->Tell();
+	Footer.NumEntries = Index.Num();
+	Footer.NumFrames = NumFrames;
+	Footer.Magic = FooterMagic;
+
+	Writer->Serialize(Index.GetData(), Index.Num() * sizeof(FRecordingIndexEntry));
+	Writer->Serialize(&Footer, sizeof(Footer));
+
+	Writer->Close();
+	Writer.Reset();
+}
+
+bool FAutomataPlayback::Open(const FString& Path)
+{
+	Reader.Reset(IFileManager::Get().CreateFileReader(*Path));
+	if (!Reader)
+	{
+		UE_LOG(LogAutomata, Error, TEXT("Could not open recording %s"), *Path);
+		return false;
+	}
+
+	Reader->Serialize(&Header, sizeof(Header));
+	if (Reader->IsError() || Header.Magic != FAutomataRecorder::Magic || Header.Version != FAutomataRecorder::Version)
+	{
+		UE_LOG(LogAutomata, Error, TEXT("%s is not a version %u recording"), *Path, FAutomataRecorder::Version);
+		Reader.Reset();
+		return false;
+	}
+
+	// the recorder always packs with BitsForStates, so anything else is corrupt
+	if (Header.NumStates < 1 || Header.NumCells < 0 || Header.KeyframeInterval < 1
+		|| Header.BitsPerCell != AutomataPacking::BitsForStates(Header.NumStates))
+	{
+		UE_LOG(LogAutomata, Error, TEXT("Recording %s has an inconsistent header"), *Path);
+		Reader.Reset();
+		return false;
+	}
+
+	if (!ReadIndex())
+	{
+		UE_LOG(LogAutomata, Warning, TEXT("Recording %s was not closed cleanly, rebuilding its index"), *Path);
+		RebuildIndex();
+	}
+
+	Words.Init(0, AutomataPacking::NumWords(Header.NumCells, Header.BitsPerCell));
+	States.Init(0, Header.NumCells);
+	SwitchSteps.Init(TNumericLimits<int32>::Min(), Header.NumCells);
+
+	CurrentFrame = -1;
+	Reader->Seek(sizeof(FRecordingHeader));
+
+	return TotalFrames > 0;
+}
+
+bool FAutomataPlayback::ReadIndex()
+{
+	int64 TotalSize = Reader->TotalSize();
+	if (TotalSize < int64(sizeof(FRecordingHeader) + sizeof(FRecordingFooter)))
+	{
+		return false;
+	}
+
+	FRecordingFooter Footer;
+	Reader->Seek(TotalSize - sizeof(FRecordingFooter));
+	Reader->Serialize(&Footer, sizeof(Footer));
+
+	if (Footer.Magic != FAutomataRecorder::FooterMagic || Footer.IndexOffset < int64(sizeof(FRecordingHeader))
+		|| Footer.NumFrames > uint32(MAX_int32)
+		|| Footer.IndexOffset + int64(Footer.NumEntries) * int64(sizeof(FRecordingIndexEntry)) > TotalSize - int64(sizeof(FRecordingFooter)))
+	{
+		return false;
+	}
+
+	Index.SetNumUninitialized(Footer.NumEntries);
+	Reader->Seek(Footer.IndexOffset);
+	Reader->Serialize(Index.GetData(), Index.Num() * sizeof(FRecordingIndexEntry));
+
+	TotalFrames = Footer.NumFrames;
+	EndOfFrames = Footer.IndexOffset;
+
+	// Seek binary searches the index and jumps straight to its offsets, so they have to be ordered and in the frames
+	for (int EntryID = 0; EntryID < Index.Num(); ++EntryID)
+	{
+		const FRecordingIndexEntry& Entry = Index[EntryID];
+		bool bOrdered = EntryID == 0 || (Entry.FrameNumber > Index[EntryID - 1].FrameNumber && Entry.Offset > Index[EntryID - 1].Offset);
+		if (!bOrdered || Entry.FrameNumber >= Footer.NumFrames || Entry.Offset < int64(sizeof(FRecordingHeader)) || Entry.Offset >= EndOfFrames)
+		{
+			return false;
+		}
+	}
+
+	return !Reader->IsError();
+}
+
+void FAutomataPlayback::RebuildIndex()
+{
+	Index.Reset();
+	TotalFrames = 0;
+
+	int64 TotalSize = Reader->TotalSize();
+	int64 Offset = sizeof(FRecordingHeader);
+
+	// a torn final frame is dropped
+	while (Offset + int64(sizeof(FRecordedFrameHeader)) <= TotalSize)
+	{
+		FRecordedFrameHeader FrameHeader;
+		Reader->Seek(Offset);
+		Reader->Serialize(&FrameHeader, sizeof(FrameHeader));
+
+		int64 NextOffset = Offset + sizeof(FrameHeader) + FrameHeader.PayloadBytes;
+		if (NextOffset > TotalSize || FrameHeader.FrameNumber != uint32(TotalFrames))
+		{
+			break;
+		}
+
+		if (FrameHeader.Type == ERecordedFrameType::Keyframe)
+		{
+			Index.Add({ FrameHeader.FrameNumber, 0, Offset });
+		}
+
+		Offset = NextOffset;
+		++TotalFrames;
+	}
+
+	EndOfFrames = Offset;
+}
+
+bool FAutomataPlayback::ReadFrame()
+{
+	if (!Reader || Reader->Tell() >= EndOfFrames)
+	{
+		return false;
+	}
+
+	FRecordedFrameHeader FrameHeader;
+	Reader->Serialize(&FrameHeader, sizeof(FrameHeader));
+
+	if (Reader->IsError() || Reader->Tell() + int64(FrameHeader.PayloadBytes) > EndOfFrames)
+	{
+		return false;
+	}
+
+	FrameBuffer.SetNumUninitialized(FrameHeader.PayloadBytes);
+	Reader->Serialize(FrameBuffer.GetData(), FrameBuffer.Num());
+
+	if (Reader->IsError())
+	{
+		return false;
+	}
+
+	bool bApplied = false;
+	if (FrameHeader.Type == ERecordedFrameType::Keyframe)
+	{
+		bApplied = ApplyKeyframe(FrameBuffer.GetData(), FrameBuffer.Num());
+	}
+	else if (FrameHeader.Type == ERecordedFrameType::Delta)
+	{
+		bApplied = ApplyDelta(FrameBuffer.GetData(), FrameBuffer.Num());
+	}
+
+	if (!bApplied)
+	{
+		UE_LOG(LogAutomata, Error, TEXT("Recorded frame %u is corrupt, ending playback"), FrameHeader.FrameNumber);
+		Reader->Seek(EndOfFrames);
+		return false;
+	}
+
+	CurrentFrame = FrameHeader.FrameNumber;
+	CurrentStep = FrameHeader.Step;
+
+	return true;
+}
+
+bool FAutomataPlayback::ApplyKeyframe(const uint8* Payload, int64 PayloadBytes)
+{
+	if (PayloadBytes != int64(Words.Num()) * sizeof(uint64) + int64(SwitchSteps.Num()) * sizeof(float))
+	{
+		return false;
+	}
+
+	FMemory::Memcpy(Words.GetData(), Payload, Words.Num() * sizeof(uint64));
+	AutomataPacking::UnpackStates(Words.GetData(), Header.NumCells, Header.BitsPerCell, States);
+
+	FMemory::Memcpy(SwitchSteps.GetData(), Payload + Words.Num() * sizeof(uint64), SwitchSteps.Num() * sizeof(float));
+
+	return true;
+}
+
+bool FAutomataPlayback::ApplyDelta(const uint8* Payload, int64 PayloadBytes)
+{
+	int PerWord = AutomataPacking::CellsPerWord(Header.BitsPerCell);
+	uint64 CellMask = (uint64(1) << Header.BitsPerCell) - 1;
+
+	const uint8* End = Payload + PayloadBytes;
+	if (PayloadBytes < int64(sizeof(uint32)))
+	{
+		return false;
+	}
+
+	// Switch steps are stored after the runs, so find where the runs end first.
+	// The same pass checks every run and counts the switch steps it implies, so nothing is applied from a bad frame
+	const uint8* Cursor = Payload;
+	uint32 NumRuns = ReadValue<uint32>(Cursor);
+	int64 RunEnd = 0;
+	int64 NumSwitches = 0;
+	for (uint32 Run = 0; Run < NumRuns; ++Run)
+	{
+		if (End - Cursor < int64(2 * sizeof(uint32)))
+		{
+			return false;
+		}
+		RunEnd += ReadValue<uint32>(Cursor);
+		uint32 Length = ReadValue<uint32>(Cursor);
+
+		if (RunEnd + Length > Words.Num() || (End - Cursor) / int64(sizeof(uint64)) < int64(Length))
+		{
+			return false;
+		}
+
+		for (uint32 i = 0; i < Length; ++i, ++RunEnd)
+		{
+			uint64 Delta = ReadValue<uint64>(Cursor);
+			ForEachChangedCell(Delta, int(RunEnd), Header.BitsPerCell, Header.NumCells, [&](int CellID)
+			{
+				++NumSwitches;
+			});
+		}
+	}
+	const uint8* SwitchCursor = Cursor;
+
+	if (End - SwitchCursor != NumSwitches * int64(sizeof(float)))
+	{
+		return false;
+	}
+
+	Cursor = Payload + sizeof(uint32);
+	int WordID = 0;
+	for (uint32 Run = 0; Run < NumRuns; ++Run)
+	{
+		WordID += ReadValue<uint32>(Cursor);
+		uint32 Length = ReadValue<uint32>(Cursor);
+
+		for (uint32 i = 0; i < Length; ++i, ++WordID)
+		{
+			uint64 Delta = ReadValue<uint64>(Cursor);
+			uint64 Word = Words[WordID] ^ Delta;
+			Words[WordID] = Word;
+
+			ForEachChangedCell(Delta, WordID, Header.BitsPerCell, Header.NumCells, [&](int CellID)
+			{
+				States[CellID] = int((Word >> ((CellID - WordID * PerWord) * Header.BitsPerCell)) & CellMask);
+				SwitchSteps[CellID] = ReadValue<float>(SwitchCursor);
+			});
+		}
+	}
+
+	return true;
+}
+
+bool FAutomataPlayback::NextFrame()
+{
+	return ReadFrame();
+}
+
+bool FAutomataPlayback::Seek(int FrameNumber)
+{
+	if (!Reader || FrameNumber < 0 || FrameNumber >= TotalFrames || Index.Num() == 0)
+	{
+		return false;
+	}
+
+	// last keyframe at or before the target
+	int Lower = 0;
+	int Upper = Index.Num();
+	while (Upper - Lower > 1)
+	{
+		int Middle = (Lower + Upper) / 2;
+		if (int(Index[Middle].FrameNumber) <= FrameNumber)
+		{
+			Lower = Middle;
+		}
+		else
+		{
+			Upper = Middle;
+		}
+	}
+
+	// reading forward is cheaper than reloading when the target is ahead within the same keyframe span
+	bool bReadForward = CurrentFrame >= int(Index[Lower].FrameNumber) && CurrentFrame <= FrameNumber;
+	if (!bReadForward)
+	{
+		Reader->Seek(Index[Lower].Offset);
+		CurrentFrame = -1;
+	}
+
+	while (CurrentFrame < FrameNumber)
+	{
+		if (!ReadFrame())
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
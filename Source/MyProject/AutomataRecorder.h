@@ -0,0 +1,145 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FBaseAutomataStruct;
+
+struct FRecordingHeader
+{
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	int32 NumStates = 2;
+	int32 NumCells = 0;
+	int32 KeyframeInterval = 0;
+	uint8 BitsPerCell = 1;
+	// whether playback should send cell states to the display, as well as switch steps
+	uint8 bBroadcastStates = 0;
+	uint8 Padding[2] = {};
+};
+
+enum class ERecordedFrameType : uint8
+{
+	Keyframe,
+	Delta
+};
+
+struct FRecordedFrameHeader
+{
+	uint32 FrameNumber = 0;
+	ERecordedFrameType Type = ERecordedFrameType::Keyframe;
+	uint8 Padding[3] = {};
+	float Step = 0;
+	uint32 PayloadBytes = 0;
+};
+
+struct FRecordingIndexEntry
+{
+	uint32 FrameNumber = 0;
+	uint32 Padding = 0;
+	int64 Offset = 0;
+};
+
+// written last, so a recording that was never closed has no footer and its index is rebuilt by scanning
+struct FRecordingFooter
+{
+	int64 IndexOffset = 0;
+	uint32 NumEntries = 0;
+	uint32 NumFrames = 0;
+	uint32 Magic = 0;
+	uint32 Padding = 0;
+};
+
+// Streams every generation of an automata to disk.
+// Every KeyframeInterval frames the full bit-packed state and switch steps are written;
+// other frames store only the XOR of the packed state with the previous frame, run-length encoded
+// over words, followed by the new switch steps of the cells that changed.
+class FAutomataRecorder
+{
+public:
+
+	static constexpr uint32 Magic = 0x43524143; // "CARC"
+	static constexpr uint32 FooterMagic = 0x58444E49; // "INDX"
+	static constexpr uint32 Version = 1;
+
+	~FAutomataRecorder();
+
+	bool Open(const FString& Path, int NumCells, int NumStates, int KeyframeInterval, bool bBroadcastStates);
+
+	// Only valid between steps
+	void RecordFrame(const FBaseAutomataStruct& BaseMembers);
+
+	// writes the keyframe index. Called automatically on destruction
+	void Close();
+
+private:
+
+	TUniquePtr<FArchive> Writer;
+
+	FRecordingHeader Header;
+
+	uint32 NumFrames = 0;
+
+	// packed state of the last recorded frame, which deltas are taken against
+	TArray<uint64> LastWords;
+	TArray<uint64> CurrentWords;
+
+	TArray<FRecordingIndexEntry> Index;
+
+	TArray<uint8> FrameBuffer;
+};
+
+// Reads a recording back, one frame at a time or by seeking.
+// Seeking loads the nearest keyframe at or before the target, so costs at most KeyframeInterval deltas.
+class FAutomataPlayback
+{
+public:
+
+	bool Open(const FString& Path);
+
+	int NumFrames() const { return TotalFrames; }
+
+	int GetFrameNumber() const { return CurrentFrame; }
+
+	float GetStep() const { return CurrentStep; }
+
+	bool BroadcastsStates() const { return Header.bBroadcastStates != 0; }
+
+	// advances one frame, returning false at the end of the recording
+	bool NextFrame();
+
+	bool Seek(int FrameNumber);
+
+	const TArray<int>& GetStates() const { return States; }
+	const TArray<float>& GetSwitchSteps() const { return SwitchSteps; }
+
+private:
+
+	TUniquePtr<FArchive> Reader;
+
+	FRecordingHeader Header;
+
+	// keyframes in ascending frame order. Frames between keyframes are read sequentially
+	TArray<FRecordingIndexEntry> Index;
+
+	int TotalFrames = 0;
+
+	int64 EndOfFrames = 0;
+
+	int CurrentFrame = -1;
+	float CurrentStep = 0;
+
+	TArray<uint64> Words;
+	TArray<int> States;
+	TArray<float> SwitchSteps;
+
+	TArray<uint8> FrameBuffer;
+
+	bool ReadIndex();
+	void RebuildIndex();
+
+	// Reads the frame at the reader's current position.
+	// A frame whose payload doesn't match the header is rejected before anything is applied, and ends playback
+	bool ReadFrame();
+	bool ApplyKeyframe(const uint8* Payload, int64 PayloadBytes);
+	bool ApplyDelta(const uint8* Payload, int64 PayloadBytes);
+};
@@ -0,0 +1,52 @@
+#include "AutomataReplay.h"
+#include "AutomataDisplay.h"
+
+bool UAutomataReplay::OpenRecording(const FString& Path, UAutomataDisplay* NewDisplay)
+{
+	BaseMembers.Display = NewDisplay;
+
+	if (!Playback.Open(Path) || !Playback.NextFrame())
+	{
+		return false;
+	}
+
+	CopyFrame();
+	return true;
+}
+
+bool UAutomataReplay::SeekFrame(int FrameNumber)
+{
+	if (!Playback.Seek(FrameNumber))
+	{
+		return false;
+	}
+
+	CopyFrame();
+	return true;
+}
+
+void UAutomataReplay::CopyFrame()
+{
+	BaseMembers.CurrentStates = Playback.GetStates();
+	BaseMembers.SwitchStepBuffer = Playback.GetSwitchSteps();
+	BaseMembers.NextStep = Playback.GetStep();
+}
+
+void UAutomataReplay::StepComplete()
+{
+	// holds on the final frame once the recording runs out
+	if (Playback.NextFrame())
+	{
+		CopyFrame();
+	}
+}
+
+void UAutomataReplay::BroadcastData()
+{
+	BaseMembers.Display->UpdateSwitchTimes(BaseMembers.SwitchStepBuffer);
+
+	if (Playback.BroadcastsStates())
+	{
+		BaseMembers.Display->UpdateEndFadeState(BaseMembers.CurrentStates);
+	}
+}
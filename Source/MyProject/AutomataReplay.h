@@ -0,0 +1,32 @@
+#pragma once
+
+#include "AutomataInterface.h"
+#include "AutomataRecorder.h"
+#include "AutomataReplay.generated.h"
+
+// Plays a recording back through the display without running any rules
+UCLASS()
+class UAutomataReplay : public UObject, public IAutomata
+{
+	GENERATED_BODY()
+
+	FBaseAutomataStruct BaseMembers;
+
+	FAutomataPlayback Playback;
+
+	void CopyFrame();
+
+public:
+
+	bool OpenRecording(const FString& Path, UAutomataDisplay* NewDisplay);
+
+	bool SeekFrame(int FrameNumber);
+
+	int NumFrames() const { return Playback.NumFrames(); }
+
+	const FBaseAutomataStruct* GetBaseMembers() const override { return &BaseMembers; }
+	bool BroadcastsStates() const override { return Playback.BroadcastsStates(); }
+
+	void StepComplete() override;
+	void BroadcastData() override;
+};
@@ -0,0 +1,222 @@
+#include "AutomataSharedExport.h"
+
+#include "AutomataInterface.h"
+#include "MyProject.h"
+#include "StatePacking.h"
+
+constexpr uint32 FSharedStateExport::Magic;
+constexpr uint32 FSharedStateExport::Version;
+
+namespace
+{
+	uint8* SlotAt(const FSharedExportHeader* Header, int64 FrameNumber)
+	{
+		uint8* Base = (uint8*)Header + sizeof(FSharedExportHeader);
+		return Base + (FrameNumber % Header->NumSlots) * Header->SlotBytes;
+	}
+
+	uint32 ReadWriteAccess()
+	{
+		return uint32(FPlatformMemory::ESharedMemoryAccess::Read) | uint32(FPlatformMemory::ESharedMemoryAccess::Write);
+	}
+}
+
+FSharedStateExport::~FSharedStateExport()
+{
+	Close();
+}
+
+bool FSharedStateExport::Open(const FString& Name, int NumCells, int NumStates, int NumSlots)
+{
+	Close();
+
+	int BitsPerCell = AutomataPacking::BitsForStates(NumStates);
+	int64 SlotBytes = sizeof(FSharedFrameHeader) + int64(AutomataPacking::NumWords(NumCells, BitsPerCell)) * sizeof(uint64);
+	NumSlots = FMath::Max(NumSlots, 2);
+
+	Region = FPlatformMemory::MapNamedSharedMemoryRegion(Name, true, ReadWriteAccess(), sizeof(FSharedExportHeader) + SlotBytes * NumSlots);
+	if (Region == nullptr)
+	{
+		UE_LOG(LogAutomata, Error, TEXT("Could not create shared memory region %s"), *Name);
+		return false;
+	}
+
+	Header = (FSharedExportHeader*)Region->GetAddress();
+	FMemory::Memzero(Header, Region->GetSize());
+
+	Header->NumCells = NumCells;
+	Header->BitsPerCell = BitsPerCell;
+	Header->NumSlots = NumSlots;
+	Header->SlotBytes = SlotBytes;
+	Header->LatestFrame = -1;
+	Header->Version = Version;
+
+	// readers check the magic last, so they never see a half-written header
+	FPlatformMisc::MemoryBarrier();
+	Header->Magic = Magic;
+
+	NextFrame = 0;
+	bPackedValid = false;
+	return true;
+}
+
+void FSharedStateExport::Close()
+{
+	if (Region != nullptr)
+	{
+		FPlatformMemory::UnmapNamedSharedMemoryRegion(Region);
+		Region = nullptr;
+		Header = nullptr;
+	}
+}
+
+void FSharedStateExport::Publish(const FBaseAutomataStruct& BaseMembers, const TArray<int>* ChangedCells)
+{
+	if (Header == nullptr || BaseMembers.CurrentStates.Num() != Header->NumCells)
+	{
+		bPackedValid = false;
+		return;
+	}
+
+	int BitsPerCell = Header->BitsPerCell;
+	int NumWords = AutomataPacking::NumWords(Header->NumCells, BitsPerCell);
+
+	// once the changes touch more cells than there are words, packing everything in parallel is no slower
+	if (!bPackedValid || ChangedCells == nullptr || ChangedCells->Num() > NumWords)
+	{
+		AutomataPacking::PackStates(BaseMembers.CurrentStates, BitsPerCell, Packed);
+		bPackedValid = true;
+	}
+	else
+	{
+		int PerWord = AutomataPacking::CellsPerWord(BitsPerCell);
+		uint64 Mask = (uint64(1) << BitsPerCell) - 1;
+
+		for (int CellID : *ChangedCells)
+		{
+			int Shift = (CellID % PerWord) * BitsPerCell;
+			uint64& Word = Packed[CellID / PerWord];
+			Word = (Word & ~(Mask << Shift)) | ((uint64(BaseMembers.CurrentStates[CellID]) & Mask) << Shift);
+		}
+	}
+
+	int64 FrameNumber = NextFrame++;
+	uint8* Slot = SlotAt(Header, FrameNumber);
+	FSharedFrameHeader* FrameHeader = (FSharedFrameHeader*)Slot;
+
+	int64 Sequence = FrameHeader->Sequence;
+	FPlatformAtomics::AtomicStore(&FrameHeader->Sequence, Sequence + 1);
+	FPlatformMisc::MemoryBarrier();
+
+	FrameHeader->FrameNumber = FrameNumber;
+	FrameHeader->Step = BaseMembers.NextStep;
+	FMemory::Memcpy(Slot + sizeof(FSharedFrameHeader), Packed.GetData(), int64(NumWords) * sizeof(uint64));
+
+	FPlatformMisc::MemoryBarrier();
+	FPlatformAtomics::AtomicStore(&FrameHeader->Sequence, Sequence + 2);
+	FPlatformAtomics::AtomicStore(&Header->LatestFrame, FrameNumber);
+}
+
+FSharedStateReader::~FSharedStateReader()
+{
+	Close();
+}
+
+bool FSharedStateReader::Open(const FString& Name)
+{
+	Close();
+
+	// the header says how large the whole ring is, so it's mapped on its own first
+	FPlatformMemory::FSharedMemoryRegion* HeaderRegion = FPlatformMemory::MapNamedSharedMemoryRegion(Name, false, ReadWriteAccess(), sizeof(FSharedExportHeader));
+	if (HeaderRegion == nullptr)
+	{
+		return false;
+	}
+
+	FSharedExportHeader Peek;
+	FMemory::Memcpy(&Peek, HeaderRegion->GetAddress(), sizeof(Peek));
+	FPlatformMemory::UnmapNamedSharedMemoryRegion(HeaderRegion);
+
+	if (Peek.Magic != FSharedStateExport::Magic || Peek.Version != FSharedStateExport::Version)
+	{
+		UE_LOG(LogAutomata, Error, TEXT("Shared memory region %s is not a version %u automata export"), *Name, FSharedStateExport::Version);
+		return false;
+	}
+
+	Region = FPlatformMemory::MapNamedSharedMemoryRegion(Name, false, ReadWriteAccess(), sizeof(FSharedExportHeader) + Peek.SlotBytes * Peek.NumSlots);
+	if (Region == nullptr)
+	{
+		return false;
+	}
+
+	Header = (const FSharedExportHeader*)Region->GetAddress();
+	return true;
+}
+
+void FSharedStateReader::Close()
+{
+	if (Region != nullptr)
+	{
+		FPlatformMemory::UnmapNamedSharedMemoryRegion(Region);
+		Region = nullptr;
+		Header = nullptr;
+	}
+}
+
+bool FSharedStateReader::ReadLatest(TFunctionRef<void(const uint64* Words, int64 FrameNumber, float Step)> Visit) const
+{
+	if (Header == nullptr)
+	{
+		return false;
+	}
+
+	int64 Latest = FPlatformAtomics::AtomicRead(&Header->LatestFrame);
+	if (Latest < 0)
+	{
+		return false;
+	}
+
+	const uint8* Slot = SlotAt(Header, Latest);
+	const FSharedFrameHeader* FrameHeader = (const FSharedFrameHeader*)Slot;
+
+	int64 Before = FPlatformAtomics::AtomicRead(&FrameHeader->Sequence);
+	if (Before & 1)
+	{
+		return false;
+	}
+	FPlatformMisc::MemoryBarrier();
+
+	Visit((const uint64*)(Slot + sizeof(FSharedFrameHeader)), FrameHeader->FrameNumber, FrameHeader->Step);
+
+	FPlatformMisc::MemoryBarrier();
+	return FPlatformAtomics::AtomicRead(&FrameHeader->Sequence) == Before;
+}
+
+bool FSharedStateReader::ReadLatest(TArray<int>& OutStates, int64& OutFrameNumber) const
+{
+	if (Header == nullptr)
+	{
+		return false;
+	}
+
+	// a retry only happens if the writer lapped the whole ring during one unpack
+	for (int Attempt = 0; Attempt < 16; ++Attempt)
+	{
+		bool bConsistent = ReadLatest([&](const uint64* Words, int64 FrameNumber, float Step)
+		{
+			AutomataPacking::UnpackStates(Words, Header->NumCells, Header->BitsPerCell, OutStates);
+			OutFrameNumber = FrameNumber;
+		});
+
+		if (bConsistent)
+		{
+			return true;
+		}
+
+		if (FPlatformAtomics::AtomicRead(&Header->LatestFrame) < 0)
+		{
+			return false;
+		}
+	}
+	return false;
+}
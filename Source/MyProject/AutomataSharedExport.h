@@ -0,0 +1,96 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/PlatformMemory.h"
+
+struct FBaseAutomataStruct;
+
+// Layout of the shared region, for readers in other processes:
+// FSharedExportHeader, then NumSlots slots of SlotBytes each.
+// A slot is an FSharedFrameHeader followed by the frame's bit-packed states, as AutomataPacking lays them out.
+// Frame n is written to slot n % NumSlots.
+struct FSharedExportHeader
+{
+	uint32 Magic;
+	uint32 Version;
+	int32 NumCells;
+	int32 BitsPerCell;
+	int32 NumSlots;
+	int32 Padding;
+	int64 SlotBytes;
+
+	// newest complete frame, or -1 before the first
+	volatile int64 LatestFrame;
+};
+
+struct FSharedFrameHeader
+{
+	// Odd while the slot is being written. A read is consistent if this was even
+	// before it and unchanged after it
+	volatile int64 Sequence;
+	int64 FrameNumber;
+	float Step;
+	int32 Padding;
+};
+
+// Publishes each completed generation into a named shared memory ring, for any number of local readers.
+// The writer never waits on readers: it overwrites the oldest slot under a seqlock,
+// and a reader that was lapped mid-read simply sees the sequence change and retries.
+class FSharedStateExport
+{
+public:
+
+	static constexpr uint32 Magic = 0x58455341; // "ASEX"
+	static constexpr uint32 Version = 1;
+
+	~FSharedStateExport();
+
+	bool Open(const FString& Name, int NumCells, int NumStates, int NumSlots);
+	void Close();
+
+	// Only valid between steps. ChangedCells are the cells that may have changed since the previous publish,
+	// or nullptr if they aren't known, in which case the whole board is packed again
+	void Publish(const FBaseAutomataStruct& BaseMembers, const TArray<int>* ChangedCells);
+
+	// the states changed outside a step, so the next publish packs the whole board
+	void Invalidate() { bPackedValid = false; }
+
+private:
+
+	FPlatformMemory::FSharedMemoryRegion* Region = nullptr;
+	FSharedExportHeader* Header = nullptr;
+
+	int64 NextFrame = 0;
+
+	// The latest frame, packed. Kept up to date from each step's changed cells,
+	// so publishing costs a copy of the packed words rather than a pass over every cell
+	TArray<uint64> Packed;
+	bool bPackedValid = false;
+};
+
+// Maps a ring published by FSharedStateExport, possibly from another process
+class FSharedStateReader
+{
+public:
+
+	~FSharedStateReader();
+
+	bool Open(const FString& Name);
+	void Close();
+
+	int GetNumCells() const { return Header ? Header->NumCells : 0; }
+	int GetBitsPerCell() const { return Header ? Header->BitsPerCell : 0; }
+
+	// Calls Visit on the newest frame's packed words, in place in shared memory.
+	// Returns false if nothing is published yet or the writer reused the slot during the visit,
+	// in which case whatever Visit read should be discarded
+	bool ReadLatest(TFunctionRef<void(const uint64* Words, int64 FrameNumber, float Step)> Visit) const;
+
+	// unpacks the newest frame, retrying until it gets a consistent copy
+	bool ReadLatest(TArray<int>& OutStates, int64& OutFrameNumber) const;
+
+private:
+
+	FPlatformMemory::FSharedMemoryRegion* Region = nullptr;
+	const FSharedExportHeader* Header = nullptr;
+};
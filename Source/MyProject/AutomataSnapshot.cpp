@@ -0,0 +1,365 @@
+#include "AutomataSnapshot.h"
+
+#include "Async/Async.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/Compression.h"
+#include "Misc/Guid.h"
+
+#include "MyProject.h"
+#include "StatePacking.h"
+
+constexpr uint32 FAutomataSnapshot::Magic;
+constexpr uint32 FAutomataSnapshot::Version;
+constexpr int64 FAutomataSnapshot::ChunkSize;
+
+namespace
+{
+	int64 AlignTo8(int64 Size)
+	{
+		return (Size + 7) & ~int64(7);
+	}
+
+	template<typename ElementType>
+	void AppendSection(TArray64<uint8>& Payload, const ElementType* Data, int64 Num)
+	{
+		int64 Start = Payload.Num();
+		int64 Bytes = Num * sizeof(ElementType);
+		Payload.AddZeroed(AlignTo8(Bytes));
+		FMemory::Memcpy(Payload.GetData() + Start, Data, Bytes);
+	}
+
+	template<typename ElementType>
+	void ReadSection(const uint8*& Cursor, TArray<ElementType>& Out, int Num)
+	{
+		Out.SetNumUninitialized(Num);
+		FMemory::Memcpy(Out.GetData(), Cursor, Num * sizeof(ElementType));
+		Cursor += AlignTo8(int64(Num) * sizeof(ElementType));
+	}
+}
+
+int64 FAutomataSnapshot::PayloadSize(const FAutomataSnapshotHeader& Header)
+{
+	int64 Size = int64(AutomataPacking::NumWords(Header.NumCells, Header.BitsPerCell)) * sizeof(uint64);
+	Size += AlignTo8(int64(Header.NumCells) * sizeof(float));
+
+	if (ESnapshotKind(Header.Kind) == ESnapshotKind::Lifelike)
+	{
+		Size += int64(AutomataPacking::NumWords(Header.NumCells, 1)) * sizeof(uint64);
+	}
+	else
+	{
+		Size += (Header.Version >= 2 ? 3 : 2) * AlignTo8(int64(Header.NumAnts) * sizeof(int));
+	}
+
+	return Size;
+}
+
+int64 FAutomataSnapshot::HeaderSize(uint32 HeaderVersion)
+{
+	return HeaderVersion >= 3 ? sizeof(FAutomataSnapshotHeader) : STRUCT_OFFSET(FAutomataSnapshotHeader, NumAntStates);
+}
+
+bool FAutomataSnapshot::IsHeaderValid(const FAutomataSnapshotHeader& Header)
+{
+	bool bKnownKind = Header.Kind == uint8(ESnapshotKind::Lifelike) || Header.Kind == uint8(ESnapshotKind::Ant);
+	bool bPackable = Header.BitsPerCell >= 1 && Header.BitsPerCell <= 32 && FMath::IsPowerOfTwo(Header.BitsPerCell);
+	bPackable = bPackable && Header.NumStates > 0 && Header.BitsPerCell == AutomataPacking::BitsForStates(Header.NumStates);
+
+	bool bAntStatesKnown = Header.Version < 3 || Header.Kind != uint8(ESnapshotKind::Ant) || Header.NumAntStates > 0;
+
+	return bKnownKind && bPackable && bAntStatesKnown && Header.NumStates > 0 && Header.NumCells >= 0 && Header.NumAnts >= 0;
+}
+
+void FAutomataSnapshot::BuildPayload(TArray64<uint8>& Payload) const
+{
+	TArray<uint64> Words;
+
+	if (PackedStates.Num() > 0)
+	{
+		AppendSection(Payload, PackedStates.GetData(), PackedStates.Num());
+	}
+	else
+	{
+		AutomataPacking::PackStates(CurrentStates, AutomataPacking::BitsForStates(NumStates), Words);
+		AppendSection(Payload, Words.GetData(), Words.Num());
+	}
+
+	AppendSection(Payload, SwitchStepBuffer.GetData(), SwitchStepBuffer.Num());
+
+	if (Kind == ESnapshotKind::Lifelike && PackedEvalFlags.Num() > 0)
+	{
+		AppendSection(Payload, PackedEvalFlags.GetData(), PackedEvalFlags.Num());
+	}
+	else if (Kind == ESnapshotKind::Lifelike)
+	{
+		AutomataPacking::PackFlags(EvalFlags, Words);
+		AppendSection(Payload, Words.GetData(), Words.Num());
+	}
+	else
+	{
+		AppendSection(Payload, AntPositions.GetData(), AntPositions.Num());
+		AppendSection(Payload, AntOrientations.GetData(), AntOrientations.Num());
+		AppendSection(Payload, AntStates.GetData(), AntStates.Num());
+	}
+}
+
+bool FAutomataSnapshot::ReadPayload(const uint8* Payload, const FAutomataSnapshotHeader& Header)
+{
+	const uint8* Cursor = Payload;
+
+	Kind = ESnapshotKind(Header.Kind);
+	NumStates = Header.NumStates;
+	NextStep = Header.NextStep;
+	NumAntStates = Header.Version >= 3 ? Header.NumAntStates : 0;
+
+	AutomataPacking::UnpackStates(reinterpret_cast<const uint64*>(Cursor), Header.NumCells, Header.BitsPerCell, CurrentStates);
+	Cursor += int64(AutomataPacking::NumWords(Header.NumCells, Header.BitsPerCell)) * sizeof(uint64);
+
+	ReadSection(Cursor, SwitchStepBuffer, Header.NumCells);
+
+	if (Kind == ESnapshotKind::Lifelike)
+	{
+		AutomataPacking::UnpackFlags(reinterpret_cast<const uint64*>(Cursor), Header.NumCells, EvalFlags);
+	}
+	else
+	{
+		ReadSection(Cursor, AntPositions, Header.NumAnts);
+		ReadSection(Cursor, AntOrientations, Header.NumAnts);
+		if (Header.Version >= 2)
+		{
+			ReadSection(Cursor, AntStates, Header.NumAnts);
+		}
+	}
+
+	return true;
+}
+
+bool FAutomataSnapshot::WriteToFile(const FString& Path, bool bCompress) const
+{
+	FAutomataSnapshotHeader Header;
+	Header.Magic = Magic;
+	Header.Version = Version;
+	Header.Kind = uint8(Kind);
+	Header.bCompressed = bCompress;
+	Header.BitsPerCell = AutomataPacking::BitsForStates(NumStates);
+	Header.NumStates = NumStates;
+	// every kind keeps a switch step per cell, whether or not its states were packed ahead
+	Header.NumCells = SwitchStepBuffer.Num();
+	Header.NumAnts = AntPositions.Num();
+	Header.NextStep = NextStep;
+	Header.NumAntStates = Kind == ESnapshotKind::Ant ? NumAntStates : 0;
+
+	TArray64<uint8> Payload;
+	Payload.Reserve(PayloadSize(Header));
+	BuildPayload(Payload);
+	Header.RawPayloadSize = Payload.Num();
+
+	TArray<TArray<uint8>> Chunks;
+	if (bCompress)
+	{
+		Header.NumChunks = uint32((Payload.Num() + ChunkSize - 1) / ChunkSize);
+		Chunks.SetNum(Header.NumChunks);
+
+		TAtomic<bool> bFailed(false);
+		ParallelFor(Chunks.Num(), [&](int32 ChunkID)
+		{
+			int64 Offset = ChunkID * ChunkSize;
+			int32 RawSize = int32(FMath::Min(ChunkSize, Payload.Num() - Offset));
+
+			int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Zlib, RawSize);
+			Chunks[ChunkID].SetNumUninitialized(CompressedSize);
+
+			if (!FCompression::CompressMemory(NAME_Zlib, Chunks[ChunkID].GetData(), CompressedSize, Payload.GetData() + Offset, RawSize))
+			{
+				bFailed = true;
+			}
+			Chunks[ChunkID].SetNum(CompressedSize, false);
+		});
+
+		if (bFailed)
+		{
+			UE_LOG(LogAutomata, Error, TEXT("Failed to compress snapshot %s"), *Path);
+			return false;
+		}
+	}
+
+	// Write next to the destination and move into place, so a crash mid-write never leaves a torn snapshot.
+	// Each write has its own temporary, so saves racing to the same path never interleave
+	FString TempPath = FString::Printf(TEXT("%s.%s.tmp"), *Path, *FGuid::NewGuid().ToString());
+	TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*TempPath));
+	if (!Writer)
+	{
+		UE_LOG(LogAutomata, Error, TEXT("Could not open %s for writing"), *TempPath);
+		return false;
+	}
+
+	Writer->Serialize(&Header, sizeof(Header));
+
+	if (bCompress)
+	{
+		for (const TArray<uint8>& Chunk : Chunks)
+		{
+			uint64 CompressedSize = Chunk.Num();
+			Writer->Serialize(&CompressedSize, sizeof(CompressedSize));
+		}
+		for (TArray<uint8>& Chunk : Chunks)
+		{
+			Writer->Serialize(Chunk.GetData(), Chunk.Num());
+		}
+	}
+	else
+	{
+		Writer->Serialize(Payload.GetData(), Payload.Num());
+	}
+
+	bool bWritten = Writer->Close();
+	Writer.Reset();
+
+	if (!bWritten || !IFileManager::Get().Move(*Path, *TempPath))
+	{
+		UE_LOG(LogAutomata, Error, TEXT("Failed to write snapshot %s"), *Path);
+		IFileManager::Get().Delete(*TempPath);
+		return false;
+	}
+
+	return true;
+}
+
+bool FAutomataSnapshot::ReadFromFile(const FString& Path)
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+
+	// region is declared after the handle so that it is unmapped first
+	TUniquePtr<IMappedFileHandle> Handle(PlatformFile.OpenMapped(*Path));
+	if (!Handle)
+	{
+		UE_LOG(LogAutomata, Error, TEXT("Could not map snapshot %s"), *Path);
+		return false;
+	}
+
+	int64 FileSize = Handle->GetFileSize();
+	if (FileSize < int64(STRUCT_OFFSET(FAutomataSnapshotHeader, Kind)))
+	{
+		UE_LOG(LogAutomata, Error, TEXT("Snapshot %s is truncated"), *Path);
+		return false;
+	}
+
+	TUniquePtr<IMappedFileRegion> Region(Handle->MapRegion(0, FileSize));
+	if (!Region)
+	{
+		UE_LOG(LogAutomata, Error, TEXT("Could not map snapshot %s"), *Path);
+		return false;
+	}
+
+	const uint8* Data = Region->GetMappedPtr();
+
+	// magic and version come first in every version, and say how much of the rest is header
+	FAutomataSnapshotHeader Header;
+	FMemory::Memcpy(&Header, Data, STRUCT_OFFSET(FAutomataSnapshotHeader, Kind));
+
+	if (Header.Magic != Magic || Header.Version < 1 || Header.Version > Version)
+	{
+		UE_LOG(LogAutomata, Error, TEXT("%s is not a snapshot of version %u or earlier"), *Path, Version);
+		return false;
+	}
+
+	int64 HeaderBytes = HeaderSize(Header.Version);
+	if (FileSize < HeaderBytes)
+	{
+		UE_LOG(LogAutomata, Error, TEXT("Snapshot %s is truncated"), *Path);
+		return false;
+	}
+	FMemory::Memcpy(&Header, Data, HeaderBytes);
+
+	if (!IsHeaderValid(Header))
+	{
+		UE_LOG(LogAutomata, Error, TEXT("Snapshot %s has an inconsistent header"), *Path);
+		return false;
+	}
+
+	int64 ExpectedPayload = PayloadSize(Header);
+	if (int64(Header.RawPayloadSize) != ExpectedPayload)
+	{
+		UE_LOG(LogAutomata, Error, TEXT("Snapshot %s has an inconsistent header"), *Path);
+		return false;
+	}
+
+	const uint8* Body = Data + HeaderBytes;
+	int64 BodySize = FileSize - HeaderBytes;
+
+	if (!Header.bCompressed)
+	{
+		if (BodySize < ExpectedPayload)
+		{
+			UE_LOG(LogAutomata, Error, TEXT("Snapshot %s is truncated"), *Path);
+			return false;
+		}
+		return ReadPayload(Body, Header);
+	}
+
+	// the chunk count follows from the payload size, so extra chunks can't index past it
+	if (int64(Header.NumChunks) != FMath::DivideAndRoundUp<int64>(ExpectedPayload, ChunkSize))
+	{
+		UE_LOG(LogAutomata, Error, TEXT("Snapshot %s has an inconsistent header"), *Path);
+		return false;
+	}
+
+	int64 TableSize = int64(Header.NumChunks) * sizeof(uint64);
+	if (TableSize > BodySize)
+	{
+		UE_LOG(LogAutomata, Error, TEXT("Snapshot %s is truncated"), *Path);
+		return false;
+	}
+
+	const uint64* ChunkSizes = reinterpret_cast<const uint64*>(Body);
+
+	TArray<int64> ChunkOffsets;
+	ChunkOffsets.SetNumUninitialized(Header.NumChunks);
+
+	// each size is checked against what's left before it's added, so a corrupt table can't wrap the offset
+	int64 Offset = TableSize;
+	for (uint32 ChunkID = 0; ChunkID < Header.NumChunks; ++ChunkID)
+	{
+		if (ChunkSizes[ChunkID] > uint64(BodySize - Offset) || ChunkSizes[ChunkID] > uint64(MAX_int32))
+		{
+			UE_LOG(LogAutomata, Error, TEXT("Snapshot %s is truncated"), *Path);
+			return false;
+		}
+
+		ChunkOffsets[ChunkID] = Offset;
+		Offset += ChunkSizes[ChunkID];
+	}
+
+	TArray64<uint8> Payload;
+	Payload.SetNumUninitialized(Header.RawPayloadSize);
+
+	TAtomic<bool> bFailed(false);
+	ParallelFor(Header.NumChunks, [&](int32 ChunkID)
+	{
+		int64 RawOffset = int64(ChunkID) * ChunkSize;
+		int32 RawSize = int32(FMath::Min<int64>(ChunkSize, Payload.Num() - RawOffset));
+
+		if (!FCompression::UncompressMemory(NAME_Zlib, Payload.GetData() + RawOffset, RawSize, Body + ChunkOffsets[ChunkID], int32(ChunkSizes[ChunkID])))
+		{
+			bFailed = true;
+		}
+	});
+
+	if (bFailed)
+	{
+		UE_LOG(LogAutomata, Error, TEXT("Failed to decompress snapshot %s"), *Path);
+		return false;
+	}
+
+	return ReadPayload(Payload.GetData(), Header);
+}
+
+TFuture<bool> FAutomataSnapshot::WriteAsync(TSharedRef<const FAutomataSnapshot> Snapshot, const FString& Path, bool bCompress)
+{
+	return Async(EAsyncExecution::Thread, [Snapshot, Path, bCompress]()
+	{
+		return Snapshot->WriteToFile(Path, bCompress);
+	});
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+
+enum class ESnapshotKind : uint8
+{
+	Lifelike = 1,
+	Ant = 2
+};
+
+// Fixed-size file header. Everything after it is 8-byte aligned,
+// so packed words can be read straight out of a mapped file.
+struct FAutomataSnapshotHeader
+{
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	uint8 Kind = 0;
+	uint8 bCompressed = 0;
+	uint8 BitsPerCell = 1;
+	uint8 Padding = 0;
+	int32 NumStates = 0;
+	int32 NumCells = 0;
+	int32 NumAnts = 0;
+	float NextStep = 0;
+	// only used by compressed snapshots, each chunk is compressed independently
+	uint32 NumChunks = 0;
+	uint64 RawPayloadSize = 0;
+	// version 3 onwards, ant only: states in the turmite the ants were stepped by
+	int32 NumAntStates = 0;
+	uint32 Reserved = 0;
+};
+
+// Full simulation state of an automata, as written to and read from disk.
+// Layout: header, chunk table (compressed only), then the payload:
+// bit-packed states, switch steps, bit-packed eval flags (lifelike), ant positions, orientations and states (ant)
+struct FAutomataSnapshot
+{
+	static constexpr uint32 Magic = 0x4E534143; // "CASN"
+	// version 1 predates ant states, version 2 predates the ant state count in the header
+	static constexpr uint32 Version = 3;
+
+	// payload is split into chunks of this size before compression, so large grids compress in parallel
+	static constexpr int64 ChunkSize = 16 * 1024 * 1024;
+
+	ESnapshotKind Kind = ESnapshotKind::Lifelike;
+
+	int NumStates = 2;
+	float NextStep = 0;
+
+	// ant only, 0 when read from a snapshot older than version 3
+	int NumAntStates = 0;
+
+	TArray<int> CurrentStates;
+	TArray<float> SwitchStepBuffer;
+
+	// lifelike only: cells that need evaluating on the next step
+	TArray<bool> EvalFlags;
+
+	// If set, written in place of CurrentStates and EvalFlags. Packing while capturing keeps the copy taken
+	// between steps to a bit per cell, and is only used for writing; reads always fill the unpacked arrays
+	TArray<uint64> PackedStates;
+	TArray<uint64> PackedEvalFlags;
+
+	// ant only
+	TArray<int> AntPositions;
+	TArray<int> AntOrientations;
+	TArray<int> AntStates;
+
+	bool WriteToFile(const FString& Path, bool bCompress) const;
+
+	// maps the file rather than reading it, and unpacks straight from the mapped pages when uncompressed
+	bool ReadFromFile(const FString& Path);
+
+	// Encoding, compression and IO happen on a worker thread.
+	// The snapshot is owned by the task, so the caller's buffers are free to change as soon as this returns.
+	static TFuture<bool> WriteAsync(TSharedRef<const FAutomataSnapshot> Snapshot, const FString& Path, bool bCompress);
+
+private:
+
+	void BuildPayload(TArray64<uint8>& Payload) const;
+
+	bool ReadPayload(const uint8* Payload, const FAutomataSnapshotHeader& Header);
+
+	static int64 PayloadSize(const FAutomataSnapshotHeader& Header);
+
+	// headers before version 3 end at the payload size
+	static int64 HeaderSize(uint32 HeaderVersion);
+
+	// whether the header's counts are ones PayloadSize can be trusted with
+	static bool IsHeaderValid(const FAutomataSnapshotHeader& Header);
+};
@@ -0,0 +1,131 @@
+#include "AutomataStatistics.h"
+
+constexpr int FAutomataStatistics::TileSize;
+
+void FAutomataStatistics::Init(int NewNumXCells, int NewNumZCells, int NumStates)
+{
+	NumXCells = NewNumXCells;
+	NumZCells = NewNumZCells;
+	NumCells = NumXCells * NumZCells;
+	NumXTiles = FMath::DivideAndRoundUp(NumXCells, TileSize);
+	NumZTiles = FMath::DivideAndRoundUp(NumZCells, TileSize);
+
+	StateCounts.Init(0, FMath::Max(NumStates, 2));
+	Counted.Init(0, NumCells);
+	ResetCounts();
+}
+
+void FAutomataStatistics::ResetCounts()
+{
+	for (int& Count : StateCounts)
+	{
+		Count = 0;
+	}
+	StateCounts[0] = NumCells;
+
+	TileCounts.Init(0, NumXTiles * NumZTiles);
+	RowCounts.Init(0, NumZCells);
+	ColumnCounts.Init(0, NumXCells);
+}
+
+void FAutomataStatistics::AddCell(int CellID, int State, int Sign)
+{
+	StateCounts[State] += Sign;
+
+	if (State != 0)
+	{
+		int X = CellID % NumXCells;
+		int Z = CellID / NumXCells;
+
+		TileCounts[TileOf(X, Z)] += Sign;
+		RowCounts[Z] += Sign;
+		ColumnCounts[X] += Sign;
+	}
+}
+
+void FAutomataStatistics::Rebuild(const TArray<int>& States)
+{
+	check(States.Num() == NumCells);
+
+	ResetCounts();
+	StateCounts[0] = 0;
+
+	for (int CellID = 0; CellID < NumCells; ++CellID)
+	{
+		int State = FMath::Clamp(States[CellID], 0, StateCounts.Num() - 1);
+		Counted[CellID] = uint8(State);
+		AddCell(CellID, State, 1);
+	}
+}
+
+void FAutomataStatistics::ApplyChanges(const TArray<int>& States, TArrayView<const int> ChangedCells)
+{
+	for (int CellID : ChangedCells)
+	{
+		int State = FMath::Clamp(States[CellID], 0, StateCounts.Num() - 1);
+		int OldState = Counted[CellID];
+
+		if (State != OldState)
+		{
+			AddCell(CellID, OldState, -1);
+			AddCell(CellID, State, 1);
+			Counted[CellID] = uint8(State);
+		}
+	}
+}
+
+bool FAutomataStatistics::GetBoundingBox(FIntPoint& OutMin, FIntPoint& OutMax) const
+{
+	int MinZ = RowCounts.IndexOfByPredicate([](int Count) { return Count > 0; });
+	if (MinZ == INDEX_NONE)
+	{
+		return false;
+	}
+
+	int MaxZ = NumZCells - 1;
+	while (RowCounts[MaxZ] == 0)
+	{
+		--MaxZ;
+	}
+
+	int MinX = ColumnCounts.IndexOfByPredicate([](int Count) { return Count > 0; });
+	int MaxX = NumXCells - 1;
+	while (ColumnCounts[MaxX] == 0)
+	{
+		--MaxX;
+	}
+
+	OutMin = FIntPoint(MinX, MinZ);
+	OutMax = FIntPoint(MaxX, MaxZ);
+	return true;
+}
+
+int FAutomataStatistics::GetTilePopulation(int TileX, int TileZ) const
+{
+	if (TileX < 0 || TileZ < 0 || TileX >= NumXTiles || TileZ >= NumZTiles)
+	{
+		return 0;
+	}
+	return TileCounts[TileZ * NumXTiles + TileX];
+}
+
+float FAutomataStatistics::GetRegionDensity(FIntPoint MinTile, FIntPoint MaxTile) const
+{
+	MinTile = FIntPoint(FMath::Max(MinTile.X, 0), FMath::Max(MinTile.Y, 0));
+	MaxTile = FIntPoint(FMath::Min(MaxTile.X, NumXTiles - 1), FMath::Min(MaxTile.Y, NumZTiles - 1));
+
+	int Population = 0;
+	int Area = 0;
+
+	for (int TileZ = MinTile.Y; TileZ <= MaxTile.Y; ++TileZ)
+	{
+		int Height = FMath::Min(TileSize, NumZCells - TileZ * TileSize);
+		for (int TileX = MinTile.X; TileX <= MaxTile.X; ++TileX)
+		{
+			Population += TileCounts[TileZ * NumXTiles + TileX];
+			Area += Height * FMath::Min(TileSize, NumXCells - TileX * TileSize);
+		}
+	}
+
+	return Area > 0 ? float(Population) / Area : 0;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Population statistics kept up to date from the cells that change each step, instead of by scanning the board.
+// Has no engine dependencies beyond Core, so headless runs can use it as well as the step driver.
+// Cells are grouped into square tiles of TileSize, counted row-major from the top-left of the grid.
+class FAutomataStatistics
+{
+public:
+
+	static constexpr int TileSize = 32;
+
+	void Init(int NumXCells, int NumZCells, int NumStates);
+
+	// full recount, for when the change set isn't known
+	void Rebuild(const TArray<int>& States);
+
+	// Brings the counts up to date with States, looking only at ChangedCells.
+	// ChangedCells may contain duplicates and cells that didn't actually change.
+	void ApplyChanges(const TArray<int>& States, TArrayView<const int> ChangedCells);
+
+	// number of cells in a nonzero state
+	int GetPopulation() const { return NumCells - StateCounts[0]; }
+
+	int GetStateCount(int State) const { return StateCounts.IsValidIndex(State) ? StateCounts[State] : 0; }
+
+	const TArray<int>& GetHistogram() const { return StateCounts; }
+
+	// Inclusive cell bounds of every nonzero cell, in O(rows + columns).
+	// Returns false if there are none
+	bool GetBoundingBox(FIntPoint& OutMin, FIntPoint& OutMax) const;
+
+	int GetNumXTiles() const { return NumXTiles; }
+	int GetNumZTiles() const { return NumZTiles; }
+
+	int GetTilePopulation(int TileX, int TileZ) const;
+
+	// fraction of nonzero cells over the inclusive tile range, in O(tiles)
+	float GetRegionDensity(FIntPoint MinTile, FIntPoint MaxTile) const;
+
+private:
+
+	int NumXCells = 0;
+	int NumZCells = 0;
+	int NumCells = 0;
+	int NumXTiles = 0;
+	int NumZTiles = 0;
+
+	// state of each cell as of the last update, so a change can be undone from the counts
+	TArray<uint8> Counted;
+
+	TArray<int> StateCounts;
+
+	// nonzero cells per tile, row and column
+	TArray<int> TileCounts;
+	TArray<int> RowCounts;
+	TArray<int> ColumnCounts;
+
+	int TileOf(int X, int Z) const { return (Z / TileSize) * NumXTiles + X / TileSize; }
+
+	void ResetCounts();
+
+	void AddCell(int CellID, int State, int Sign);
+};
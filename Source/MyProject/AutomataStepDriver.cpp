@@ -1,30 +1,247 @@
 #include "AutomataStepDriver.h"
 
+#include "Async/Async.h"
+
 #include "AutomataInterface.h"
 
 DECLARE_EVENT(UAutomataStepDriver, DriverStepEvent)
 
 void UAutomataStepDriver::TimerFired()
 {
-	Automata->StepComplete();
+	// the batch ran the frame's earlier steps while the last frame was shown, and left its last in flight
+	WaitForBatch();
+	CompleteStep();
+
+	if (Statistics)
+	{
+		UpdateStatistics();
+	}
+
+	if (FrameAggregate)
+	{
+		FrameAggregate->PublishFrame();
+	}
+
+	for (TFunction<void()>& Task : BetweenStepTasks)
+	{
+		Task();
+	}
+	BetweenStepTasks.Reset();
+
+	// A cell that was born and died between broadcasts still shows, since its switch step is that of its death
 	Automata->BroadcastData();
-	Automata->StartNewStep();
+
+	StartBatch();
+}
+
+void UAutomataStepDriver::StartBatch()
+{
+	// a load since the last step leaves no change log, and the next step's log won't cover it
+	if (SharedExport && Automata->GetChangedCells() == nullptr)
+	{
+		SharedExport->Invalidate();
+	}
+
+	if (StepsPerFrame == 1)
+	{
+		Automata->StartNewStep();
+		return;
+	}
+
+	int NumSteps = StepsPerFrame;
+	Batch = Async(EAsyncExecution::ThreadPool, [this, NumSteps]()
+	{
+		for (int Step = 1; Step < NumSteps; ++Step)
+		{
+			Automata->StartNewStep();
+			CompleteStep();
+		}
+		Automata->StartNewStep();
+	});
+}
+
+void UAutomataStepDriver::WaitForBatch()
+{
+	if (Batch.IsValid())
+	{
+		Batch.Wait();
+		Batch.Reset();
+	}
+}
+
+void UAutomataStepDriver::CompleteStep()
+{
+	Automata->StepComplete();
+
+	if (Statistics && bFrameChangesKnown)
+	{
+		const TArray<int>* ChangedCells = Automata->GetChangedCells();
+		bFrameChangesKnown = ChangedCells != nullptr && FrameChangedCells.Num() + ChangedCells->Num() <= Automata->GetBaseMembers()->CurrentStates.Num();
+		if (bFrameChangesKnown)
+		{
+			FrameChangedCells.Append(*ChangedCells);
+		}
+	}
+
+	if (FrameAggregate)
+	{
+		UpdateFrameAggregate();
+	}
+
+	if (Recorder)
+	{
+		Automata->CatchUpSwitchSteps();
+		Recorder->RecordFrame(*Automata->GetBaseMembers());
+	}
+
+	if (SharedExport)
+	{
+		SharedExport->Publish(*Automata->GetBaseMembers(), Automata->GetChangedCells());
+	}
 }
 
 void UAutomataStepDriver::BeginDestroy()
 {
 	Super::BeginDestroy();
 
+	WaitForBatch();
+	StopRecording();
+	StopSharedExport();
+
 	if (GEngine)
 		GEngine->AddOnScreenDebugMessage(-1, 15.0f, FColor::Yellow, "Aggggh I'm being destroyed noooo");
 }
 
 void UAutomataStepDriver::SetAutomata(IAutomata* newAutomata)
 {
+	WaitForBatch();
 	Automata = newAutomata;
 }
 
-void UAutomataStepDriver::SetTimer(float StepPeriod)
+bool UAutomataStepDriver::StartSharedExport(const FString& Name, int NumSlots)
+{
+	const FBaseAutomataStruct* BaseMembers = Automata->GetBaseMembers();
+	if (BaseMembers == nullptr)
+	{
+		return false;
+	}
+
+	WaitForBatch();
+	SharedExport = MakeUnique<FSharedStateExport>();
+	if (!SharedExport->Open(Name, BaseMembers->CurrentStates.Num(), Automata->GetNumStates(), NumSlots))
+	{
+		SharedExport.Reset();
+		return false;
+	}
+
+	SharedExport->Publish(*BaseMembers, nullptr);
+	return true;
+}
+
+void UAutomataStepDriver::StopSharedExport()
+{
+	WaitForBatch();
+	SharedExport.Reset();
+}
+
+void UAutomataStepDriver::EnableStatistics(int NumXCells, int NumZCells)
+{
+	WaitForBatch();
+	Statistics = MakeUnique<FAutomataStatistics>();
+	Statistics->Init(NumXCells, NumZCells, Automata->GetNumStates());
+	Statistics->Rebuild(Automata->GetBaseMembers()->CurrentStates);
+	FrameChangedCells.Reset();
+	bFrameChangesKnown = true;
+}
+
+void UAutomataStepDriver::UpdateStatistics()
+{
+	const TArray<int>& States = Automata->GetBaseMembers()->CurrentStates;
+
+	// ApplyChanges looks at each cell's state now, so one pass over the frame's changes covers all its steps
+	if (bFrameChangesKnown)
+	{
+		Statistics->ApplyChanges(States, FrameChangedCells);
+	}
+	else
+	{
+		Statistics->Rebuild(States);
+	}
+
+	FrameChangedCells.Reset();
+	bFrameChangesKnown = true;
+}
+
+void UAutomataStepDriver::EnableFrameAggregate()
+{
+	const FBaseAutomataStruct* BaseMembers = Automata != nullptr ? Automata->GetBaseMembers() : nullptr;
+	if (BaseMembers == nullptr)
+	{
+		return;
+	}
+
+	WaitForBatch();
+	FrameAggregate = MakeUnique<FAutomataFrameAggregate>();
+	FrameAggregate->Reset(BaseMembers->CurrentStates, int(BaseMembers->NextStep));
+}
+
+void UAutomataStepDriver::UpdateFrameAggregate()
+{
+	const FBaseAutomataStruct* BaseMembers = Automata->GetBaseMembers();
+	const TArray<int>& States = BaseMembers->CurrentStates;
+
+	// the step's changes were made on the step before the one the automata is now at
+	int Step = int(BaseMembers->NextStep) - 1;
+
+	// a load or a resize between steps leaves nothing to fold the changes into
+	const TArray<int>* ChangedCells = Automata->GetChangedCells();
+	if (ChangedCells != nullptr && States.Num() == FrameAggregate->GetNumCells())
+	{
+		FrameAggregate->AddStep(States, *ChangedCells, Step);
+	}
+	else
+	{
+		FrameAggregate->Reset(States, Step);
+	}
+}
+
+void UAutomataStepDriver::RunBetweenSteps(TFunction<void()> Task)
+{
+	BetweenStepTasks.Add(MoveTemp(Task));
+}
+
+bool UAutomataStepDriver::StartRecording(const FString& Path, int KeyframeInterval)
+{
+	const FBaseAutomataStruct* BaseMembers = Automata != nullptr ? Automata->GetBaseMembers() : nullptr;
+	if (BaseMembers == nullptr)
+	{
+		return false;
+	}
+
+	WaitForBatch();
+	Automata->CatchUpSwitchSteps();
+
+	Recorder = MakeUnique<FAutomataRecorder>();
+	if (!Recorder->Open(Path, BaseMembers->CurrentStates.Num(), Automata->GetNumStates(), KeyframeInterval, Automata->BroadcastsStates()))
+	{
+		Recorder.Reset();
+		return false;
+	}
+
+	Recorder->RecordFrame(*BaseMembers);
+	return true;
+}
+
+void UAutomataStepDriver::StopRecording()
+{
+	// closing writes the seek index
+	WaitForBatch();
+	Recorder.Reset();
+}
+
+void UAutomataStepDriver::SetTimer(float StepPeriod, int InStepsPerFrame)
 {
-	GetWorld()->GetTimerManager().SetTimer(StepTimer, this, &UAutomataStepDriver::TimerFired, StepPeriod, true);
+	WaitForBatch();
+	StepsPerFrame = FMath::Max(1, InStepsPerFrame);
+	GetWorld()->GetTimerManager().SetTimer(StepTimer, this, &UAutomataStepDriver::TimerFired, StepPeriod * StepsPerFrame, true);
 }
\ No newline at end of file
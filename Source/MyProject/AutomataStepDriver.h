@@ -1,5 +1,11 @@
 #pragma once
 
+#include "Async/Future.h"
+
+#include "AutomataFrameAggregate.h"
+#include "AutomataRecorder.h"
+#include "AutomataSharedExport.h"
+#include "AutomataStatistics.h"
 #include "AutomataStepDriver.generated.h"
 
 class IAutomata;
@@ -14,7 +20,35 @@ class MYPROJECT_API UAutomataStepDriver : public UObject
 	public:
 
 	void SetAutomata(IAutomata* newAutomata);
-	void SetTimer(float StepPeriod);
+
+	// Fires every StepPeriod * StepsPerFrame seconds, running StepsPerFrame steps and broadcasting once.
+	// All but the last of a frame's steps run on a pool thread while the previous frame is shown,
+	// so the game thread only waits on the last. Recording, export and the frame aggregate still see every step
+	void SetTimer(float StepPeriod, int StepsPerFrame = 1);
+
+	// queues work to run once the frame's last step has completed and before the next frame's steps start,
+	// when it is safe to read or replace the automata's buffers
+	void RunBetweenSteps(TFunction<void()> Task);
+
+	// records the current state immediately, then every completed step until stopped
+	bool StartRecording(const FString& Path, int KeyframeInterval);
+	void StopRecording();
+
+	// publishes the current state immediately, then every completed step, to a named shared memory ring
+	bool StartSharedExport(const FString& Name, int NumSlots);
+	void StopSharedExport();
+
+	// counts the current states, then keeps the counts updated from each frame's changes
+	void EnableStatistics(int NumXCells, int NumZCells);
+
+	// nullptr unless statistics are enabled
+	const FAutomataStatistics* GetStatistics() const { return Statistics.Get(); }
+
+	// folds each frame's steps into per-cell activity, published once the frame's last step completes
+	void EnableFrameAggregate();
+
+	// nullptr unless the frame aggregate is enabled. Safe to read from the game thread at any time
+	const FAutomataFrameAggregate* GetFrameAggregate() const { return FrameAggregate.Get(); }
 
 	private:
 
@@ -22,6 +56,40 @@ class MYPROJECT_API UAutomataStepDriver : public UObject
 
 	IAutomata* Automata;
 
+	TArray<TFunction<void()>> BetweenStepTasks;
+
+	TUniquePtr<FAutomataRecorder> Recorder;
+
+	TUniquePtr<FAutomataStatistics> Statistics;
+
+	TUniquePtr<FSharedStateExport> SharedExport;
+
+	TUniquePtr<FAutomataFrameAggregate> FrameAggregate;
+
+	// Cells changed by the frame's steps so far, duplicates allowed, for the statistics to catch up on once a frame.
+	// Unknown once any step's changes are, or once there are more than a full recount would look at
+	TArray<int> FrameChangedCells;
+	bool bFrameChangesKnown = true;
+
+	int StepsPerFrame = 1;
+
+	// the steps of the next frame, bar the last which it leaves in flight
+	TFuture<void> Batch;
+
+	void UpdateStatistics();
+
+	void UpdateFrameAggregate();
+
+	// finishes the step in flight, and hands it to everything that looks at each step. Runs on the batch's thread
+	void CompleteStep();
+
+	// starts the next frame's steps, running any before its last off the game thread
+	void StartBatch();
+
+	// Anything that touches what CompleteStep does from the game thread waits for the batch first.
+	// Afterwards only the frame's last step is in flight, as it is between timer fires with a single step per frame
+	void WaitForBatch();
+
 	void TimerFired();
 
 	
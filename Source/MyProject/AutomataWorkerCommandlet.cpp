@@ -0,0 +1,54 @@
+#include "AutomataWorkerCommandlet.h"
+
+#include "DistributedAutomata.h"
+#include "MyProject.h"
+
+int32 UAutomataWorkerCommandlet::Main(const FString& Params)
+{
+	FDistributedConfig Config;
+	int32 NumSteps = 100;
+
+	FParse::Value(*Params, TEXT("Rank="), Config.Rank);
+	FParse::Value(*Params, TEXT("Ranks="), Config.NumRanks);
+	FParse::Value(*Params, TEXT("Port="), Config.BasePort);
+	FParse::Value(*Params, TEXT("X="), Config.Grid.NumXCells);
+	FParse::Value(*Params, TEXT("Z="), Config.Grid.NumZCells);
+	FParse::Value(*Params, TEXT("Birth="), Config.BirthString);
+	FParse::Value(*Params, TEXT("Survive="), Config.SurviveString);
+	FParse::Value(*Params, TEXT("Probability="), Config.Probability);
+	FParse::Value(*Params, TEXT("Seed="), Config.Seed);
+	FParse::Value(*Params, TEXT("Record="), Config.RecordingPath);
+	FParse::Value(*Params, TEXT("GatherEvery="), Config.GatherInterval);
+	FParse::Value(*Params, TEXT("WindowX="), Config.GatherOrigin.X);
+	FParse::Value(*Params, TEXT("WindowZ="), Config.GatherOrigin.Y);
+	FParse::Value(*Params, TEXT("WindowWidth="), Config.GatherXCells);
+	FParse::Value(*Params, TEXT("WindowHeight="), Config.GatherZCells);
+	FParse::Value(*Params, TEXT("Steps="), NumSteps);
+
+	FString Name;
+	if (FParse::Value(*Params, TEXT("Shape="), Name))
+	{
+		int64 Value = StaticEnum<CellShape>()->GetValueByNameString(Name);
+		Config.Grid.Shape = Value != INDEX_NONE ? CellShape(Value) : Config.Grid.Shape;
+	}
+	if (FParse::Value(*Params, TEXT("Rule="), Name))
+	{
+		int64 Value = StaticEnum<BoundGridRuleset>()->GetValueByNameString(Name);
+		Config.GridRule = Value != INDEX_NONE ? BoundGridRuleset(Value) : Config.GridRule;
+	}
+
+	if (Config.NumRanks < 1 || Config.Rank < 0 || Config.Rank >= Config.NumRanks || Config.Grid.NumZCells < Config.NumRanks)
+	{
+		UE_LOG(LogAutomata, Error, TEXT("Rank %d of %d can't split %d rows"), Config.Rank, Config.NumRanks, Config.Grid.NumZCells);
+		return 1;
+	}
+
+	FDistributedLife Simulation(Config);
+	if (!Simulation.Connect() || !Simulation.Run(NumSteps))
+	{
+		return 1;
+	}
+
+	UE_LOG(LogAutomata, Log, TEXT("Rank %d finished %d steps"), Config.Rank, NumSteps);
+	return 0;
+}
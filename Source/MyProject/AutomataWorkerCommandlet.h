@@ -0,0 +1,20 @@
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+#include "AutomataWorkerCommandlet.generated.h"
+
+// Runs one rank of a distributed lifelike simulation, with no display. For four local processes, launch
+//   UE4Editor-Cmd MyProject -run=AutomataWorker -Rank=N -Ranks=4 -X=4096 -Z=4096 -Steps=1000 -Record=Board.rec -GatherEvery=10
+// once for each N from 0 to 3. Rank 0 records a gathered window of the board, 512x512 from the top-left unless
+// -WindowX= -WindowZ= -WindowWidth= -WindowHeight= say otherwise, which the factory plays back through ReplayPath.
+// Nothing is gathered without -GatherEvery=.
+// Other options: -Port= -Shape=Square|Hex -Rule=Torus|Finite|... -Birth= -Survive= -Probability= -Seed=
+UCLASS()
+class UAutomataWorkerCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,254 @@
+#include "AutomataWorkerPool.h"
+
+#include "AutomataNuma.h"
+#include "HAL/RunnableThread.h"
+#include "MyProject.h"
+
+namespace
+{
+	// Ranges carry the low bits of their job's generation beside Begin and End, so a participant still
+	// looking for work from a finished job can't pop or steal from the next job's ranges
+	constexpr int RangeBits = 24;
+	constexpr uint64 RangeMask = (uint64(1) << RangeBits) - 1;
+
+	uint64 PackRange(uint32 Stamp, uint32 Begin, uint32 End)
+	{
+		return uint64(Begin) | (uint64(End) << RangeBits) | (uint64(Stamp) << (2 * RangeBits));
+	}
+
+	uint32 RangeBegin(uint64 Packed)
+	{
+		return uint32(Packed & RangeMask);
+	}
+
+	uint32 RangeEnd(uint64 Packed)
+	{
+		return uint32((Packed >> RangeBits) & RangeMask);
+	}
+
+	uint32 RangeStamp(uint64 Packed)
+	{
+		return uint32(Packed >> (2 * RangeBits));
+	}
+
+	uint32 StampOf(uint32 Generation)
+	{
+		return Generation & 0xFFFF;
+	}
+}
+
+FAutomataWorkerPool::FAutomataWorkerPool(int NumThreads, bool bPinThreads)
+{
+	if (NumThreads <= 0)
+	{
+		NumThreads = FPlatformMisc::NumberOfCores();
+	}
+
+	// the caller runs the last slot
+	int NumWorkers = FMath::Max(NumThreads - 1, 0);
+	Ranges.SetNum(NumWorkers + 1);
+
+	TArray<TArray<int>> NodeCores;
+	if (bPinThreads)
+	{
+		NodeCores = AutomataNuma::GetNodeCores();
+	}
+
+	int NumUnpinned = 0;
+	for (int Slot = 0; Slot < NumWorkers; ++Slot)
+	{
+		TUniquePtr<FWorker>& Worker = Workers.Add_GetRef(MakeUnique<FWorker>(*this, Slot));
+		Worker->Wake = FPlatformProcess::GetSynchEventFromPool(false);
+
+		uint64 Affinity = FPlatformAffinity::GetNoAffinityMask();
+		if (bPinThreads)
+		{
+			int Core = PinnedCore(NodeCores, Slot, NumWorkers);
+			if (Core < 64)
+			{
+				Affinity = uint64(1) << Core;
+			}
+			else
+			{
+				++NumUnpinned;
+			}
+		}
+
+		Worker->Thread = FRunnableThread::Create(Worker.Get(), *FString::Printf(TEXT("AutomataWorker%d"), Slot), 0, TPri_Normal, Affinity);
+	}
+
+	if (NumUnpinned > 0)
+	{
+		UE_LOG(LogAutomata, Warning, TEXT("%d of %d workers fall on cores past the first 64, which affinity masks can't reach, and run unpinned"), NumUnpinned, NumWorkers);
+	}
+}
+
+int FAutomataWorkerPool::PinnedCore(const TArray<TArray<int>>& NodeCores, int Slot, int NumWorkers)
+{
+	// Slots are split into contiguous groups, one per node, so the contiguous task ranges
+	// they start each job with fall on the same node every time
+	int NumNodes = NodeCores.Num();
+	int Node = int(int64(Slot) * NumNodes / NumWorkers);
+	int FirstSlot = int((int64(Node) * NumWorkers + NumNodes - 1) / NumNodes);
+	const TArray<int>& Cores = NodeCores[Node];
+
+	// the first node's first core is left to the calling thread, unless there's no room for it
+	int Skip = (Node == 0 && Cores.Num() > 1) ? 1 : 0;
+	return Cores[Skip + (Slot - FirstSlot) % (Cores.Num() - Skip)];
+}
+
+FAutomataWorkerPool::~FAutomataWorkerPool()
+{
+	Wait();
+
+	bStopping = true;
+	for (TUniquePtr<FWorker>& Worker : Workers)
+	{
+		Worker->Wake->Trigger();
+	}
+
+	for (TUniquePtr<FWorker>& Worker : Workers)
+	{
+		Worker->Thread->WaitForCompletion();
+		delete Worker->Thread;
+		FPlatformProcess::ReturnSynchEventToPool(Worker->Wake);
+	}
+}
+
+void FAutomataWorkerPool::Launch(int NumTasks, TFunction<void(int32)> Task)
+{
+	LaunchJob(NumTasks, MoveTemp(Task), true);
+}
+
+void FAutomataWorkerPool::LaunchJob(int NumTasks, TFunction<void(int32)> Task, bool bAllowStealing)
+{
+	if (NumTasks <= 0)
+	{
+		return;
+	}
+	check(uint64(NumTasks) <= RangeMask);
+
+	// the job is published before any range, so a task can't be found before its function
+	Job = MoveTemp(Task);
+	Remaining = NumTasks;
+	bStealing = bAllowStealing;
+
+	// without stealing, the calling thread gets no share, so every task runs on the worker that owns it
+	int NumSlots = Ranges.Num();
+	int NumShares = bAllowStealing || Workers.Num() == 0 ? NumSlots : NumSlots - 1;
+	uint32 Stamp = StampOf(Generation.Load() + 1);
+	for (int Slot = 0; Slot < NumSlots; ++Slot)
+	{
+		uint32 Begin = uint32(int64(NumTasks) * FMath::Min(Slot, NumShares) / NumShares);
+		uint32 End = uint32(int64(NumTasks) * FMath::Min(Slot + 1, NumShares) / NumShares);
+		Ranges[Slot].Packed = PackRange(Stamp, Begin, End);
+	}
+
+	// the ranges are only taken from once this reaches the workers, under the stamp they carry
+	++Generation;
+	for (TUniquePtr<FWorker>& Worker : Workers)
+	{
+		Worker->Wake->Trigger();
+	}
+}
+
+void FAutomataWorkerPool::Wait()
+{
+	RunTasks(Ranges.Num() - 1, StampOf(Generation.Load()));
+
+	// the last tasks may still be running on workers
+	while (Remaining.Load() > 0)
+	{
+		FPlatformProcess::Yield();
+	}
+}
+
+void FAutomataWorkerPool::ParallelFor(int NumTasks, TFunction<void(int32)> Task)
+{
+	Launch(NumTasks, MoveTemp(Task));
+	Wait();
+}
+
+void FAutomataWorkerPool::RunOnOwners(int NumTasks, TFunction<void(int32)> Task)
+{
+	LaunchJob(NumTasks, MoveTemp(Task), false);
+	Wait();
+}
+
+bool FAutomataWorkerPool::Pop(int Slot, uint32 Stamp, int32& OutTask)
+{
+	TAtomic<uint64>& Range = Ranges[Slot].Packed;
+	uint64 Packed = Range.Load();
+
+	while (RangeStamp(Packed) == Stamp && RangeBegin(Packed) < RangeEnd(Packed))
+	{
+		if (Range.CompareExchange(Packed, PackRange(Stamp, RangeBegin(Packed) + 1, RangeEnd(Packed))))
+		{
+			OutTask = int32(RangeBegin(Packed));
+			return true;
+		}
+	}
+	return false;
+}
+
+bool FAutomataWorkerPool::Steal(int Slot, uint32 Stamp, int32& OutTask)
+{
+	if (!bStealing)
+	{
+		return false;
+	}
+
+	int NumSlots = Ranges.Num();
+
+	for (int Offset = 1; Offset < NumSlots; ++Offset)
+	{
+		TAtomic<uint64>& Victim = Ranges[(Slot + Offset) % NumSlots].Packed;
+		uint64 Packed = Victim.Load();
+
+		while (RangeStamp(Packed) == Stamp && RangeBegin(Packed) < RangeEnd(Packed))
+		{
+			uint32 Begin = RangeBegin(Packed);
+			uint32 End = RangeEnd(Packed);
+			uint32 Middle = Begin + (End - Begin) / 2;
+
+			// The victim keeps [Begin, Middle), the thief runs Middle and keeps the rest.
+			// The job can't finish while Middle is unrun, so nothing relaunches over the thief's own range meanwhile
+			if (Victim.CompareExchange(Packed, PackRange(Stamp, Begin, Middle)))
+			{
+				Ranges[Slot].Packed = PackRange(Stamp, Middle + 1, End);
+				OutTask = int32(Middle);
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void FAutomataWorkerPool::RunTasks(int Slot, uint32 Stamp)
+{
+	int32 Task;
+	while (Pop(Slot, Stamp, Task) || Steal(Slot, Stamp, Task))
+	{
+		Job(Task);
+		--Remaining;
+	}
+}
+
+uint32 FAutomataWorkerPool::FWorker::Run()
+{
+	uint32 SeenGeneration = 0;
+
+	while (!Pool.bStopping)
+	{
+		uint32 Current = Pool.Generation.Load();
+		if (Current == SeenGeneration)
+		{
+			Wake->Wait();
+			continue;
+		}
+
+		SeenGeneration = Current;
+		Pool.RunTasks(Slot, StampOf(Current));
+	}
+	return 0;
+}
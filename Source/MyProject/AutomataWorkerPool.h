@@ -0,0 +1,85 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+
+class FRunnableThread;
+
+// Persistent threads that run one job of indexed tasks at a time.
+// Each participant starts with an even share of the indices as a range, pops from its front,
+// and once empty steals the back half of another participant's range. Ranges are single
+// 64-bit words updated by compare-and-swap, so neither popping nor stealing takes a lock.
+// A job holds at most 2^24 tasks.
+// Threads stay alive between jobs, so launching a step costs a wake-up rather than a task graph dispatch.
+class FAutomataWorkerPool
+{
+public:
+
+	// NumThreads counts the thread that calls Wait, which steps a share of each job, so one fewer workers are started.
+	// 0 threads picks one per core, the caller's included.
+	// Pinned workers are each given their own core, filling NUMA nodes in order, so that
+	// neighbouring slots (and the neighbouring task ranges they start with) share a node.
+	// Affinity masks only reach the first 64 cores, so workers whose core lies past them aren't pinned
+	explicit FAutomataWorkerPool(int NumThreads = 0, bool bPinThreads = false);
+	~FAutomataWorkerPool();
+
+	// threads a job runs on, the caller's included
+	int GetNumThreads() const { return Workers.Num() + 1; }
+
+	// Starts running Task for every index in [0, NumTasks) and returns immediately.
+	// The previous job must have been waited for
+	void Launch(int NumTasks, TFunction<void(int32)> Task);
+
+	// helps with the launched job until every task has run
+	void Wait();
+
+	// Launch, then Wait
+	void ParallelFor(int NumTasks, TFunction<void(int32)> Task);
+
+	// Like ParallelFor, but every task runs on the worker whose share it starts in, with no stealing
+	// and nothing run by the caller. Memory first touched here is placed on the node of the worker
+	// that will usually step it
+	void RunOnOwners(int NumTasks, TFunction<void(int32)> Task);
+
+private:
+
+	class FWorker : public FRunnable
+	{
+	public:
+		FWorker(FAutomataWorkerPool& InPool, int InSlot) : Pool(InPool), Slot(InSlot) {}
+
+		uint32 Run() override;
+
+		FAutomataWorkerPool& Pool;
+		int Slot;
+		FEvent* Wake = nullptr;
+		FRunnableThread* Thread = nullptr;
+	};
+
+	// a participant's remaining range: Begin, End and the stamp of the job it belongs to, from the low bits up
+	struct alignas(PLATFORM_CACHE_LINE_SIZE) FRange
+	{
+		TAtomic<uint64> Packed{ 0 };
+	};
+
+	TArray<TUniquePtr<FWorker>> Workers;
+
+	// one per worker, plus a last one for whichever thread calls Wait
+	TArray<FRange> Ranges;
+
+	TFunction<void(int32)> Job;
+	TAtomic<int32> Remaining{ 0 };
+	TAtomic<uint32> Generation{ 0 };
+	TAtomic<bool> bStopping{ false };
+	TAtomic<bool> bStealing{ true };
+
+	static int PinnedCore(const TArray<TArray<int>>& NodeCores, int Slot, int NumWorkers);
+
+	void LaunchJob(int NumTasks, TFunction<void(int32)> Task, bool bAllowStealing);
+
+	// both only take from ranges carrying Stamp, the job the participant joined
+	bool Pop(int Slot, uint32 Stamp, int32& OutTask);
+	bool Steal(int Slot, uint32 Stamp, int32& OutTask);
+
+	void RunTasks(int Slot, uint32 Stamp);
+};
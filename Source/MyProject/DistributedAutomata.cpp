@@ -0,0 +1,597 @@
+#include "DistributedAutomata.h"
+
+#include "Algo/BinarySearch.h"
+#include "AutomataFactory.h"
+#include "AutomataRandom.h"
+#include "AutomataRecorder.h"
+#include "Common/TcpSocketBuilder.h"
+#include "HenselNotation.h"
+#include "Interfaces/IPv4/IPv4Endpoint.h"
+#include "LifeLanes.h"
+#include "MyProject.h"
+#include "Rulesets.h"
+#include "Sockets.h"
+#include "SocketSubsystem.h"
+
+namespace
+{
+	bool SendAll(FSocket* Socket, const uint8* Data, int64 NumBytes)
+	{
+		while (NumBytes > 0)
+		{
+			int32 Sent = 0;
+			if (!Socket->Send(Data, int32(FMath::Min<int64>(NumBytes, MAX_int32)), Sent))
+			{
+				return false;
+			}
+			Data += Sent;
+			NumBytes -= Sent;
+		}
+		return true;
+	}
+
+	bool ReceiveAll(FSocket* Socket, uint8* Data, int64 NumBytes)
+	{
+		while (NumBytes > 0)
+		{
+			int32 Read = 0;
+			if (!Socket->Recv(Data, int32(FMath::Min<int64>(NumBytes, MAX_int32)), Read, ESocketReceiveFlags::WaitAll) || Read == 0)
+			{
+				return false;
+			}
+			Data += Read;
+			NumBytes -= Read;
+		}
+		return true;
+	}
+
+	// Sends each peer its buffer from the thread pool while receiving, so two ranks
+	// sending to each other can't both block on full socket buffers.
+	// Incoming buffers must already be sized to what each peer sends
+	bool Exchange(const TArray<FSocket*>& Peers, const TArray<TArray<uint8>>& Outgoing, TArray<TArray<uint8>>& Incoming)
+	{
+		TArray<TFuture<bool>> Sends;
+		for (int Rank = 0; Rank < Peers.Num(); ++Rank)
+		{
+			if (Peers[Rank] != nullptr && Outgoing[Rank].Num() > 0)
+			{
+				FSocket* Socket = Peers[Rank];
+				const TArray<uint8>* Buffer = &Outgoing[Rank];
+				Sends.Add(Async(EAsyncExecution::ThreadPool, [Socket, Buffer]()
+				{
+					return SendAll(Socket, Buffer->GetData(), Buffer->Num());
+				}));
+			}
+		}
+
+		bool bSucceeded = true;
+		for (int Rank = 0; Rank < Peers.Num(); ++Rank)
+		{
+			if (Peers[Rank] != nullptr && Incoming[Rank].Num() > 0)
+			{
+				bSucceeded &= ReceiveAll(Peers[Rank], Incoming[Rank].GetData(), Incoming[Rank].Num());
+			}
+		}
+
+		for (TFuture<bool>& Send : Sends)
+		{
+			bSucceeded &= Send.Get();
+		}
+		return bSucceeded;
+	}
+
+	int PackedBytes(int NumCells)
+	{
+		return FMath::DivideAndRoundUp(NumCells, 64) * sizeof(uint64);
+	}
+
+	// one bit per cell, read through an index list
+	void PackBits(const uint8* States, const int* Indices, int NumCells, TArray<uint8>& OutBytes)
+	{
+		OutBytes.SetNumZeroed(PackedBytes(NumCells));
+		uint64* Words = reinterpret_cast<uint64*>(OutBytes.GetData());
+		for (int i = 0; i < NumCells; ++i)
+		{
+			Words[i / 64] |= uint64(States[Indices ? Indices[i] : i] & 1) << (i % 64);
+		}
+	}
+
+	void UnpackBits(const TArray<uint8>& Bytes, int NumCells, uint8* OutStates)
+	{
+		const uint64* Words = reinterpret_cast<const uint64*>(Bytes.GetData());
+		for (int i = 0; i < NumCells; ++i)
+		{
+			OutStates[i] = uint8((Words[i / 64] >> (i % 64)) & 1);
+		}
+	}
+
+	void CloseSocket(FSocket* Socket)
+	{
+		if (Socket != nullptr)
+		{
+			Socket->Close();
+			ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Socket);
+		}
+	}
+}
+
+FDistributedLife::FDistributedLife(const FDistributedConfig& NewConfig)
+	: Config(NewConfig)
+{
+	NumXCells = Config.Grid.NumXCells;
+	FirstCell = RowStart(Config.Rank) * NumXCells;
+	NumOwned = RowStart(Config.Rank + 1) * NumXCells - FirstCell;
+
+	if (AutomataHensel::IsNonTotalistic(Config.BirthString) || AutomataHensel::IsNonTotalistic(Config.SurviveString))
+	{
+		UE_LOG(LogAutomata, Warning, TEXT("Distributed runs only step outer totalistic rules, so the letters in B%s/S%s are ignored"), *Config.BirthString, *Config.SurviveString);
+	}
+
+	BirthMask = uint16(LifeLanes::RuleMask(AutomataFuncs::StringToRule(Config.BirthString)));
+	SurviveMask = uint16(LifeLanes::RuleMask(AutomataFuncs::StringToRule(Config.SurviveString)));
+
+	Config.GatherOrigin.X = FMath::Clamp(Config.GatherOrigin.X, 0, Config.Grid.NumXCells - 1);
+	Config.GatherOrigin.Y = FMath::Clamp(Config.GatherOrigin.Y, 0, Config.Grid.NumZCells - 1);
+	Config.GatherXCells = FMath::Clamp(Config.GatherXCells, 1, Config.Grid.NumXCells - Config.GatherOrigin.X);
+	Config.GatherZCells = FMath::Clamp(Config.GatherZCells, 1, Config.Grid.NumZCells - Config.GatherOrigin.Y);
+
+	Peers.Init(nullptr, Config.NumRanks);
+	SendCells.SetNum(Config.NumRanks);
+	GhostStart.Init(0, Config.NumRanks);
+	GhostCount.Init(0, Config.NumRanks);
+}
+
+FDistributedLife::~FDistributedLife()
+{
+	if (Recorder)
+	{
+		Recorder->Close();
+	}
+
+	for (FSocket* Peer : Peers)
+	{
+		CloseSocket(Peer);
+	}
+}
+
+int FDistributedLife::RowStart(int Rank) const
+{
+	return int(int64(Rank) * Config.Grid.NumZCells / Config.NumRanks);
+}
+
+void FDistributedLife::GatherRows(int Rank, int& OutFirst, int& OutEnd) const
+{
+	OutFirst = FMath::Max(RowStart(Rank), Config.GatherOrigin.Y);
+	OutEnd = FMath::Max(OutFirst, FMath::Min(RowStart(Rank + 1), Config.GatherOrigin.Y + Config.GatherZCells));
+}
+
+int FDistributedLife::OwnerOf(int CellID) const
+{
+	int Row = CellID / NumXCells;
+
+	int Rank = int(int64(Row) * Config.NumRanks / Config.Grid.NumZCells);
+	while (Row >= RowStart(Rank + 1))
+	{
+		++Rank;
+	}
+	while (Row < RowStart(Rank))
+	{
+		--Rank;
+	}
+	return Rank;
+}
+
+void FDistributedLife::BuildNeighborhoods()
+{
+	const TArray<FIntPoint>& Relative = Config.Grid.Shape == CellShape::Hex ? RelativeAxialNeighborhood : RelativeMooreNeighborhood;
+
+	FNeighborhoodMaker Maker(&Config.Grid);
+	Maker.SetRule(Config.GridRule);
+
+	int Reach = Maker.GetEdgeReach(Relative);
+	TArray<int> InteriorOffsets[2];
+	bool bHasInterior = Maker.MakeInteriorOffsets(Relative, Reach, InteriorOffsets);
+
+	// The same neighborhoods a single process would build, but only for the owned stripe.
+	// No neighborhood is larger than the relative one, so each cell is written at a fixed stride first
+	// and the gaps are closed afterwards
+	int Stride = Relative.Num();
+	int NumRows = NumOwned / NumXCells;
+	NeighborOffsets.SetNumUninitialized(NumOwned + 1);
+	NeighborIndices.SetNumUninitialized(NumOwned * Stride);
+
+	ParallelFor(NumRows, [&](int32 Row)
+	{
+		TArray<int> Neighborhood;
+		for (int x = 0; x < NumXCells; ++x)
+		{
+			int Local = Row * NumXCells + x;
+			int CellID = FirstCell + Local;
+			int* Out = &NeighborIndices[Local * Stride];
+
+			if (!bHasInterior || Maker.IsBorderCell(CellID, Reach))
+			{
+				Maker.MakeNeighborhood(FIntPoint(x, CellID / NumXCells), Relative, Neighborhood);
+				FMemory::Memcpy(Out, Neighborhood.GetData(), Neighborhood.Num() * sizeof(int));
+				NeighborOffsets[Local + 1] = Neighborhood.Num();
+				continue;
+			}
+
+			const TArray<int>& Offsets = InteriorOffsets[(CellID / NumXCells) & 1];
+			for (int i = 0; i < Offsets.Num(); ++i)
+			{
+				Out[i] = CellID + Offsets[i];
+			}
+			NeighborOffsets[Local + 1] = Offsets.Num();
+		}
+	});
+
+	NeighborOffsets[0] = 0;
+	for (int Local = 0; Local < NumOwned; ++Local)
+	{
+		int Count = NeighborOffsets[Local + 1];
+		int Start = NeighborOffsets[Local];
+
+		// the compacted cell never starts after its strided slot, so moving forwards never overwrites unread cells
+		if (Start != Local * Stride)
+		{
+			FMemory::Memmove(&NeighborIndices[Start], &NeighborIndices[Local * Stride], Count * sizeof(int));
+		}
+		NeighborOffsets[Local + 1] = Start + Count;
+	}
+	NeighborIndices.SetNum(NeighborOffsets[NumOwned], false);
+
+	// every cell outside the stripe that is reached, grouped by owner
+	TArray<TSet<int>> Needed;
+	Needed.SetNum(Config.NumRanks);
+	for (int CellID : NeighborIndices)
+	{
+		if (CellID < FirstCell || CellID >= FirstCell + NumOwned)
+		{
+			Needed[OwnerOf(CellID)].Add(CellID);
+		}
+	}
+
+	// ghosts of each owner are contiguous and in cell order, so a peer's message unpacks straight into place
+	int NumLocal = NumOwned;
+	for (int Rank = 0; Rank < Config.NumRanks; ++Rank)
+	{
+		// the owner is told which cells to send, by reusing its slot in SendCells until the handshake
+		SendCells[Rank] = Needed[Rank].Array();
+		SendCells[Rank].Sort();
+
+		GhostStart[Rank] = NumLocal;
+		GhostCount[Rank] = SendCells[Rank].Num();
+		NumLocal += GhostCount[Rank];
+	}
+
+	// a ghost's local index is its place in its owner's sorted list
+	ParallelFor(NeighborIndices.Num(), [&](int32 i)
+	{
+		int CellID = NeighborIndices[i];
+		if (CellID >= FirstCell && CellID < FirstCell + NumOwned)
+		{
+			NeighborIndices[i] = CellID - FirstCell;
+			return;
+		}
+
+		int Rank = OwnerOf(CellID);
+		NeighborIndices[i] = GhostStart[Rank] + Algo::BinarySearch(SendCells[Rank], CellID);
+	});
+
+	States.Init(0, NumLocal);
+	NextStates.Init(0, NumOwned);
+}
+
+bool FDistributedLife::Connect()
+{
+	ISocketSubsystem* Subsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+	FIPv4Address Loopback(127, 0, 0, 1);
+
+	FSocket* Listener = FTcpSocketBuilder(TEXT("AutomataRankListener"))
+		.AsBlocking()
+		.AsReusable()
+		.BoundToEndpoint(FIPv4Endpoint(Loopback, Config.BasePort + Config.Rank))
+		.Listening(Config.NumRanks)
+		.Build();
+
+	if (Listener == nullptr)
+	{
+		UE_LOG(LogAutomata, Error, TEXT("Rank %d could not listen on port %d"), Config.Rank, Config.BasePort + Config.Rank);
+		return false;
+	}
+
+	// lower ranks are dialled, retrying while they start up, and higher ranks dial in
+	for (int Rank = 0; Rank < Config.Rank; ++Rank)
+	{
+		TSharedRef<FInternetAddr> Address = FIPv4Endpoint(Loopback, Config.BasePort + Rank).ToInternetAddr();
+
+		for (int Attempt = 0; Attempt < 600 && Peers[Rank] == nullptr; ++Attempt)
+		{
+			FSocket* Socket = Subsystem->CreateSocket(NAME_Stream, TEXT("AutomataRankPeer"), false);
+			if (Socket->Connect(*Address))
+			{
+				int32 OwnRank = Config.Rank;
+				SendAll(Socket, reinterpret_cast<const uint8*>(&OwnRank), sizeof(OwnRank));
+				Peers[Rank] = Socket;
+			}
+			else
+			{
+				CloseSocket(Socket);
+				FPlatformProcess::Sleep(0.1f);
+			}
+		}
+	}
+
+	for (int Accepted = Config.Rank + 1; Accepted < Config.NumRanks; ++Accepted)
+	{
+		FSocket* Socket = Listener->Accept(TEXT("AutomataRankPeer"));
+		int32 PeerRank = -1;
+		if (Socket == nullptr || !ReceiveAll(Socket, reinterpret_cast<uint8*>(&PeerRank), sizeof(PeerRank)) ||
+			PeerRank <= Config.Rank || PeerRank >= Config.NumRanks || Peers[PeerRank] != nullptr)
+		{
+			CloseSocket(Socket);
+			break;
+		}
+		Peers[PeerRank] = Socket;
+	}
+
+	CloseSocket(Listener);
+
+	for (int Rank = 0; Rank < Config.NumRanks; ++Rank)
+	{
+		if (Rank != Config.Rank && Peers[Rank] == nullptr)
+		{
+			UE_LOG(LogAutomata, Error, TEXT("Rank %d could not connect to rank %d"), Config.Rank, Rank);
+			return false;
+		}
+
+		if (Peers[Rank] != nullptr)
+		{
+			int32 BufferSize = 0;
+			Peers[Rank]->SetNoDelay(true);
+			Peers[Rank]->SetSendBufferSize(4 * 1024 * 1024, BufferSize);
+			Peers[Rank]->SetReceiveBufferSize(4 * 1024 * 1024, BufferSize);
+		}
+	}
+
+	BuildNeighborhoods();
+
+	// tell each owner how many and which of its cells are needed, and hear the same back
+	TArray<TArray<uint8>> Outgoing;
+	TArray<TArray<uint8>> Incoming;
+	Outgoing.SetNum(Config.NumRanks);
+	Incoming.SetNum(Config.NumRanks);
+
+	for (int Rank = 0; Rank < Config.NumRanks; ++Rank)
+	{
+		if (Peers[Rank] != nullptr)
+		{
+			int32 Count = SendCells[Rank].Num();
+			Outgoing[Rank].Append(reinterpret_cast<const uint8*>(&Count), sizeof(Count));
+			Incoming[Rank].SetNumZeroed(sizeof(int32));
+		}
+	}
+
+	if (!Exchange(Peers, Outgoing, Incoming))
+	{
+		return false;
+	}
+
+	for (int Rank = 0; Rank < Config.NumRanks; ++Rank)
+	{
+		if (Peers[Rank] != nullptr)
+		{
+			int32 Count = *reinterpret_cast<const int32*>(Incoming[Rank].GetData());
+			Outgoing[Rank].Reset();
+			Outgoing[Rank].Append(reinterpret_cast<const uint8*>(SendCells[Rank].GetData()), SendCells[Rank].Num() * sizeof(int));
+			Incoming[Rank].SetNumZeroed(Count * sizeof(int));
+		}
+	}
+
+	if (!Exchange(Peers, Outgoing, Incoming))
+	{
+		return false;
+	}
+
+	for (int Rank = 0; Rank < Config.NumRanks; ++Rank)
+	{
+		const int* Requested = reinterpret_cast<const int*>(Incoming[Rank].GetData());
+		int NumRequested = Incoming[Rank].Num() / sizeof(int);
+
+		SendCells[Rank].SetNumUninitialized(NumRequested);
+		for (int i = 0; i < NumRequested; ++i)
+		{
+			SendCells[Rank][i] = Requested[i] - FirstCell;
+		}
+	}
+
+	// the same draw as ULifelikeRule::InitializeCellStates, restricted to the stripe
+	uint64 Threshold = AutomataRandom::BernoulliThreshold(Config.Probability);
+	ParallelFor(NumOwned, [&](int32 Local)
+	{
+		States[Local] = AutomataRandom::Hash(uint32(Config.Seed), AutomataRandom::CellStates, FirstCell + Local) < Threshold;
+	});
+
+	int FirstRow;
+	int EndRow;
+	GatherRows(Config.Rank, FirstRow, EndRow);
+	for (int z = FirstRow; z < EndRow; ++z)
+	{
+		for (int x = Config.GatherOrigin.X; x < Config.GatherOrigin.X + Config.GatherXCells; ++x)
+		{
+			GatherCells.Add(z * NumXCells + x - FirstCell);
+		}
+	}
+
+	if (Config.Rank == 0 && !Config.RecordingPath.IsEmpty() && Config.GatherInterval > 0)
+	{
+		int NumCells = Config.GatherXCells * Config.GatherZCells;
+
+		// other ranks send their stripes whether or not the file opened, so gathering carries on regardless
+		Recorder = MakeUnique<FAutomataRecorder>();
+		if (!Recorder->Open(Config.RecordingPath, NumCells, 2, 256, false))
+		{
+			Recorder.Reset();
+		}
+
+		GatheredStates.Init(0, NumCells);
+		GatheredSwitchSteps.Init(TNumericLimits<int32>::Min(), NumCells);
+	}
+
+	UE_LOG(LogAutomata, Log, TEXT("Rank %d owns %d cells with %d ghosts"), Config.Rank, NumOwned, States.Num() - NumOwned);
+	return true;
+}
+
+bool FDistributedLife::ExchangeGhosts()
+{
+	TArray<TArray<uint8>> Outgoing;
+	TArray<TArray<uint8>> Incoming;
+	Outgoing.SetNum(Config.NumRanks);
+	Incoming.SetNum(Config.NumRanks);
+
+	for (int Rank = 0; Rank < Config.NumRanks; ++Rank)
+	{
+		if (SendCells[Rank].Num() > 0)
+		{
+			PackBits(States.GetData(), SendCells[Rank].GetData(), SendCells[Rank].Num(), Outgoing[Rank]);
+		}
+		Incoming[Rank].SetNumZeroed(GhostCount[Rank] > 0 ? PackedBytes(GhostCount[Rank]) : 0);
+	}
+
+	if (!Exchange(Peers, Outgoing, Incoming))
+	{
+		return false;
+	}
+
+	for (int Rank = 0; Rank < Config.NumRanks; ++Rank)
+	{
+		if (GhostCount[Rank] > 0)
+		{
+			UnpackBits(Incoming[Rank], GhostCount[Rank], States.GetData() + GhostStart[Rank]);
+		}
+	}
+	return true;
+}
+
+void FDistributedLife::ApplyRules()
+{
+	ParallelFor(NumOwned, [&](int32 Local)
+	{
+		int AliveNeighbors = 0;
+		for (int i = NeighborOffsets[Local]; i < NeighborOffsets[Local + 1]; ++i)
+		{
+			AliveNeighbors += States[NeighborIndices[i]];
+		}
+
+		uint16 Mask = States[Local] ? SurviveMask : BirthMask;
+		NextStates[Local] = uint8((Mask >> AliveNeighbors) & 1);
+	});
+
+	FMemory::Memcpy(States.GetData(), NextStates.GetData(), NumOwned);
+}
+
+bool FDistributedLife::Gather(int Step)
+{
+	TArray<TArray<uint8>> Outgoing;
+	TArray<TArray<uint8>> Incoming;
+	Outgoing.SetNum(Config.NumRanks);
+	Incoming.SetNum(Config.NumRanks);
+
+	// ranks whose stripe misses the window send nothing
+	if (Config.Rank != 0)
+	{
+		if (GatherCells.Num() > 0)
+		{
+			PackBits(States.GetData(), GatherCells.GetData(), GatherCells.Num(), Outgoing[0]);
+		}
+		return Exchange(Peers, Outgoing, Incoming);
+	}
+
+	for (int Rank = 1; Rank < Config.NumRanks; ++Rank)
+	{
+		int FirstRow;
+		int EndRow;
+		GatherRows(Rank, FirstRow, EndRow);
+		if (EndRow > FirstRow)
+		{
+			Incoming[Rank].SetNumZeroed(PackedBytes((EndRow - FirstRow) * Config.GatherXCells));
+		}
+	}
+
+	if (!Exchange(Peers, Outgoing, Incoming))
+	{
+		return false;
+	}
+
+	// stripes are in row order, so each rank's rows land straight after the last's
+	TArray<uint8> Board;
+	Board.SetNumUninitialized(GatheredStates.Num());
+	for (int i = 0; i < GatherCells.Num(); ++i)
+	{
+		Board[i] = States[GatherCells[i]];
+	}
+	for (int Rank = 1; Rank < Config.NumRanks; ++Rank)
+	{
+		int FirstRow;
+		int EndRow;
+		GatherRows(Rank, FirstRow, EndRow);
+		if (EndRow > FirstRow)
+		{
+			UnpackBits(Incoming[Rank], (EndRow - FirstRow) * Config.GatherXCells, Board.GetData() + (FirstRow - Config.GatherOrigin.Y) * Config.GatherXCells);
+		}
+	}
+
+	// cells that died since the last gather fade from the step before this one, as in ULifelikeRule
+	ParallelFor(Board.Num(), [&](int32 CellID)
+	{
+		if (Board[CellID] != GatheredStates[CellID])
+		{
+			GatheredSwitchSteps[CellID] = Board[CellID] ? TNumericLimits<float>::Max() : float(Step - 1);
+			GatheredStates[CellID] = Board[CellID];
+		}
+	});
+
+	FBaseAutomataStruct Frame;
+	Frame.NextStep = Step;
+	Frame.CurrentStates = MoveTemp(GatheredStates);
+	Frame.SwitchStepBuffer = MoveTemp(GatheredSwitchSteps);
+
+	if (Recorder)
+	{
+		Recorder->RecordFrame(Frame);
+	}
+
+	GatheredStates = MoveTemp(Frame.CurrentStates);
+	GatheredSwitchSteps = MoveTemp(Frame.SwitchStepBuffer);
+	return true;
+}
+
+bool FDistributedLife::Run(int NumSteps)
+{
+	// every rank is given the recording path, so all agree on whether to gather
+	bool bGathering = !Config.RecordingPath.IsEmpty() && Config.GatherInterval > 0;
+
+	if (bGathering && !Gather(0))
+	{
+		return false;
+	}
+
+	for (int Step = 1; Step <= NumSteps; ++Step)
+	{
+		if (!ExchangeGhosts())
+		{
+			UE_LOG(LogAutomata, Error, TEXT("Rank %d lost a peer on step %d"), Config.Rank, Step);
+			return false;
+		}
+
+		ApplyRules();
+
+		if (bGathering && Step % Config.GatherInterval == 0 && !Gather(Step))
+		{
+			UE_LOG(LogAutomata, Error, TEXT("Rank %d failed to gather step %d"), Config.Rank, Step);
+			return false;
+		}
+	}
+	return true;
+}
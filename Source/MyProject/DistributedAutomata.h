@@ -0,0 +1,100 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GridRules.h"
+
+class FSocket;
+class FAutomataRecorder;
+
+struct FDistributedConfig
+{
+	int Rank = 0;
+	int NumRanks = 1;
+
+	// rank r listens on BasePort + r, on the loopback interface
+	int BasePort = 47100;
+
+	FBasicGrid Grid;
+	BoundGridRuleset GridRule = BoundGridRuleset::Torus;
+
+	FString BirthString = TEXT("3");
+	FString SurviveString = TEXT("23");
+	float Probability = 0.4;
+	int32 Seed = 1;
+
+	// Rank 0 gathers a window of the board every GatherInterval steps and records it here, so the run can be watched
+	// through the factory's ReplayPath on a grid the window's size. Off unless both are set.
+	// Only the window is ever assembled in one place, so it should stay far smaller than the board
+	FString RecordingPath;
+	int GatherInterval = 0;
+
+	// first cell of the window and its size, clamped to the board
+	FIntPoint GatherOrigin = FIntPoint(0, 0);
+	int GatherXCells = 512;
+	int GatherZCells = 512;
+};
+
+// One process of a lifelike simulation split across several.
+// Each rank owns a stripe of rows, and holds only those cells plus ghost copies of the cells outside it
+// that its neighborhoods reach. Ghosts are found by resolving each neighborhood through the edge rule,
+// so every BoundGridRuleset seam is exchanged correctly, however far across the grid it lands.
+// Ranks are fully connected over loopback TCP, and exchange ghost states bit-packed before every step.
+class FDistributedLife
+{
+public:
+
+	explicit FDistributedLife(const FDistributedConfig& NewConfig);
+	~FDistributedLife();
+
+	// connects to every other rank, and agrees which cells each sends the others
+	bool Connect();
+
+	bool Run(int NumSteps);
+
+private:
+
+	FDistributedConfig Config;
+
+	int NumXCells = 0;
+	int FirstCell = 0;
+	int NumOwned = 0;
+
+	// owned cells first, then ghosts grouped by the rank that owns them
+	TArray<uint8> States;
+	TArray<uint8> NextStates;
+
+	// neighborhoods of the owned cells in local indices, flattened
+	TArray<int> NeighborOffsets;
+	TArray<int> NeighborIndices;
+
+	uint16 BirthMask = 0;
+	uint16 SurviveMask = 0;
+
+	// per rank, its connection, the owned cells it needs each step, and where its ghosts start
+	TArray<FSocket*> Peers;
+	TArray<TArray<int>> SendCells;
+	TArray<int> GhostStart;
+	TArray<int> GhostCount;
+
+	// owned cells inside the gathered window, in the window's row order
+	TArray<int> GatherCells;
+
+	// rank 0 only, the window's cells
+	TUniquePtr<FAutomataRecorder> Recorder;
+	TArray<int> GatheredStates;
+	TArray<float> GatheredSwitchSteps;
+
+	int RowStart(int Rank) const;
+	int OwnerOf(int CellID) const;
+
+	// the window's rows within Rank's stripe, as [OutFirst, OutEnd). Empty if they don't meet
+	void GatherRows(int Rank, int& OutFirst, int& OutEnd) const;
+
+	void BuildNeighborhoods();
+
+	bool ExchangeGhosts();
+
+	void ApplyRules();
+
+	bool Gather(int Step);
+};
@@ -7,18 +7,18 @@ void FBasicGrid::SetCoords()
 	GridCoords.Init(FIntPoint(), NumCells());
 	ParallelFor(NumZCells, [&](int z)
 	{
-		ParallelFor(NumXCells, [&](int x)
+		for (int x = 0; x < NumXCells; ++x)
 		{
 			int ID = z * NumXCells + x;
 			GridCoords[ID] = { x, z };
-		});
+		}
 	});
 }
 
 void FBasicGrid::SetTransforms()
 {
 	using namespace HexCoords;
-	CellTransforms.Reserve(NumCells());
+	CellTransforms.Reset(NumCells());
 
 	auto VectorConversion = [&](FVector2D Point)
 	{
@@ -84,12 +84,11 @@ void FNeighborhoodMaker::MapNeighborhood(TArray<int>& Neighborhood, TArray<FIntP
 	TSet<int> ConvertedCoords;
 	for (auto Coord : NeighborCoords)
 	{
-		if (ApplyEdgeRule != nullptr)
+		if (MapCoord(Coord))
 		{
-			ConvertedCoords.Add((this->*ApplyEdgeRule)(Coord));
+			ConvertedCoords.Add(Grid->CoordToCellID(Coord));
 		}	
 	}
-	ConvertedCoords.Remove(-1);
 
 	Neighborhood = ConvertedCoords.Array();
 }
@@ -114,7 +113,7 @@ bool FNeighborhoodMaker::IsAxisTwisted(int & Component, int NumAxisCells) const
 			bool(		(Component / NumAxisCells) % 2);
 }
 
-int FNeighborhoodMaker::TorusRule(FIntPoint& Coord)
+bool FNeighborhoodMaker::TorusRule(FIntPoint& Coord)
 {
 	int& NumXCells = Grid->NumXCells;
 	int& NumZCells = Grid->NumZCells;
@@ -125,10 +124,10 @@ int FNeighborhoodMaker::TorusRule(FIntPoint& Coord)
 	LoopAxis(XCoord, NumXCells);
 	LoopAxis(ZCoord, NumZCells);
 
-	return Grid->CoordToCellID(Coord);
+	return true;
 }
 
-int FNeighborhoodMaker::FiniteRule(FIntPoint& Coord)
+bool FNeighborhoodMaker::FiniteRule(FIntPoint& Coord)
 {
 	int& NumXCells = Grid->NumXCells;
 	int& NumZCells = Grid->NumZCells;
@@ -138,15 +137,15 @@ int FNeighborhoodMaker::FiniteRule(FIntPoint& Coord)
 
 	if (((XCoord >= 0) && (XCoord < NumXCells)) && ((ZCoord >= 0) && (ZCoord < NumZCells)))
 	{
-		return Grid->CoordToCellID(Coord);
+		return true;
 	}
 	else
 	{
-		return -1;
+		return false;
 	}
 }
 
-int FNeighborhoodMaker::CylinderRule(FIntPoint& Coord)
+bool FNeighborhoodMaker::CylinderRule(FIntPoint& Coord)
 {
 	int& NumXCells = Grid->NumXCells;
 	int& NumZCells = Grid->NumZCells;
@@ -157,15 +156,15 @@ int FNeighborhoodMaker::CylinderRule(FIntPoint& Coord)
 	if ((ZCoord >= 0) && (ZCoord < NumZCells))
 	{
 		LoopAxis(XCoord, NumXCells);
-		return Grid->CoordToCellID(Coord);
+		return true;
 	}
 	else
 	{
-		return -1;
+		return false;
 	}
 }
 
-int FNeighborhoodMaker::KleinRule(FIntPoint& Coord)
+bool FNeighborhoodMaker::KleinRule(FIntPoint& Coord)
 {
 	int& NumXCells = Grid->NumXCells;
 	int& NumZCells = Grid->NumZCells;
@@ -184,10 +183,10 @@ int FNeighborhoodMaker::KleinRule(FIntPoint& Coord)
 
 	LoopAxis(ZCoord, NumZCells);
 
-	return Grid->CoordToCellID(Coord);
+	return true;
 }
 
-int FNeighborhoodMaker::CrossSurfaceRule(FIntPoint& Coord)
+bool FNeighborhoodMaker::CrossSurfaceRule(FIntPoint& Coord)
 {
 	int& NumXCells = Grid->NumXCells;
 	int& NumZCells = Grid->NumZCells;
@@ -213,12 +212,12 @@ int FNeighborhoodMaker::CrossSurfaceRule(FIntPoint& Coord)
 		LoopAxis(XCoord, NumXCells);
 	}
 
-	return Grid->CoordToCellID(Coord);
+	return true;
 
 
 }
 
-int FNeighborhoodMaker::SphereRule(FIntPoint& Coord)
+bool FNeighborhoodMaker::SphereRule(FIntPoint& Coord)
 {
 	int& NumXCells = Grid->NumXCells;
 	int& NumZCells = Grid->NumZCells;
@@ -280,50 +279,150 @@ int FNeighborhoodMaker::SphereRule(FIntPoint& Coord)
 		// Z axis becomes -Z axis
 	}
 
-	return Grid->CoordToCellID(Coord);
+	return true;
 }
 
 void FNeighborhoodMaker::MakeNeighborhoods(TArray<TArray<int>>& Neighborhoods, TArray<FIntPoint> RelativeNeighborhood, BoundGridRuleset Rule)
 {
-	using namespace HexCoords;
-
 	InitRuleFunc(Rule);
 
-	TArray<FIntPoint>& GridCoords = Grid->GridCoords;
+	int Reach = GetEdgeReach(RelativeNeighborhood);
+	TArray<int> InteriorOffsets[2];
+	bool bHasInterior = MakeInteriorOffsets(RelativeNeighborhood, Reach, InteriorOffsets);
 
 	// Making sure to reserve all the memory we'll need, for parallelism thread-safety
 
-	Neighborhoods.Init(TArray<int>(), GridCoords.Num());
+	Neighborhoods.Init(TArray<int>(), Grid->NumCells());
 
-	ParallelFor(GridCoords.Num(), [&](int CellID)
+	// interior neighborhoods are the same offsets shifted to each cell, so only the border goes through the edge rule
+	ParallelFor(Grid->NumZCells, [&](int z)
 	{
-		TArray<FIntPoint> NeighborCoords = RelativeNeighborhood;
-		FIntPoint& CellCoord = GridCoords[CellID];
+		const TArray<int>& Offsets = InteriorOffsets[z & 1];
 
-		switch (Grid->Shape)
+		for (int x = 0; x < Grid->NumXCells; ++x)
 		{
-		case (CellShape::Square):
-			
-			for (FIntPoint& Coord : NeighborCoords)
+			int CellID = Grid->CoordToCellID({ x, z });
+
+			if (!bHasInterior || IsBorderCell(CellID, Reach))
 			{
-				Coord += CellCoord;
+				MakeNeighborhood({ x, z }, RelativeNeighborhood, Neighborhoods[CellID]);
+				continue;
 			}
-			break;
 
-		case (CellShape::Hex):
-			// Hex coordinates can only be added properly in the axial domain:
-			// convert to axial, add, then convert back
+			TArray<int>& Neighborhood = Neighborhoods[CellID];
+			Neighborhood.SetNumUninitialized(Offsets.Num());
+			for (int i = 0; i < Offsets.Num(); ++i)
+			{
+				Neighborhood[i] = CellID + Offsets[i];
+			}
+		}
+	});
+}
+
+bool FNeighborhoodMaker::MakeInteriorOffsets(const TArray<FIntPoint>& RelativeNeighborhood, int Reach, TArray<int> (&OutOffsets)[2])
+{
+	if (Grid->NumXCells <= 2 * Reach || Grid->NumZCells <= 2 * Reach + 1)
+	{
+		return false;
+	}
 
-			TArray<FIntPoint>& AxialNeighborCoords = NeighborCoords;
+	// one sample cell per row parity, in order, since MapNeighborhood keeps the relative neighborhood's order
+	for (int Parity = 0; Parity < 2; ++Parity)
+	{
+		FIntPoint Sample(Reach, Reach + Parity);
+		int SampleID = Grid->CoordToCellID(Sample);
 
-			for (FIntPoint& Coord : AxialNeighborCoords)
+		MakeNeighborhood(Sample, RelativeNeighborhood, OutOffsets[(Reach + Parity) & 1]);
+		for (int& Offset : OutOffsets[(Reach + Parity) & 1])
+		{
+			Offset -= SampleID;
+		}
+	}
+	return true;
+}
+
+int FNeighborhoodMaker::GetEdgeReach(const TArray<FIntPoint>& RelativeNeighborhood) const
+{
+	int Reach = 0;
+	for (const FIntPoint& Offset : RelativeNeighborhood)
+	{
+		Reach = FMath::Max(Reach, FMath::Max(FMath::Abs(Offset.X), FMath::Abs(Offset.Y)));
+	}
+
+	// an axial step across rows also shifts the offset column by up to half the rows crossed
+	return Grid->Shape == CellShape::Hex ? 2 * Reach : Reach;
+}
+
+bool FNeighborhoodMaker::IsBorderCell(int CellID, int Reach) const
+{
+	int x = CellID % Grid->NumXCells;
+	int z = CellID / Grid->NumXCells;
+
+	return x < Reach || x >= Grid->NumXCells - Reach || z < Reach || z >= Grid->NumZCells - Reach;
+}
+
+void FNeighborhoodMaker::GetBorderCells(int Reach, TArray<int>& OutCells) const
+{
+	OutCells.Reset();
+
+	for (int z = 0; z < Grid->NumZCells; ++z)
+	{
+		bool bWholeRow = z < Reach || z >= Grid->NumZCells - Reach;
+
+		for (int x = 0; x < Grid->NumXCells; ++x)
+		{
+			// skips straight past the interior of the row
+			if (!bWholeRow && x == Reach && Grid->NumXCells - Reach > Reach)
 			{
-				Coord += OffsetToAxial(CellCoord);
-				Coord = AxialToOffset(Coord);
+				x = Grid->NumXCells - Reach - 1;
+				continue;
 			}
-			break;
+			OutCells.Add(Grid->CoordToCellID({ x, z }));
+		}
+	}
+}
+
+void FNeighborhoodMaker::RemakeBorderNeighborhoods(TArray<TArray<int>>& Neighborhoods, const TArray<FIntPoint>& RelativeNeighborhood, BoundGridRuleset Rule, TArray<int>& OutBorderCells)
+{
+	InitRuleFunc(Rule);
+	GetBorderCells(GetEdgeReach(RelativeNeighborhood), OutBorderCells);
+
+	ParallelFor(OutBorderCells.Num(), [&](int32 Index)
+	{
+		int CellID = OutBorderCells[Index];
+		MakeNeighborhood({ CellID % Grid->NumXCells, CellID / Grid->NumXCells }, RelativeNeighborhood, Neighborhoods[CellID]);
+	});
+}
+
+void FNeighborhoodMaker::MakeNeighborhood(FIntPoint CellCoord, const TArray<FIntPoint>& RelativeNeighborhood, TArray<int>& Neighborhood)
+{
+	using namespace HexCoords;
+
+	TArray<FIntPoint> NeighborCoords = RelativeNeighborhood;
+
+	switch (Grid->Shape)
+	{
+	case (CellShape::Square):
+		
+		for (FIntPoint& Coord : NeighborCoords)
+		{
+			Coord += CellCoord;
 		}
+		break;
+
+	case (CellShape::Hex):
+		// Hex coordinates can only be added properly in the axial domain:
+		// convert to axial, add, then convert back
+
+		TArray<FIntPoint>& AxialNeighborCoords = NeighborCoords;
+
+		for (FIntPoint& Coord : AxialNeighborCoords)
+		{
+			Coord += OffsetToAxial(CellCoord);
+			Coord = AxialToOffset(Coord);
+		}
+		break;
+	}
 
-		MapNeighborhood(Neighborhoods[CellID],NeighborCoords);
-	}/*,EParallelForFlags::ForceSingleThread*/);
+	MapNeighborhood(Neighborhood, NeighborCoords);
 }
@@ -2,14 +2,14 @@
 
 #include "GridRules.generated.h"
 
-UENUM()
+UENUM(BlueprintType)
 enum class CellShape : uint8
 {
 	Square,
 	Hex
 };
 
-UENUM()
+UENUM(BlueprintType)
 enum class BoundGridRuleset : uint8
 {
 	Finite,
@@ -55,13 +55,34 @@ struct FBasicGrid
 	}
 };
 
+// A grid being changed in place. Grid already holds the new size and shape
+struct FGridChange
+{
+	FBasicGrid* Grid = nullptr;
+
+	int OldNumXCells = 0;
+	int OldNumZCells = 0;
+	CellShape OldShape = CellShape::Square;
+	BoundGridRuleset OldRule = BoundGridRuleset::Torus;
+	BoundGridRuleset NewRule = BoundGridRuleset::Torus;
+
+	// of the new shape
+	TArray<FIntPoint> RelativeNeighborhood;
+
+	// false if only the edge rule changed, leaving every cell ID where it was
+	bool ChangesCells() const
+	{
+		return OldNumXCells != Grid->NumXCells || OldNumZCells != Grid->NumZCells || OldShape != Grid->Shape;
+	}
+};
+
 USTRUCT()
 struct FNeighborhoodMaker
 {
 	GENERATED_BODY()
 
 		//DECLARE_DELEGATE_RetVal_OneParam(int, CoordConverter, FIntPoint&);
-		typedef int (FNeighborhoodMaker::* RulePtr)(FIntPoint&);
+		typedef bool (FNeighborhoodMaker::* RulePtr)(FIntPoint&);
 
 private:
 
@@ -76,17 +97,17 @@ private:
 
 	bool IsAxisTwisted(int & Component, int NumAxisCells) const;
 
-	int TorusRule(FIntPoint& Coord);
+	bool TorusRule(FIntPoint& Coord);
 
-	int FiniteRule(FIntPoint& Coord);
+	bool FiniteRule(FIntPoint& Coord);
 
-	int CylinderRule(FIntPoint& Coord);
+	bool CylinderRule(FIntPoint& Coord);
 
-	int KleinRule(FIntPoint& Coord);
+	bool KleinRule(FIntPoint& Coord);
 
-	int CrossSurfaceRule(FIntPoint& Coord);
+	bool CrossSurfaceRule(FIntPoint& Coord);
 
-	int SphereRule(FIntPoint& Coord);
+	bool SphereRule(FIntPoint& Coord);
 
 	void InitRuleFunc(BoundGridRuleset Rule);
 
@@ -100,4 +121,32 @@ public:
 	}
 
 	void MakeNeighborhoods(TArray<TArray<int>>& Neighborhoods, TArray<FIntPoint> RelativeNeighborhood, BoundGridRuleset Rule);
+
+	// Selects the edge rule used by MakeNeighborhood
+	void SetRule(BoundGridRuleset Rule) { InitRuleFunc(Rule); }
+
+	// Moves a coordinate that may be off the grid to the cell the edge rule puts it on.
+	// False if it falls off the grid entirely
+	bool MapCoord(FIntPoint& Coord) { return ApplyEdgeRule != nullptr && (this->*ApplyEdgeRule)(Coord); }
+
+	// Neighborhood of a single cell, identical to its entry from MakeNeighborhoods.
+	// Only reads the grid's dimensions and shape, so the grid's coordinate arrays needn't exist
+	void MakeNeighborhood(FIntPoint CellCoord, const TArray<FIntPoint>& RelativeNeighborhood, TArray<int>& Neighborhood);
+
+	// How far from an edge a cell's neighborhood can cross it. Every edge rule agrees on cells further in,
+	// and the cells an edge rule maps to always lie within this reach of an edge themselves
+	int GetEdgeReach(const TArray<FIntPoint>& RelativeNeighborhood) const;
+
+	bool IsBorderCell(int CellID, int Reach) const;
+
+	// Cell ID offsets of an interior cell's neighborhood, for even and odd rows.
+	// False if the grid is too small to have an interior
+	bool MakeInteriorOffsets(const TArray<FIntPoint>& RelativeNeighborhood, int Reach, TArray<int> (&OutOffsets)[2]);
+
+	// every cell within Reach of an edge, in ascending order
+	void GetBorderCells(int Reach, TArray<int>& OutCells) const;
+
+	// Rebuilds only the border cells' neighborhoods under a new edge rule, which is all that changes with it.
+	// Fills OutBorderCells with the cells it rebuilt
+	void RemakeBorderNeighborhoods(TArray<TArray<int>>& Neighborhoods, const TArray<FIntPoint>& RelativeNeighborhood, BoundGridRuleset Rule, TArray<int>& OutBorderCells);
 };
\ No newline at end of file
@@ -0,0 +1,171 @@
+#include "HenselNotation.h"
+
+namespace
+{
+	// every neighbor bit of a window
+	constexpr int NeighborBits = 0x1FF & ~(1 << AutomataHensel::CenterBit);
+
+	// The letters of counts 1 to 4, each with one window it stands for. Counts 5 to 7 use the same letters
+	// for the complements of 8 minus the count, and 0 and 8 have no letters
+	const TCHAR* const Letters[5] = { TEXT(""), TEXT("ce"), TEXT("ceaikn"), TEXT("ceaiknjqry"), TEXT("ceaiknjqrytwz") };
+	const int CanonicalWindows[5][13] =
+	{
+		{},
+		{ 1, 2 },
+		{ 5, 10, 3, 40, 33, 68 },
+		{ 69, 42, 11, 7, 98, 13, 14, 70, 41, 97 },
+		{ 325, 170, 15, 45, 99, 71, 106, 102, 43, 101, 105, 78, 108 }
+	};
+
+	// the window turned a quarter clockwise, or mirrored left to right
+	int Rotate(int Window)
+	{
+		int Turned = 0;
+		for (int Bit = 0; Bit < 9; ++Bit)
+		{
+			int Row = Bit / 3;
+			int Column = Bit % 3;
+			Turned |= ((Window >> Bit) & 1) << (Column * 3 + (2 - Row));
+		}
+		return Turned;
+	}
+
+	int Mirror(int Window)
+	{
+		int Mirrored = 0;
+		for (int Bit = 0; Bit < 9; ++Bit)
+		{
+			int Row = Bit / 3;
+			int Column = Bit % 3;
+			Mirrored |= ((Window >> Bit) & 1) << (Row * 3 + (2 - Column));
+		}
+		return Mirrored;
+	}
+
+	// Marks the arrangements that Letter stands for at Count live neighbors. False if there's no such letter
+	bool MarkLetter(int Count, TCHAR Letter, TArray<bool>& OutArrangements)
+	{
+		int Base = Count <= 4 ? Count : 8 - Count;
+		const TCHAR* Found = FCString::Strchr(Letters[Base], Letter);
+		if (Found == nullptr)
+		{
+			return false;
+		}
+
+		int Window = CanonicalWindows[Base][Found - Letters[Base]];
+		if (Count > 4)
+		{
+			Window ^= NeighborBits;
+		}
+
+		for (int Reflection = 0; Reflection < 2; ++Reflection)
+		{
+			for (int Turn = 0; Turn < 4; ++Turn)
+			{
+				OutArrangements[AutomataHensel::Arrangement(Window)] = true;
+				Window = Rotate(Window);
+			}
+			Window = Mirror(Window);
+		}
+		return true;
+	}
+
+	void MarkCount(int Count, bool bValue, TArray<bool>& OutArrangements)
+	{
+		for (int Arrangement = 0; Arrangement < 256; ++Arrangement)
+		{
+			if (FPlatformMath::CountBits(Arrangement) == Count)
+			{
+				OutArrangements[Arrangement] = bValue;
+			}
+		}
+	}
+
+	bool IsLetter(TCHAR Character)
+	{
+		return FCString::Strchr(Letters[4], Character) != nullptr;
+	}
+}
+
+bool AutomataHensel::IsNonTotalistic(const FString& RuleDigits)
+{
+	for (TCHAR Character : RuleDigits)
+	{
+		if (IsLetter(Character))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool AutomataHensel::ParseRule(const FString& RuleDigits, TArray<bool>& OutArrangements)
+{
+	OutArrangements.Init(false, 256);
+	bool bValid = true;
+
+	int Index = 0;
+	while (Index < RuleDigits.Len())
+	{
+		TCHAR Character = RuleDigits[Index++];
+		if (!TChar<TCHAR>::IsDigit(Character))
+		{
+			continue;
+		}
+
+		int Count = TChar<TCHAR>::ConvertCharDigitToInt(Character);
+		if (Count > 8)
+		{
+			bValid = false;
+			continue;
+		}
+
+		bool bExcluding = Index < RuleDigits.Len() && RuleDigits[Index] == TEXT('-');
+		if (bExcluding)
+		{
+			++Index;
+		}
+
+		TArray<bool> Picked;
+		Picked.Init(false, 256);
+		bool bAnyLetters = false;
+		while (Index < RuleDigits.Len() && IsLetter(RuleDigits[Index]))
+		{
+			bValid &= MarkLetter(Count, RuleDigits[Index++], Picked);
+			bAnyLetters = true;
+		}
+
+		if (!bAnyLetters || bExcluding)
+		{
+			MarkCount(Count, true, OutArrangements);
+		}
+
+		for (int Arrangement = 0; Arrangement < 256; ++Arrangement)
+		{
+			if (Picked[Arrangement])
+			{
+				OutArrangements[Arrangement] = !bExcluding;
+			}
+		}
+	}
+
+	return bValid;
+}
+
+const TCHAR* AutomataHensel::LettersFor(int Count)
+{
+	return Count >= 0 && Count <= 8 ? Letters[Count <= 4 ? Count : 8 - Count] : TEXT("");
+}
+
+TArray<bool> AutomataHensel::MakeTransitions(const TArray<bool>& BirthArrangements, const TArray<bool>& SurviveArrangements)
+{
+	TArray<bool> Transitions;
+	Transitions.SetNumUninitialized(NumWindows);
+
+	for (int Window = 0; Window < NumWindows; ++Window)
+	{
+		const TArray<bool>& Rule = (Window >> CenterBit) & 1 ? SurviveArrangements : BirthArrangements;
+		Transitions[Window] = Rule[Arrangement(Window)];
+	}
+	return Transitions;
+}
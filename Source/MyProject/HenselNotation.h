@@ -0,0 +1,32 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Isotropic non-totalistic rules, e.g. B2n3/S23-q, in Hensel notation.
+// A letter after a neighbor count picks out one arrangement of that many live neighbors, up to rotation and reflection.
+// Windows are 3x3 with bit (Row * 3 + Column) set per live cell, so the cell itself is bit 4
+namespace AutomataHensel
+{
+	constexpr int CenterBit = 4;
+	constexpr int NumWindows = 512;
+
+	// whether the rule has any letters, and so can't be read as a plain list of counts
+	bool IsNonTotalistic(const FString& RuleDigits);
+
+	// For each of the 256 arrangements of live neighbors, with the center bit left out, whether the rule applies.
+	// A count alone takes every arrangement, letters after it take only those, and letters after a '-' take all but those.
+	// Characters that are neither are ignored like StringToRule does. False if a letter doesn't exist for its count
+	bool ParseRule(const FString& RuleDigits, TArray<bool>& OutArrangements);
+
+	// the letters that exist for a count of live neighbors, empty for 0 and 8
+	const TCHAR* LettersFor(int Count);
+
+	// next state of the center for every 3x3 window
+	TArray<bool> MakeTransitions(const TArray<bool>& BirthArrangements, const TArray<bool>& SurviveArrangements);
+
+	// neighbor arrangement of a window, compacted to 8 bits with the center taken out
+	inline int Arrangement(int Window)
+	{
+		return (Window & ((1 << CenterBit) - 1)) | ((Window >> (CenterBit + 1)) << CenterBit);
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Two-state Moore rules on 64 cells at once, one cell per bit lane.
+// Shared by the bit-packed engines, which only differ in where the neighbor words come from
+namespace LifeLanes
+{
+	// bit k of a mask set if the rule applies at k live neighbors
+	inline uint32 RuleMask(const TArray<bool>& Rules)
+	{
+		uint32 Mask = 0;
+		for (int Count = 0; Count <= 8 && Count < Rules.Num(); ++Count)
+		{
+			Mask |= uint32(Rules[Count]) << Count;
+		}
+		return Mask;
+	}
+
+	// adds one bit per lane into a four bit counter held across S0 (lowest) to S3
+	inline void AddLanes(uint64 Input, uint64& S0, uint64& S1, uint64& S2, uint64& S3)
+	{
+		uint64 Carry0 = S0 & Input;
+		S0 ^= Input;
+		uint64 Carry1 = S1 & Carry0;
+		S1 ^= Carry0;
+		uint64 Carry2 = S2 & Carry1;
+		S2 ^= Carry1;
+		S3 |= Carry2;
+	}
+
+	// Next states of Alive given its eight neighbor words, each holding every lane's neighbor in that direction
+	inline uint64 Step(uint64 Alive, const uint64 (&Neighbors)[8], uint32 BirthMask, uint32 SurviveMask)
+	{
+		uint64 S0 = 0, S1 = 0, S2 = 0, S3 = 0;
+		for (uint64 Neighbor : Neighbors)
+		{
+			AddLanes(Neighbor, S0, S1, S2, S3);
+		}
+
+		uint64 Born = 0;
+		uint64 Survives = 0;
+		for (int Count = 0; Count <= 8; ++Count)
+		{
+			uint64 Equal =	(Count & 1 ? S0 : ~S0) &
+							(Count & 2 ? S1 : ~S1) &
+							(Count & 4 ? S2 : ~S2) &
+							(Count & 8 ? S3 : ~S3);
+
+			Born |= (BirthMask >> Count) & 1 ? Equal : 0;
+			Survives |= (SurviveMask >> Count) & 1 ? Equal : 0;
+		}
+
+		return (Alive & Survives) | (~Alive & Born);
+	}
+}
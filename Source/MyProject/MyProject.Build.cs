@@ -10,7 +10,7 @@ namespace UnrealBuildTool.Rules
             PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore" });
             PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "UMG", "Niagara" });
 
-            PrivateDependencyModuleNames.AddRange(new string[] { });
+            PrivateDependencyModuleNames.AddRange(new string[] { "Sockets", "Networking" });
 
             // Uncomment if you are using Slate UI
             // PrivateDependencyModuleNames.AddRange(new string[] { "Slate", "SlateCore" });
@@ -0,0 +1,513 @@
+#include "OutOfCoreLife.h"
+
+#include "AutomataRandom.h"
+#include "HenselNotation.h"
+#include "LifeLanes.h"
+#include "Misc/FileHelper.h"
+#include "MyProject.h"
+#include "Rulesets.h"
+
+#if PLATFORM_LINUX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#elif PLATFORM_WINDOWS
+#include "Windows/AllowWindowsPlatformTypes.h"
+#include <windows.h>
+#include "Windows/HideWindowsPlatformTypes.h"
+#endif
+
+namespace
+{
+	constexpr uint32 ProgressMagic = 0x4F4F4350;
+
+	// contents of Progress.bin
+	struct FOutOfCoreProgress
+	{
+		uint32 Magic = 0;
+		int32 NumXCells = 0;
+		int32 NumZCells = 0;
+		int32 CurrentPlane = 0;
+		int64 NextStep = 0;
+	};
+}
+
+// A file mapped read-write in full. Address space is cheap on 64-bit, so the whole plane is one view,
+// and residency is managed with hints rather than by remapping windows
+class FOutOfCoreLife::FMappedPlane
+{
+public:
+
+	~FMappedPlane()
+	{
+#if PLATFORM_LINUX
+		if (Base != nullptr)
+		{
+			munmap(Base, Bytes);
+		}
+		if (File >= 0)
+		{
+			close(File);
+		}
+#elif PLATFORM_WINDOWS
+		if (Base != nullptr)
+		{
+			UnmapViewOfFile(Base);
+		}
+		if (Mapping != nullptr)
+		{
+			CloseHandle(Mapping);
+		}
+		if (File != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(File);
+		}
+#endif
+	}
+
+	// An existing file is only resized when bCreate is set. Otherwise it has to be InBytes already,
+	// so a plane saved for another grid is never cut down or padded out
+	bool Open(const FString& Path, int64 InBytes, bool bCreate)
+	{
+		Bytes = InBytes;
+
+#if PLATFORM_LINUX
+		File = open(TCHAR_TO_UTF8(*Path), bCreate ? O_RDWR | O_CREAT : O_RDWR, 0644);
+		if (File < 0)
+		{
+			return false;
+		}
+
+		struct stat Status;
+		bool bSized = bCreate ? ftruncate(File, Bytes) == 0 : fstat(File, &Status) == 0 && int64(Status.st_size) == Bytes;
+		if (!bSized)
+		{
+			return false;
+		}
+
+		void* Region = mmap(nullptr, Bytes, PROT_READ | PROT_WRITE, MAP_SHARED, File, 0);
+		Base = Region != MAP_FAILED ? (uint8*)Region : nullptr;
+#elif PLATFORM_WINDOWS
+		File = CreateFileW(*Path, GENERIC_READ | GENERIC_WRITE, 0, nullptr, bCreate ? OPEN_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (File == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+
+		LARGE_INTEGER Size;
+		if (!bCreate && (!GetFileSizeEx(File, &Size) || Size.QuadPart != Bytes))
+		{
+			return false;
+		}
+
+		Mapping = CreateFileMappingW(File, nullptr, PAGE_READWRITE, DWORD(uint64(Bytes) >> 32), DWORD(Bytes), nullptr);
+		Base = Mapping != nullptr ? (uint8*)MapViewOfFile(Mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0) : nullptr;
+#endif
+
+		return Base != nullptr;
+	}
+
+	uint64* GetWords() const { return (uint64*)Base; }
+
+	void Prefetch(int64 Offset, int64 Length)
+	{
+#if PLATFORM_LINUX
+		AlignToPages(Offset, Length);
+		madvise(Base + Offset, Length, MADV_WILLNEED);
+#endif
+	}
+
+	// writes the range back without waiting, then lets the OS drop it
+	void Evict(int64 Offset, int64 Length, bool bWait)
+	{
+		AlignToPages(Offset, Length);
+
+#if PLATFORM_LINUX
+		msync(Base + Offset, Length, bWait ? MS_SYNC : MS_ASYNC);
+		madvise(Base + Offset, Length, MADV_DONTNEED);
+
+		// unmapping leaves clean pages in the page cache, this drops those too
+		posix_fadvise(File, Offset, Length, POSIX_FADV_DONTNEED);
+#elif PLATFORM_WINDOWS
+		FlushViewOfFile(Base + Offset, SIZE_T(Length));
+		if (bWait)
+		{
+			FlushFileBuffers(File);
+		}
+
+		// unlocking pages that were never locked takes them out of the working set
+		VirtualUnlock(Base + Offset, SIZE_T(Length));
+#endif
+	}
+
+	// Writes the whole plane back and waits until it is on disk. The bands evicted during a step
+	// were only scheduled, so nothing that points at this plane may be saved before this returns
+	bool Flush()
+	{
+#if PLATFORM_LINUX
+		return msync(Base, Bytes, MS_SYNC) == 0;
+#elif PLATFORM_WINDOWS
+		return FlushViewOfFile(Base, 0) && FlushFileBuffers(File);
+#else
+		return true;
+#endif
+	}
+
+private:
+
+	uint8* Base = nullptr;
+	int64 Bytes = 0;
+
+#if PLATFORM_LINUX
+	int File = -1;
+#elif PLATFORM_WINDOWS
+	HANDLE File = INVALID_HANDLE_VALUE;
+	HANDLE Mapping = nullptr;
+#endif
+
+	// widens the range to whole pages, as the hints require, without leaving the file
+	void AlignToPages(int64& Offset, int64& Length) const
+	{
+		const int64 PageSize = 4096;
+
+		int64 End = FMath::Min(Bytes, Align(Offset + Length, PageSize));
+		Offset = AlignDown(Offset, PageSize);
+		Length = FMath::Max<int64>(End - Offset, 0);
+	}
+};
+
+FOutOfCoreLife::FOutOfCoreLife(const FOutOfCoreConfig& InConfig)
+	: Config(InConfig)
+	, Maker(&Config.Grid)
+{
+	Maker.SetRule(Config.GridRule);
+
+	RowWords = (Config.Grid.NumXCells + 63) / 64;
+	BandRows = Config.BandRows > 0 ? Config.BandRows : FMath::Max(1, int((64 << 20) / (int64(RowWords) * sizeof(uint64))));
+	Config.ResidentBands = FMath::Max(Config.ResidentBands, 1);
+
+	if (AutomataHensel::IsNonTotalistic(Config.BirthString) || AutomataHensel::IsNonTotalistic(Config.SurviveString))
+	{
+		UE_LOG(LogAutomata, Warning, TEXT("Out of core runs only step outer totalistic rules, so the letters in B%s/S%s are ignored"), *Config.BirthString, *Config.SurviveString);
+	}
+
+	BirthMask = LifeLanes::RuleMask(AutomataFuncs::StringToRule(Config.BirthString));
+	SurviveMask = LifeLanes::RuleMask(AutomataFuncs::StringToRule(Config.SurviveString));
+}
+
+FOutOfCoreLife::~FOutOfCoreLife()
+{
+}
+
+FString FOutOfCoreLife::GetPlanePath(int Plane) const
+{
+	return FPaths::Combine(Config.Directory, FString::Printf(TEXT("Plane%d.bits"), Plane));
+}
+
+FString FOutOfCoreLife::GetProgressPath() const
+{
+	return FPaths::Combine(Config.Directory, TEXT("Progress.bin"));
+}
+
+void FOutOfCoreLife::SaveProgress() const
+{
+	// a record naming a plane that is still partly in memory would resume from a torn generation
+	if (!Planes[CurrentPlane]->Flush())
+	{
+		UE_LOG(LogAutomata, Warning, TEXT("Could not flush %s, so %s was not updated to step %lld"), *GetPlanePath(CurrentPlane), *GetProgressPath(), NextStep);
+		return;
+	}
+
+	FOutOfCoreProgress Progress;
+	Progress.Magic = ProgressMagic;
+	Progress.NumXCells = Config.Grid.NumXCells;
+	Progress.NumZCells = Config.Grid.NumZCells;
+	Progress.CurrentPlane = CurrentPlane;
+	Progress.NextStep = NextStep;
+
+	TArray<uint8> Bytes((const uint8*)&Progress, sizeof(Progress));
+	if (!FFileHelper::SaveArrayToFile(Bytes, *GetProgressPath()))
+	{
+		UE_LOG(LogAutomata, Warning, TEXT("Could not write %s, a resume will not find step %lld"), *GetProgressPath(), NextStep);
+	}
+}
+
+bool FOutOfCoreLife::LoadProgress()
+{
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *GetProgressPath()) || Bytes.Num() != sizeof(FOutOfCoreProgress))
+	{
+		UE_LOG(LogAutomata, Error, TEXT("No progress record at %s"), *GetProgressPath());
+		return false;
+	}
+
+	FOutOfCoreProgress Progress;
+	FMemory::Memcpy(&Progress, Bytes.GetData(), sizeof(Progress));
+
+	if (Progress.Magic != ProgressMagic || Progress.CurrentPlane < 0 || Progress.CurrentPlane > 1 || Progress.NextStep < 0)
+	{
+		UE_LOG(LogAutomata, Error, TEXT("%s is not a valid progress record"), *GetProgressPath());
+		return false;
+	}
+
+	if (Progress.NumXCells != Config.Grid.NumXCells || Progress.NumZCells != Config.Grid.NumZCells)
+	{
+		UE_LOG(LogAutomata, Error, TEXT("Planes in %s are %dx%d, not %dx%d"), *Config.Directory, Progress.NumXCells, Progress.NumZCells, Config.Grid.NumXCells, Config.Grid.NumZCells);
+		return false;
+	}
+
+	CurrentPlane = Progress.CurrentPlane;
+	NextStep = Progress.NextStep;
+	return true;
+}
+
+bool FOutOfCoreLife::Open(bool bCreate)
+{
+	if (Config.Grid.Shape != CellShape::Square)
+	{
+		UE_LOG(LogAutomata, Error, TEXT("Out-of-core grids only use square cells"));
+		return false;
+	}
+
+	IFileManager::Get().MakeDirectory(*Config.Directory, true);
+
+	// the record is checked first, so planes of another size are refused before they're touched
+	if (!bCreate && !LoadProgress())
+	{
+		return false;
+	}
+
+	for (int Plane = 0; Plane < 2; ++Plane)
+	{
+		if (!bCreate && !FPaths::FileExists(GetPlanePath(Plane)))
+		{
+			return false;
+		}
+
+		Planes[Plane] = MakeUnique<FMappedPlane>();
+		if (!Planes[Plane]->Open(GetPlanePath(Plane), GetPlaneBytes(), bCreate))
+		{
+			UE_LOG(LogAutomata, Error, TEXT("Could not map %lld bytes of %s"), GetPlaneBytes(), *GetPlanePath(Plane));
+			Planes[Plane].Reset();
+			return false;
+		}
+	}
+	return true;
+}
+
+void FOutOfCoreLife::PrefetchRows(int Plane, int First, int End)
+{
+	First = FMath::Max(First, 0);
+	End = FMath::Min(End, Config.Grid.NumZCells);
+	if (First < End)
+	{
+		int64 RowBytes = int64(RowWords) * sizeof(uint64);
+		Planes[Plane]->Prefetch(First * RowBytes, (End - First) * RowBytes);
+	}
+}
+
+void FOutOfCoreLife::EvictRows(int Plane, int First, int End)
+{
+	First = FMath::Max(First, 0);
+	End = FMath::Min(End, Config.Grid.NumZCells);
+	if (First < End)
+	{
+		int64 RowBytes = int64(RowWords) * sizeof(uint64);
+		Planes[Plane]->Evict(First * RowBytes, (End - First) * RowBytes, false);
+	}
+}
+
+void FOutOfCoreLife::DropCaches()
+{
+	for (TUniquePtr<FMappedPlane>& Plane : Planes)
+	{
+		Plane->Evict(0, GetPlaneBytes(), true);
+	}
+}
+
+void FOutOfCoreLife::InitializeCellStates(float Probability, int32 Seed)
+{
+	uint64 Threshold = AutomataRandom::BernoulliThreshold(Probability);
+	uint64* Plane = Planes[CurrentPlane]->GetWords();
+	int NumXCells = Config.Grid.NumXCells;
+
+	for (int First = 0; First < Config.Grid.NumZCells; First += BandRows)
+	{
+		int End = FMath::Min(First + BandRows, Config.Grid.NumZCells);
+
+		ParallelFor(End - First, [&](int32 Local)
+		{
+			int z = First + Local;
+			uint64* Row = RowOf(Plane, z);
+
+			for (int WordID = 0; WordID < RowWords; ++WordID)
+			{
+				int NumBits = FMath::Min(64, NumXCells - WordID * 64);
+				uint64 FirstCell = uint64(z) * NumXCells + WordID * 64;
+
+				uint64 Word = 0;
+				for (int Bit = 0; Bit < NumBits; ++Bit)
+				{
+					Word |= uint64(AutomataRandom::Hash(uint32(Seed), AutomataRandom::CellStates, FirstCell + Bit) < Threshold) << Bit;
+				}
+				Row[WordID] = Word;
+			}
+		});
+
+		EvictRows(CurrentPlane, First, End);
+	}
+
+	NextStep = 0;
+	SaveProgress();
+}
+
+void FOutOfCoreLife::Step()
+{
+	const uint64* Current = Planes[CurrentPlane]->GetWords();
+	uint64* Next = Planes[1 - CurrentPlane]->GetWords();
+	int NumZCells = Config.Grid.NumZCells;
+
+	// the first band's halo row comes from the far edge on wrapping rules
+	PrefetchRows(CurrentPlane, 0, BandRows + 1);
+	PrefetchRows(CurrentPlane, NumZCells - 1, NumZCells);
+
+	int Band = 0;
+	for (int First = 0; First < NumZCells; First += BandRows, ++Band)
+	{
+		int End = FMath::Min(First + BandRows, NumZCells);
+
+		// reads of the next band overlap with stepping this one
+		PrefetchRows(CurrentPlane, End + 1, End + BandRows + 1);
+
+		ParallelFor(End - First, [&](int32 Local)
+		{
+			StepRow(First + Local, Current, Next);
+		});
+
+		// the band falling out of the resident window is written back, and dropped from both planes
+		int Behind = First - Config.ResidentBands * BandRows;
+		EvictRows(1 - CurrentPlane, Behind, Behind + BandRows);
+		EvictRows(CurrentPlane, Behind, Behind + BandRows);
+	}
+
+	CurrentPlane = 1 - CurrentPlane;
+	++NextStep;
+	SaveProgress();
+}
+
+void FOutOfCoreLife::StepRow(int z, const uint64* Current, uint64* Next)
+{
+	int NumXCells = Config.Grid.NumXCells;
+	int NumZCells = Config.Grid.NumZCells;
+	uint64* Out = RowOf(Next, z);
+
+	// edge rows read across the edge rule on every cell
+	if (z == 0 || z == NumZCells - 1 || NumXCells < 3)
+	{
+		for (int WordID = 0; WordID < RowWords; ++WordID)
+		{
+			uint64 Word = 0;
+			for (int Bit = 0; Bit < 64 && WordID * 64 + Bit < NumXCells; ++Bit)
+			{
+				Word |= uint64(StepCell(WordID * 64 + Bit, z, Current)) << Bit;
+			}
+			Out[WordID] = Word;
+		}
+		return;
+	}
+
+	const uint64* Rows[3] = { RowOf(Current, z - 1), RowOf(Current, z), RowOf(Current, z + 1) };
+
+	for (int WordID = 0; WordID < RowWords; ++WordID)
+	{
+		// each lane's west and east neighbor, with bits carried across from the adjacent words
+		uint64 West[3];
+		uint64 East[3];
+		for (int r = 0; r < 3; ++r)
+		{
+			const uint64* Row = Rows[r];
+			West[r] = (Row[WordID] << 1) | (WordID > 0 ? Row[WordID - 1] >> 63 : 0);
+			East[r] = (Row[WordID] >> 1) | (WordID + 1 < RowWords ? Row[WordID + 1] << 63 : 0);
+		}
+
+		const uint64 Neighbors[8] = { Rows[0][WordID], West[0], East[0], West[1], East[1], Rows[2][WordID], West[2], East[2] };
+		Out[WordID] = LifeLanes::Step(Rows[1][WordID], Neighbors, BirthMask, SurviveMask);
+	}
+
+	// padding past the last column stays clear
+	if (NumXCells % 64 != 0)
+	{
+		Out[RowWords - 1] &= (uint64(1) << (NumXCells % 64)) - 1;
+	}
+
+	// the first and last columns read across the edge rule
+	uint64 FirstBit = uint64(1);
+	uint64 LastBit = uint64(1) << ((NumXCells - 1) & 63);
+	Out[0] = (Out[0] & ~FirstBit) | (StepCell(0, z, Current) ? FirstBit : 0);
+	Out[RowWords - 1] = (Out[RowWords - 1] & ~LastBit) | (StepCell(NumXCells - 1, z, Current) ? LastBit : 0);
+}
+
+bool FOutOfCoreLife::StepCell(int x, int z, const uint64* Current)
+{
+	int NumXCells = Config.Grid.NumXCells;
+	int NumZCells = Config.Grid.NumZCells;
+
+	// as in FNeighborhoodMaker, a cell reached twice through the edge rule is only counted once
+	FIntPoint Reached[8];
+	int NumReached = 0;
+	int Count = 0;
+
+	for (int dz = -1; dz <= 1; ++dz)
+	{
+		for (int dx = -1; dx <= 1; ++dx)
+		{
+			FIntPoint Coord(x + dx, z + dz);
+			if ((dx == 0 && dz == 0) || !Maker.MapCoord(Coord))
+			{
+				continue;
+			}
+
+			bool bRepeat = false;
+			for (int i = 0; i < NumReached; ++i)
+			{
+				bRepeat |= Reached[i] == Coord;
+			}
+			if (bRepeat)
+			{
+				continue;
+			}
+
+			Reached[NumReached++] = Coord;
+			Count += GetBit(RowOf(Current, Coord.Y), Coord.X);
+		}
+	}
+
+	bool bAlive = GetBit(RowOf(Current, z), x);
+	return ((bAlive ? SurviveMask : BirthMask) >> Count) & 1;
+}
+
+void FOutOfCoreLife::ReadWindow(FIntPoint Origin, int NumXCells, int NumZCells, TArray<int>& OutStates) const
+{
+	const uint64* Current = Planes[CurrentPlane]->GetWords();
+	OutStates.Init(0, NumXCells * NumZCells);
+
+	for (int z = 0; z < NumZCells; ++z)
+	{
+		int GridZ = Origin.Y + z;
+		if (GridZ < 0 || GridZ >= Config.Grid.NumZCells)
+		{
+			continue;
+		}
+
+		const uint64* Row = RowOf(Current, GridZ);
+		for (int x = 0; x < NumXCells; ++x)
+		{
+			int GridX = Origin.X + x;
+			if (GridX >= 0 && GridX < Config.Grid.NumXCells)
+			{
+				OutStates[z * NumXCells + x] = GetBit(Row, GridX);
+			}
+		}
+	}
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GridRules.h"
+
+struct FOutOfCoreConfig
+{
+	// square cells only, and NumXCells * NumZCells may run far past what an int can count
+	FBasicGrid Grid;
+	BoundGridRuleset GridRule = BoundGridRuleset::Torus;
+
+	FString BirthString = TEXT("3");
+	FString SurviveString = TEXT("23");
+
+	// the two state planes are kept here, as Plane0.bits and Plane1.bits, with Progress.bin recording
+	// the grid size, the step count and which plane holds the newest generation
+	FString Directory;
+
+	// rows stepped together. 0 picks bands of roughly 64MB
+	int BandRows = 0;
+
+	// bands kept resident behind the one being stepped, the first of which supplies its halo row
+	int ResidentBands = 2;
+};
+
+// A two-state Moore board too large for memory. Both bit-packed state planes are memory-mapped files, and a step
+// streams through them in row bands: the band ahead is prefetched while the current one is stepped, and bands
+// falling behind the resident window are written back and dropped. Rows step 64 cells per word as FSparseLife does;
+// only cells on the grid's edges go through the edge rule, one at a time, with the same semantics as FNeighborhoodMaker
+class FOutOfCoreLife
+{
+public:
+
+	explicit FOutOfCoreLife(const FOutOfCoreConfig& InConfig);
+	~FOutOfCoreLife();
+
+	// Maps the planes, creating them at full size. Unless bCreate is set, both must already exist at this grid's size,
+	// and the step and current plane are restored from Progress.bin
+	bool Open(bool bCreate);
+
+	// the same cells AutomataRandom::FillBernoulli would give a grid of this size
+	void InitializeCellStates(float Probability, int32 Seed);
+
+	void Step();
+
+	// copies a rectangle of cells out for display, laid out as a grid of its size
+	void ReadWindow(FIntPoint Origin, int NumXCells, int NumZCells, TArray<int>& OutStates) const;
+
+	// writes every dirty page back and evicts both planes, so the next pass reads from disk
+	void DropCaches();
+
+	int64 GetNumCells() const { return int64(Config.Grid.NumXCells) * Config.Grid.NumZCells; }
+	int64 GetPlaneBytes() const { return int64(Config.Grid.NumZCells) * RowWords * sizeof(uint64); }
+	int64 GetStep() const { return NextStep; }
+	FString GetPlanePath(int Plane) const;
+	FString GetProgressPath() const;
+
+private:
+
+	class FMappedPlane;
+
+	FOutOfCoreConfig Config;
+	FNeighborhoodMaker Maker;
+
+	TUniquePtr<FMappedPlane> Planes[2];
+	int CurrentPlane = 0;
+	int64 NextStep = 0;
+
+	int RowWords = 0;
+	int BandRows = 0;
+
+	uint32 BirthMask = 0;
+	uint32 SurviveMask = 0;
+
+	const uint64* RowOf(const uint64* Plane, int z) const { return Plane + int64(z) * RowWords; }
+	uint64* RowOf(uint64* Plane, int z) const { return Plane + int64(z) * RowWords; }
+
+	static bool GetBit(const uint64* Row, int x) { return (Row[x >> 6] >> (x & 63)) & 1; }
+
+	void StepRow(int z, const uint64* Current, uint64* Next);
+
+	// one cell, with its neighborhood mapped through the edge rule
+	bool StepCell(int x, int z, const uint64* Current);
+
+	// prefetches, or writes back and drops, rows [First, End) of a plane
+	void PrefetchRows(int Plane, int First, int End);
+	void EvictRows(int Plane, int First, int End);
+
+	// Written after seeding and after every step, so a resumed run carries on from the newest generation.
+	// The plane it names is flushed to disk first
+	void SaveProgress() const;
+	bool LoadProgress();
+};
@@ -0,0 +1,800 @@
+#include "PatternIO.h"
+
+#include "Async/MappedFileHandle.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+#include "GridRules.h"
+#include "HenselNotation.h"
+#include "MyProject.h"
+
+namespace
+{
+	// read-only view of a mapped text file
+	struct FMappedText
+	{
+		TUniquePtr<IMappedFileHandle> Handle;
+		TUniquePtr<IMappedFileRegion> Region;
+
+		const ANSICHAR* Begin = nullptr;
+		const ANSICHAR* End = nullptr;
+
+		bool Open(const FString& Path)
+		{
+			Handle.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*Path));
+			if (!Handle || Handle->GetFileSize() == 0)
+			{
+				return false;
+			}
+
+			Region.Reset(Handle->MapRegion(0, Handle->GetFileSize()));
+			if (!Region)
+			{
+				return false;
+			}
+
+			Begin = reinterpret_cast<const ANSICHAR*>(Region->GetMappedPtr());
+			End = Begin + Region->GetMappedSize();
+			return true;
+		}
+	};
+
+	struct FPatternBox
+	{
+		int64 MinX = TNumericLimits<int64>::Max();
+		int64 MinY = TNumericLimits<int64>::Max();
+		int64 MaxX = TNumericLimits<int64>::Min();
+		int64 MaxY = TNumericLimits<int64>::Min();
+
+		bool IsEmpty() const { return MinX > MaxX; }
+
+		void Add(int64 X, int64 Y)
+		{
+			MinX = FMath::Min(MinX, X);
+			MinY = FMath::Min(MinY, Y);
+			MaxX = FMath::Max(MaxX, X);
+			MaxY = FMath::Max(MaxY, Y);
+		}
+
+		void Add(const FPatternBox& Other, int64 OffsetX, int64 OffsetY)
+		{
+			if (!Other.IsEmpty())
+			{
+				Add(Other.MinX + OffsetX, Other.MinY + OffsetY);
+				Add(Other.MaxX + OffsetX, Other.MaxY + OffsetY);
+			}
+		}
+	};
+
+	// Clips pattern cells against the grid as they are written.
+	// Without a grid, runs are passed on unclipped instead, for boards with no bounds
+	struct FPatternTarget
+	{
+		const FBasicGrid* Grid;
+		TArray<int>* States;
+		const TFunctionRef<void(int64, int64, int64, int)>* Runs;
+		int64 OffsetX;
+		int64 OffsetY;
+
+		void SetRun(int64 X, int64 Y, int64 Count, int State) const
+		{
+			if (Grid == nullptr)
+			{
+				(*Runs)(X + OffsetX, Y + OffsetY, Count, State);
+				return;
+			}
+
+			int64 GridZ = Y + OffsetY;
+			if (GridZ < 0 || GridZ >= Grid->NumZCells)
+			{
+				return;
+			}
+
+			int64 First = FMath::Max<int64>(X + OffsetX, 0);
+			int64 Last = FMath::Min<int64>(X + OffsetX + Count, Grid->NumXCells);
+			for (int64 GridX = First; GridX < Last; ++GridX)
+			{
+				(*States)[Grid->CoordToCellID(FIntPoint(int32(GridX), int32(GridZ)))] = State;
+			}
+		}
+
+		// whether a box in pattern coordinates overlaps the grid at all
+		bool Overlaps(int64 MinX, int64 MinY, int64 MaxX, int64 MaxY) const
+		{
+			return	Grid == nullptr ||
+					(MaxX + OffsetX >= 0 && MinX + OffsetX < Grid->NumXCells &&
+					MaxY + OffsetY >= 0 && MinY + OffsetY < Grid->NumZCells);
+		}
+	};
+
+	bool IsDigit(ANSICHAR Character)
+	{
+		return Character >= '0' && Character <= '9';
+	}
+
+	void SkipLine(const ANSICHAR*& Cursor, const ANSICHAR* End)
+	{
+		while (Cursor < End && *Cursor != '\n')
+		{
+			++Cursor;
+		}
+		if (Cursor < End)
+		{
+			++Cursor;
+		}
+	}
+
+	void SkipSpaces(const ANSICHAR*& Cursor, const ANSICHAR* End)
+	{
+		while (Cursor < End && (*Cursor == ' ' || *Cursor == '\t'))
+		{
+			++Cursor;
+		}
+	}
+
+	int64 ParseNumber(const ANSICHAR*& Cursor, const ANSICHAR* End)
+	{
+		int64 Value = 0;
+		while (Cursor < End && IsDigit(*Cursor))
+		{
+			Value = Value * 10 + (*Cursor - '0');
+			++Cursor;
+		}
+		return Value;
+	}
+
+	bool ParseRLE(const ANSICHAR* Cursor, const ANSICHAR* End, FPatternTarget Target)
+	{
+		// comments, then the "x = m, y = n" header. Cells are clipped as they're written, so the size isn't needed
+		while (Cursor < End)
+		{
+			SkipSpaces(Cursor, End);
+			if (Cursor < End && (*Cursor == '#' || *Cursor == '\r' || *Cursor == '\n'))
+			{
+				SkipLine(Cursor, End);
+				continue;
+			}
+			if (Cursor < End && *Cursor == 'x')
+			{
+				SkipLine(Cursor, End);
+			}
+			break;
+		}
+
+		int64 X = 0;
+		int64 Y = 0;
+		while (Cursor < End)
+		{
+			int64 Count = IsDigit(*Cursor) ? ParseNumber(Cursor, End) : 1;
+			if (Cursor >= End)
+			{
+				break;
+			}
+
+			ANSICHAR Tag = *Cursor++;
+			int State = 0;
+
+			if (Tag == '!')
+			{
+				break;
+			}
+			else if (Tag == '$')
+			{
+				Y += Count;
+				X = 0;
+				continue;
+			}
+			else if (Tag == 'b' || Tag == '.')
+			{
+				X += Count;
+				continue;
+			}
+			else if (Tag == 'o')
+			{
+				State = 1;
+			}
+			else if (Tag >= 'A' && Tag <= 'X')
+			{
+				State = Tag - 'A' + 1;
+			}
+			else if (Tag >= 'p' && Tag <= 'y' && Cursor < End && *Cursor >= 'A' && *Cursor <= 'X')
+			{
+				// multi-state prefixes extend the alphabet past 24 states
+				State = 24 * (Tag - 'p' + 1) + (*Cursor - 'A') + 1;
+				++Cursor;
+			}
+			else
+			{
+				// whitespace and line breaks
+				continue;
+			}
+
+			Target.SetRun(X, Y, Count, State);
+			X += Count;
+		}
+
+		return true;
+	}
+
+	bool ParsePlaintext(const ANSICHAR* Cursor, const ANSICHAR* End, FPatternTarget Target)
+	{
+		int64 Y = 0;
+		while (Cursor < End)
+		{
+			if (*Cursor == '!')
+			{
+				SkipLine(Cursor, End);
+				continue;
+			}
+
+			int64 X = 0;
+			while (Cursor < End && *Cursor != '\n')
+			{
+				ANSICHAR Character = *Cursor++;
+				if (Character == 'O' || Character == '*')
+				{
+					Target.SetRun(X, Y, 1, 1);
+				}
+				if (Character != '\r')
+				{
+					++X;
+				}
+			}
+			SkipLine(Cursor, End);
+			++Y;
+		}
+
+		return true;
+	}
+
+	struct FMacroNode
+	{
+		int Level = 0;
+
+		// node numbers of the nw, ne, sw and se quadrants, or the cell states of a level 1 node
+		int Children[4] = {};
+
+		// rows of an 8x8 leaf, the least significant bit of each byte is the leftmost cell
+		uint64 Leaf = 0;
+
+		// live cells relative to the node's top-left corner
+		FPatternBox Box;
+	};
+
+	struct FMacrocellReader
+	{
+		// node 0 is the empty node
+		TArray<FMacroNode> Nodes = { FMacroNode() };
+
+		bool ParseLeaf(const ANSICHAR*& Cursor, const ANSICHAR* End)
+		{
+			FMacroNode Node;
+			Node.Level = 3;
+
+			int X = 0;
+			int Y = 0;
+			while (Cursor < End && *Cursor != '\n' && *Cursor != '\r')
+			{
+				ANSICHAR Character = *Cursor++;
+				if (Character == '$')
+				{
+					++Y;
+					X = 0;
+				}
+				else
+				{
+					if (Character == '*' && X < 8 && Y < 8)
+					{
+						Node.Leaf |= uint64(1) << (Y * 8 + X);
+						Node.Box.Add(X, Y);
+					}
+					++X;
+				}
+			}
+
+			Nodes.Add(Node);
+			return true;
+		}
+
+		bool ParseNode(const ANSICHAR*& Cursor, const ANSICHAR* End)
+		{
+			FMacroNode Node;
+			Node.Level = int(ParseNumber(Cursor, End));
+
+			for (int& Child : Node.Children)
+			{
+				SkipSpaces(Cursor, End);
+				Child = int(ParseNumber(Cursor, End));
+			}
+
+			if (Node.Level < 1 || Node.Level > 62)
+			{
+				return false;
+			}
+
+			if (Node.Level == 1)
+			{
+				for (int Quadrant = 0; Quadrant < 4; ++Quadrant)
+				{
+					if (Node.Children[Quadrant] != 0)
+					{
+						Node.Box.Add(Quadrant % 2, Quadrant / 2);
+					}
+				}
+			}
+			else
+			{
+				int64 Half = int64(1) << (Node.Level - 1);
+				for (int Quadrant = 0; Quadrant < 4; ++Quadrant)
+				{
+					// children are always defined before their parents
+					if (!Nodes.IsValidIndex(Node.Children[Quadrant]))
+					{
+						return false;
+					}
+					Node.Box.Add(Nodes[Node.Children[Quadrant]].Box, (Quadrant % 2) * Half, (Quadrant / 2) * Half);
+				}
+			}
+
+			Nodes.Add(Node);
+			return true;
+		}
+
+		bool Parse(const ANSICHAR* Cursor, const ANSICHAR* End)
+		{
+			while (Cursor < End)
+			{
+				ANSICHAR Character = *Cursor;
+				if (Character == '[' || Character == '#' || Character == '\r' || Character == '\n')
+				{
+					SkipLine(Cursor, End);
+					continue;
+				}
+
+				bool bParsed = IsDigit(Character) ? ParseNode(Cursor, End) : ParseLeaf(Cursor, End);
+				if (!bParsed)
+				{
+					return false;
+				}
+				SkipLine(Cursor, End);
+			}
+
+			return Nodes.Num() > 1;
+		}
+
+		void Render(int NodeID, int64 X, int64 Y, const FPatternTarget& Target) const
+		{
+			const FMacroNode& Node = Nodes[NodeID];
+			if (NodeID == 0 || Node.Box.IsEmpty())
+			{
+				return;
+			}
+
+			if (!Target.Overlaps(X + Node.Box.MinX, Y + Node.Box.MinY, X + Node.Box.MaxX, Y + Node.Box.MaxY))
+			{
+				return;
+			}
+
+			if (Node.Level == 1)
+			{
+				for (int Quadrant = 0; Quadrant < 4; ++Quadrant)
+				{
+					if (Node.Children[Quadrant] != 0)
+					{
+						Target.SetRun(X + Quadrant % 2, Y + Quadrant / 2, 1, Node.Children[Quadrant]);
+					}
+				}
+			}
+			else if (Node.Level == 3 && Node.Leaf != 0)
+			{
+				uint64 Bits = Node.Leaf;
+				while (Bits)
+				{
+					int Bit = int(FMath::CountTrailingZeros64(Bits));
+					Target.SetRun(X + Bit % 8, Y + Bit / 8, 1, 1);
+					Bits &= Bits - 1;
+				}
+			}
+			else
+			{
+				int64 Half = int64(1) << (Node.Level - 1);
+				for (int Quadrant = 0; Quadrant < 4; ++Quadrant)
+				{
+					Render(Node.Children[Quadrant], X + (Quadrant % 2) * Half, Y + (Quadrant / 2) * Half, Target);
+				}
+			}
+		}
+	};
+
+	FPatternBox LiveBox(const FBasicGrid& Grid, const TArray<int>& States, int& OutMaxState)
+	{
+		FPatternBox Box;
+		OutMaxState = 0;
+
+		for (int Z = 0; Z < Grid.NumZCells; ++Z)
+		{
+			for (int X = 0; X < Grid.NumXCells; ++X)
+			{
+				int State = States[Grid.CoordToCellID(FIntPoint(X, Z))];
+				if (State != 0)
+				{
+					Box.Add(X, Z);
+					OutMaxState = FMath::Max(OutMaxState, State);
+				}
+			}
+		}
+
+		return Box;
+	}
+
+	// dead cells at the end of a row are implied in every format
+	void TrimTrailingDead(FString& Row)
+	{
+		int32 LastAlive = Row.Len() - 1;
+		while (LastAlive >= 0 && Row[LastAlive] == TEXT('.'))
+		{
+			--LastAlive;
+		}
+		Row.LeftInline(LastAlive + 1);
+	}
+
+	FString RLETag(int State, bool bMultiState)
+	{
+		if (!bMultiState)
+		{
+			return State ? TEXT("o") : TEXT("b");
+		}
+		if (State == 0)
+		{
+			return TEXT(".");
+		}
+		if (State <= 24)
+		{
+			return FString::Chr(TCHAR('A' + State - 1));
+		}
+		return FString::Chr(TCHAR('p' + (State - 1) / 24 - 1)) + FString::Chr(TCHAR('A' + (State - 1) % 24));
+	}
+
+	struct FRLEWriter
+	{
+		FString Out;
+		int LineLength = 0;
+
+		void Token(int64 Count, const FString& Tag)
+		{
+			FString Text = Count > 1 ? FString::Printf(TEXT("%lld%s"), Count, *Tag) : Tag;
+			if (LineLength + Text.Len() > 70)
+			{
+				Out += TEXT("\n");
+				LineLength = 0;
+			}
+			Out += Text;
+			LineLength += Text.Len();
+		}
+	};
+
+	FString WriteRLE(const FBasicGrid& Grid, const TArray<int>& States, const FPatternBox& Box, int MaxState, const FString& Rule)
+	{
+		bool bMultiState = MaxState > 1;
+
+		FRLEWriter Writer;
+		Writer.Out = FString::Printf(TEXT("x = %lld, y = %lld"), Box.MaxX - Box.MinX + 1, Box.MaxY - Box.MinY + 1);
+		if (!Rule.IsEmpty())
+		{
+			Writer.Out += FString::Printf(TEXT(", rule = %s"), *Rule);
+		}
+		Writer.Out += TEXT("\n");
+
+		int64 PendingRows = 0;
+		for (int64 Z = Box.MinY; Z <= Box.MaxY; ++Z)
+		{
+			int64 X = Box.MinX;
+			while (X <= Box.MaxX)
+			{
+				int State = States[Grid.CoordToCellID(FIntPoint(int32(X), int32(Z)))];
+				int64 RunEnd = X + 1;
+				while (RunEnd <= Box.MaxX && States[Grid.CoordToCellID(FIntPoint(int32(RunEnd), int32(Z)))] == State)
+				{
+					++RunEnd;
+				}
+
+				// trailing dead cells of a row are implied
+				if (State == 0 && RunEnd > Box.MaxX)
+				{
+					break;
+				}
+
+				if (PendingRows > 0)
+				{
+					Writer.Token(PendingRows, TEXT("$"));
+					PendingRows = 0;
+				}
+				Writer.Token(RunEnd - X, RLETag(State, bMultiState));
+				X = RunEnd;
+			}
+			++PendingRows;
+		}
+
+		Writer.Out += TEXT("!\n");
+		return MoveTemp(Writer.Out);
+	}
+
+	FString WritePlaintext(const FBasicGrid& Grid, const TArray<int>& States, const FPatternBox& Box, const FString& Path)
+	{
+		FString Out = FString::Printf(TEXT("!Name: %s\n"), *FPaths::GetBaseFilename(Path));
+
+		for (int64 Z = Box.MinY; Z <= Box.MaxY; ++Z)
+		{
+			FString Row;
+			for (int64 X = Box.MinX; X <= Box.MaxX; ++X)
+			{
+				Row += States[Grid.CoordToCellID(FIntPoint(int32(X), int32(Z)))] ? TEXT("O") : TEXT(".");
+			}
+			TrimTrailingDead(Row);
+			Out += Row + TEXT("\n");
+		}
+
+		return Out;
+	}
+
+	struct FMacroKey
+	{
+		int Level = 0;
+		uint64 A = 0;
+		uint64 B = 0;
+
+		bool operator==(const FMacroKey& Other) const
+		{
+			return Level == Other.Level && A == Other.A && B == Other.B;
+		}
+
+		friend uint32 GetTypeHash(const FMacroKey& Key)
+		{
+			return HashCombine(HashCombine(GetTypeHash(Key.Level), GetTypeHash(Key.A)), GetTypeHash(Key.B));
+		}
+	};
+
+	// builds the quadtree bottom-up, sharing identical nodes, and writes each node the first time it's seen
+	struct FMacrocellWriter
+	{
+		const FBasicGrid& Grid;
+		const TArray<int>& States;
+		FPatternBox Box;
+		bool bMultiState;
+
+		TMap<FMacroKey, int> NodeIDs;
+		FString Out;
+		int NextID = 1;
+
+		int State(int64 X, int64 Y) const
+		{
+			X += Box.MinX;
+			Y += Box.MinY;
+			if (X > Box.MaxX || Y > Box.MaxY)
+			{
+				return 0;
+			}
+			return States[Grid.CoordToCellID(FIntPoint(int32(X), int32(Y)))];
+		}
+
+		int AddNode(const FMacroKey& Key, const FString& Line)
+		{
+			if (const int* Existing = NodeIDs.Find(Key))
+			{
+				return *Existing;
+			}
+			Out += Line + TEXT("\n");
+			NodeIDs.Add(Key, NextID);
+			return NextID++;
+		}
+
+		int Build(int Level, int64 X, int64 Y)
+		{
+			if (X + Box.MinX > Box.MaxX || Y + Box.MinY > Box.MaxY)
+			{
+				return 0;
+			}
+
+			if (Level == 1)
+			{
+				int Quadrants[4] = { State(X, Y), State(X + 1, Y), State(X, Y + 1), State(X + 1, Y + 1) };
+				if (!(Quadrants[0] | Quadrants[1] | Quadrants[2] | Quadrants[3]))
+				{
+					return 0;
+				}
+				FMacroKey Key{ 1, (uint64(Quadrants[0]) << 32) | uint32(Quadrants[1]), (uint64(Quadrants[2]) << 32) | uint32(Quadrants[3]) };
+				return AddNode(Key, FString::Printf(TEXT("1 %d %d %d %d"), Quadrants[0], Quadrants[1], Quadrants[2], Quadrants[3]));
+			}
+
+			if (Level == 3 && !bMultiState)
+			{
+				uint64 Leaf = 0;
+				FString Line;
+				for (int Row = 0; Row < 8; ++Row)
+				{
+					FString RowText;
+					for (int Column = 0; Column < 8; ++Column)
+					{
+						bool bAlive = State(X + Column, Y + Row) != 0;
+						Leaf |= uint64(bAlive) << (Row * 8 + Column);
+						RowText += bAlive ? TEXT("*") : TEXT(".");
+					}
+					TrimTrailingDead(RowText);
+					Line += RowText + TEXT("$");
+				}
+				if (Leaf == 0)
+				{
+					return 0;
+				}
+				// trailing empty rows are implied
+				while (Line.EndsWith(TEXT("$$")))
+				{
+					Line.LeftChopInline(1);
+				}
+				return AddNode({ 3, Leaf, 0 }, Line);
+			}
+
+			int64 Half = int64(1) << (Level - 1);
+			int Children[4] =
+			{
+				Build(Level - 1, X, Y),
+				Build(Level - 1, X + Half, Y),
+				Build(Level - 1, X, Y + Half),
+				Build(Level - 1, X + Half, Y + Half)
+			};
+
+			if (!(Children[0] | Children[1] | Children[2] | Children[3]))
+			{
+				return 0;
+			}
+
+			FMacroKey Key{ Level, (uint64(Children[0]) << 32) | uint32(Children[1]), (uint64(Children[2]) << 32) | uint32(Children[3]) };
+			return AddNode(Key, FString::Printf(TEXT("%d %d %d %d %d"), Level, Children[0], Children[1], Children[2], Children[3]));
+		}
+	};
+
+	FString WriteMacrocell(const FBasicGrid& Grid, const TArray<int>& States, const FPatternBox& Box, int MaxState, const FString& Rule)
+	{
+		FMacrocellWriter Writer{ Grid, States, Box, MaxState > 1 };
+		Writer.Out = TEXT("[M2] (Cellular-Automata)\n");
+		if (!Rule.IsEmpty())
+		{
+			Writer.Out += FString::Printf(TEXT("#R %s\n"), *Rule);
+		}
+
+		int64 Size = FMath::Max(Box.MaxX - Box.MinX, Box.MaxY - Box.MinY) + 1;
+		int Level = Writer.bMultiState ? 1 : 3;
+		while ((int64(1) << Level) < Size)
+		{
+			++Level;
+		}
+
+		Writer.Build(Level, 0, 0);
+		return MoveTemp(Writer.Out);
+	}
+}
+
+EPatternFormat AutomataPatterns::FormatFromPath(const FString& Path)
+{
+	FString Extension = FPaths::GetExtension(Path).ToLower();
+	if (Extension == TEXT("rle"))
+	{
+		return EPatternFormat::RLE;
+	}
+	if (Extension == TEXT("mc"))
+	{
+		return EPatternFormat::Macrocell;
+	}
+	return EPatternFormat::Plaintext;
+}
+
+namespace
+{
+	bool LoadInto(const FString& Path, const FPatternTarget& Target)
+	{
+		FMappedText Text;
+		if (!Text.Open(Path))
+		{
+			UE_LOG(LogAutomata, Error, TEXT("Could not open pattern %s"), *Path);
+			return false;
+		}
+
+		bool bLoaded = false;
+		switch (AutomataPatterns::FormatFromPath(Path))
+		{
+		case EPatternFormat::RLE:
+			bLoaded = ParseRLE(Text.Begin, Text.End, Target);
+			break;
+
+		case EPatternFormat::Macrocell:
+		{
+			FMacrocellReader Reader;
+			bLoaded = Reader.Parse(Text.Begin, Text.End);
+			if (bLoaded)
+			{
+				// the root is the last node, placed so that its live area starts at the offset
+				const FMacroNode& Root = Reader.Nodes.Last();
+				Reader.Render(Reader.Nodes.Num() - 1, -Root.Box.MinX, -Root.Box.MinY, Target);
+			}
+			break;
+		}
+
+		case EPatternFormat::Plaintext:
+			bLoaded = ParsePlaintext(Text.Begin, Text.End, Target);
+			break;
+		}
+
+		if (!bLoaded)
+		{
+			UE_LOG(LogAutomata, Error, TEXT("Pattern %s is malformed"), *Path);
+		}
+		return bLoaded;
+	}
+}
+
+bool AutomataPatterns::LoadPattern(const FString& Path, const FBasicGrid& Grid, FIntPoint Offset, TArray<int>& States)
+{
+	return LoadInto(Path, FPatternTarget{ &Grid, &States, nullptr, Offset.X, Offset.Y });
+}
+
+bool AutomataPatterns::LoadPatternRuns(const FString& Path, FIntPoint Offset, TFunctionRef<void(int64 X, int64 Z, int64 Count, int State)> SetRun)
+{
+	return LoadInto(Path, FPatternTarget{ nullptr, nullptr, &SetRun, Offset.X, Offset.Y });
+}
+
+bool AutomataPatterns::SavePattern(const FString& Path, const FBasicGrid& Grid, const TArray<int>& States, const FString& Rule)
+{
+	int MaxState = 0;
+	FPatternBox Box = LiveBox(Grid, States, MaxState);
+	if (Box.IsEmpty())
+	{
+		Box.Add(0, 0);
+	}
+
+	FString Out;
+	switch (FormatFromPath(Path))
+	{
+	case EPatternFormat::RLE:
+		Out = WriteRLE(Grid, States, Box, MaxState, Rule);
+		break;
+
+	case EPatternFormat::Macrocell:
+		Out = WriteMacrocell(Grid, States, Box, MaxState, Rule);
+		break;
+
+	case EPatternFormat::Plaintext:
+		if (MaxState > 1)
+		{
+			UE_LOG(LogAutomata, Warning, TEXT("Plaintext patterns are two-state, every nonzero cell in %s is written as alive"), *Path);
+		}
+		Out = WritePlaintext(Grid, States, Box, Path);
+		break;
+	}
+
+	if (!FFileHelper::SaveStringToFile(Out, *Path))
+	{
+		UE_LOG(LogAutomata, Error, TEXT("Could not write pattern %s"), *Path);
+		return false;
+	}
+	return true;
+}
+
+FString AutomataPatterns::MakeRuleString(const FString& BirthString, const FString& SurviveString)
+{
+	// Hensel letters and their '-' are kept, so a non-totalistic rule is written as itself
+	auto RuleCharacters = [](const FString& RuleDigits)
+	{
+		FString Result;
+		for (TCHAR Character : RuleDigits)
+		{
+			if (TChar<TCHAR>::IsDigit(Character) || Character == TEXT('-') || FCString::Strchr(AutomataHensel::LettersFor(4), Character) != nullptr)
+			{
+				Result.AppendChar(Character);
+			}
+		}
+		return Result;
+	};
+
+	return FString::Printf(TEXT("B%s/S%s"), *RuleCharacters(BirthString), *RuleCharacters(SurviveString));
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FBasicGrid;
+
+enum class EPatternFormat : uint8
+{
+	RLE,
+	Macrocell,
+	Plaintext
+};
+
+// Readers and writers for the standard Life pattern formats.
+// Patterns are parsed in one pass straight out of a mapped file,
+// and cells written to a grid are clipped to it.
+namespace AutomataPatterns
+{
+	// .rle and .mc files are read as RLE and Macrocell, anything else as plaintext
+	EPatternFormat FormatFromPath(const FString& Path);
+
+	// Writes the pattern's cells into States, with the top-left of its live area placed at Offset.
+	// Cells the pattern doesn't cover are left untouched.
+	bool LoadPattern(const FString& Path, const FBasicGrid& Grid, FIntPoint Offset, TArray<int>& States);
+
+	// Hands each horizontal run of nonzero cells to SetRun, with the top-left of the pattern's live area placed at Offset.
+	// Nothing is clipped, so patterns can go straight onto boards with no bounds
+	bool LoadPatternRuns(const FString& Path, FIntPoint Offset, TFunctionRef<void(int64 X, int64 Z, int64 Count, int State)> SetRun);
+
+	// Writes the bounding box of every nonzero cell. Rule is written into formats that carry one
+	bool SavePattern(const FString& Path, const FBasicGrid& Grid, const TArray<int>& States, const FString& Rule = FString());
+
+	// "B3/S23" style rule string from the factory's birth and survive strings, Hensel letters included, e.g. "B2n3/S23-q"
+	FString MakeRuleString(const FString& BirthString, const FString& SurviveString);
+}
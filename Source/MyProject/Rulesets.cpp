@@ -1,176 +1,1572 @@
 #include "Rulesets.h"
 #include "AutomataDisplay.h"
+#include "AutomataRandom.h"
+#include "AutomataSnapshot.h"
+#include "HenselNotation.h"
+#include "MyProject.h"
+#include "PatternIO.h"
+#include "StatePacking.h"
+
+constexpr int ULifelikeRule::BlockSize;
+constexpr int ULifelikeRule::MaxCyclePeriod;
+
+namespace
+{
+	// Zobrist key of a cell, XORed into the state hash while the cell is alive
+	uint64 CellHashKey(int CellID)
+	{
+		return AutomataRandom::Hash(0, AutomataRandom::StateHashKeys, CellID);
+	}
+
+	// Copies Array into fresh storage, each block's elements constructed by the worker that owns the block.
+	// Pages are placed by whoever touches them first, so every band of cells ends up on its stepping worker's node.
+	// Elements that own allocations of their own (neighborhoods) are copied rather than moved so those land too
+	template<typename T>
+	void FirstTouchCopy(FAutomataWorkerPool& Pool, TArray<T>& Array, int BlockSize)
+	{
+		TArray<T> Placed;
+		Placed.SetNumUninitialized(Array.Num());
+
+		Pool.RunOnOwners(FMath::DivideAndRoundUp(Array.Num(), BlockSize), [&](int32 BlockID)
+		{
+			int End = FMath::Min(Array.Num(), (BlockID + 1) * BlockSize);
+			for (int Index = BlockID * BlockSize; Index < End; ++Index)
+			{
+				new (&Placed[Index]) T(Array[Index]);
+			}
+		});
+
+		Array = MoveTemp(Placed);
+	}
+
+	void SetAll(TArrayView<bool> Flags, bool bValue)
+	{
+		FMemory::Memset(Flags.GetData(), bValue, Flags.Num());
+	}
+}
 
 void ULifelikeRule::PostNeighborhoodSetup()
 {
-	AutomataFuncs::MakeNeighborsOf(NeighborsOf, BaseMembers.Neighborhoods);
+	TArray<int> Counts;
+	TArray<int> Cells;
+	int Stride = 0;
+
+	// checking costs no allocation, where the transpose would hold another entry per neighbor
+	bSymmetricNeighborhoods = AutomataFuncs::AreNeighborhoodsSymmetric(BaseMembers.Neighborhoods);
+	if (!bSymmetricNeighborhoods)
+	{
+		AutomataFuncs::MakeNeighborsOf(BaseMembers.Neighborhoods, Counts, Cells, Stride);
+	}
+
+	int NumCells = BaseMembers.Neighborhoods.Num();
+
+	NextStates.Init(false, NumCells);
+
+	TArray<bool> AllFlagged;
+	AllFlagged.Init(true, NumCells);
+
+	if (!Pool)
+	{
+		Pool = MakeUnique<FAutomataWorkerPool>();
+	}
+
+	// the new neighborhoods are unchecked until SetGrid looks at them
+	bBlockLookup = false;
+	SetupTasks();
+
+	PlaceBuffers();
+	PlaceArena(Counts, Cells, Stride, AllFlagged, AllFlagged);
+
+	ResetCycleDetection();
+}
+
+void ULifelikeRule::SetupTasks()
+{
+	int NumCells = BaseMembers.Neighborhoods.Num();
+
+	// a lookup task takes whole row pairs, so no 2x2 block is split between tasks
+	TaskSize = bBlockLookup ? FMath::Max(1, BlockSize / (2 * NumXCells)) * 2 * NumXCells : BlockSize;
+
+	int NumTasks = FMath::DivideAndRoundUp(NumCells, TaskSize);
+	BlockHashDeltas.Init(0, NumTasks);
+	BlockChanges.Reset();
+	BlockChanges.SetNum(NumTasks);
+
+	TaskFoldedCells.Reset();
+	TaskFoldedCells.SetNum(NumTasks);
+	if (bBlockLookup)
+	{
+		for (int CellID : FoldedCells)
+		{
+			TaskFoldedCells[CellID / TaskSize].Add(CellID);
+		}
+	}
+}
+
+void ULifelikeRule::SetGrid(const FBasicGrid& Grid, BoundGridRuleset Rule, bool bStatesKept)
+{
+	bool bWasLookup = bBlockLookup && NumXCells == Grid.NumXCells && NumZCells == Grid.NumZCells;
+	TArray<int> OldGhosts = MoveTemp(GhostCells);
+
+	NumXCells = Grid.NumXCells;
+	NumZCells = Grid.NumZCells;
+
+	// The table only counts the eight cells around each one, so interior neighborhoods have to be exactly those.
+	// Rows alternate their offsets on hex grids, so a cell of each row parity is checked
+	bBlockLookup = NumXCells >= 4 && NumZCells >= 4 && BaseMembers.Neighborhoods.Num() == NumXCells * NumZCells;
+	for (int z = 1; z <= 2 && bBlockLookup; ++z)
+	{
+		int CellID = z * NumXCells + 1;
+
+		TArray<int> Moore;
+		for (int dz = -1; dz <= 1; ++dz)
+		{
+			for (int dx = -1; dx <= 1; ++dx)
+			{
+				if (dx != 0 || dz != 0)
+				{
+					Moore.Add(CellID + dz * NumXCells + dx);
+				}
+			}
+		}
+
+		TArray<int> Neighborhood = BaseMembers.Neighborhoods[CellID];
+		Neighborhood.Sort();
+		bBlockLookup = Neighborhood == Moore;
+	}
+
+	FBasicGrid EdgeGrid;
+	EdgeGrid.NumXCells = NumXCells;
+	EdgeGrid.NumZCells = NumZCells;
+	EdgeGrid.Shape = Grid.Shape;
+
+	FNeighborhoodMaker Maker(&EdgeGrid);
+	Maker.SetRule(Rule);
+
+	auto IsOnGrid = [this](FIntPoint Coord)
+	{
+		return Coord.X >= 0 && Coord.X < NumXCells && Coord.Y >= 0 && Coord.Y < NumZCells;
+	};
+
+	// Ghosts stand in for every offset that leaves the grid, so a border cell's neighborhood has to be exactly the cells
+	// its eight offsets map to. Edge rules that fold several offsets onto one cell, like the sphere's corners, get merged
+	// neighborhoods instead. Those cells alone are stepped per cell, and the rest of the grid keeps the lookup
+	FoldedCells.Reset();
+	for (int z = 0; z < NumZCells && bBlockLookup; ++z)
+	{
+		bool bBorderRow = z == 0 || z == NumZCells - 1;
+		for (int x = 0; x < NumXCells && bBlockLookup; x += bBorderRow ? 1 : NumXCells - 1)
+		{
+			TArray<int> Mapped;
+			for (int dz = -1; dz <= 1; ++dz)
+			{
+				for (int dx = -1; dx <= 1; ++dx)
+				{
+					FIntPoint Coord(x + dx, z + dz);
+					if ((dx != 0 || dz != 0) && (IsOnGrid(Coord) || (Maker.MapCoord(Coord) && IsOnGrid(Coord))))
+					{
+						Mapped.Add(EdgeGrid.CoordToCellID(Coord));
+					}
+				}
+			}
+
+			TArray<int> Neighborhood = BaseMembers.Neighborhoods[z * NumXCells + x];
+			Mapped.Sort();
+			Neighborhood.Sort();
+			if (Mapped == Neighborhood)
+			{
+				continue;
+			}
+
+			// the neighborhood lists each cell once, however many offsets land on it
+			TArray<int> Merged;
+			for (int CellID : Mapped)
+			{
+				if (Merged.Num() == 0 || Merged.Last() != CellID)
+				{
+					Merged.Add(CellID);
+				}
+			}
+
+			if (Merged == Neighborhood)
+			{
+				FoldedCells.Add(z * NumXCells + x);
+			}
+			else
+			{
+				bBlockLookup = false;
+			}
+		}
+	}
+
+	if (!bBlockLookup)
+	{
+		FoldedCells.Reset();
+	}
+
+	// with the same cells and states, only the ghost ring needs redoing
+	bool bKeepPadding = bStatesKept && bWasLookup && bBlockLookup;
+
+	GhostCells.Reset();
+	GhostSources.Reset();
+	if (!bKeepPadding)
+	{
+		PaddedStates.Reset();
+		PaddedNextStates.Reset();
+	}
+
+	if (bIsotropic && !bBlockLookup)
+	{
+		UE_LOG(LogAutomata, Warning, TEXT("%s: non-totalistic rules need a square grid of at least 4x4 with Moore neighborhoods, and an edge rule that maps each neighbor to a different cell. Only the neighbor counts are used"), *GetName());
+	}
+	else if (bIsotropic && FoldedCells.Num() > 0)
+	{
+		UE_LOG(LogAutomata, Warning, TEXT("%s: the edge rule folds neighbors together on %d border cells. Only their neighbor counts are used"), *GetName(), FoldedCells.Num());
+	}
+
+	if (bBlockLookup)
+	{
+		PaddedStride = NumXCells + 2 + (NumXCells & 1);
+		int PaddedRows = NumZCells + 2 + (NumZCells & 1);
+
+		// Each ghost takes the cell the same edge rule maps its coordinate to.
+		// The padding past the ring only feeds cells that don't exist, and stays dead
+		for (int z = -1; z <= NumZCells; ++z)
+		{
+			for (int x = -1; x <= NumXCells; ++x)
+			{
+				FIntPoint Coord(x, z);
+				if (IsOnGrid(Coord) || !Maker.MapCoord(Coord) || !IsOnGrid(Coord))
+				{
+					continue;
+				}
+
+				GhostCells.Add((z + 1) * PaddedStride + x + 1);
+				GhostSources.Add((Coord.Y + 1) * PaddedStride + Coord.X + 1);
+			}
+		}
+
+		if (!bKeepPadding)
+		{
+			PaddedStates.Init(0, PaddedStride * PaddedRows);
+			PaddedNextStates.Init(0, PaddedStride * PaddedRows);
+			FirstTouchCopy(*Pool, PaddedStates, BlockSize);
+			FirstTouchCopy(*Pool, PaddedNextStates, BlockSize);
+		}
+	}
+
+	SetupTasks();
+
+	if (bKeepPadding)
+	{
+		// ghosts the old edge rule filled may be ones the new rule drops
+		for (int PaddedID : OldGhosts)
+		{
+			PaddedStates[PaddedID] = 0;
+			PaddedNextStates[PaddedID] = 0;
+		}
+		RefreshGhosts();
+	}
+	else
+	{
+		FillPaddedStates();
+	}
+}
+
+void ULifelikeRule::FillPaddedStates()
+{
+	if (!bBlockLookup)
+	{
+		return;
+	}
+
+	ParallelFor(NumZCells, [&](int32 z)
+	{
+		const int* States = &BaseMembers.CurrentStates[z * NumXCells];
+		uint8* Row = &PaddedStates[(z + 1) * PaddedStride + 1];
+		uint8* NextRow = &PaddedNextStates[(z + 1) * PaddedStride + 1];
+
+		for (int x = 0; x < NumXCells; ++x)
+		{
+			Row[x] = NextRow[x] = uint8(States[x]);
+		}
+	});
+
+	RefreshGhosts();
+}
+
+void ULifelikeRule::RefreshGhosts()
+{
+	for (int i = 0; i < GhostCells.Num(); ++i)
+	{
+		PaddedStates[GhostCells[i]] = PaddedStates[GhostSources[i]];
+	}
+}
+
+void ULifelikeRule::MakeBlockTable()
+{
+	// window coordinates of the cells behind each output bit
+	const int CenterColumns[4] = { 1, 2, 1, 2 };
+	const int CenterRows[4] = { 1, 1, 2, 2 };
+
+	BlockTable.SetNumUninitialized(1 << 16);
+	for (int Window = 0; Window < (1 << 16); ++Window)
+	{
+		uint8 Next = 0;
+		for (int Bit = 0; Bit < 4; ++Bit)
+		{
+			// the 3x3 window around this output cell
+			int CellWindow = 0;
+			for (int Row = 0; Row < 3; ++Row)
+			{
+				for (int Column = 0; Column < 3; ++Column)
+				{
+					int Cell = (CenterColumns[Bit] + Column - 1) * 4 + CenterRows[Bit] + Row - 1;
+					CellWindow |= ((Window >> Cell) & 1) << (Row * 3 + Column);
+				}
+			}
+
+			Next |= uint8(Transitions[CellWindow]) << Bit;
+		}
+		BlockTable[Window] = Next;
+	}
+}
+
+void ULifelikeRule::PlaceBuffers()
+{
+	ReclaimSwitchSteps();
+	FirstTouchCopy(*Pool, BaseMembers.CurrentStates, BlockSize);
+	FirstTouchCopy(*Pool, BaseMembers.SwitchStepBuffer, BlockSize);
+	FirstTouchCopy(*Pool, BaseMembers.Neighborhoods, BlockSize);
+	FirstTouchCopy(*Pool, NextStates, BlockSize);
+	FirstTouchCopy(*Pool, PaddedStates, BlockSize);
+	FirstTouchCopy(*Pool, PaddedNextStates, BlockSize);
+}
+
+void ULifelikeRule::PlaceArena(TArrayView<const int> Counts, TArrayView<const int> Cells, int Stride, TArrayView<const bool> ThisStepFlags, TArrayView<const bool> LastStepFlags)
+{
+	int NumCells = ThisStepFlags.Num();
+	int NumCounts = Counts.Num();
+
+	FAutomataArena Placed(	FAutomataArena::SizeFor<bool>(NumCells) * 2 +
+							FAutomataArena::SizeFor<int>(NumCounts) +
+							FAutomataArena::SizeFor<int>(NumCounts * Stride));
+
+	TArrayView<bool> ThisStep = Placed.Allocate<bool>(NumCells);
+	TArrayView<bool> LastStep = Placed.Allocate<bool>(NumCells);
+	TArrayView<int> NewCounts = Placed.Allocate<int>(NumCounts);
+	TArrayView<int> NewCells = Placed.Allocate<int>(NumCounts * Stride);
+
+	Pool->RunOnOwners(FMath::DivideAndRoundUp(NumCells, BlockSize), [&](int32 BlockID)
+	{
+		int Begin = BlockID * BlockSize;
+		int End = FMath::Min(NumCells, Begin + BlockSize);
+
+		FMemory::Memcpy(&ThisStep[Begin], &ThisStepFlags[Begin], End - Begin);
+		FMemory::Memcpy(&LastStep[Begin], &LastStepFlags[Begin], End - Begin);
+
+		if (NumCounts > 0)
+		{
+			FMemory::Memcpy(&NewCounts[Begin], &Counts[Begin], (End - Begin) * sizeof(int));
+			FMemory::Memcpy(NewCells.GetData() + Begin * Stride, Cells.GetData() + Begin * Stride, (End - Begin) * Stride * sizeof(int));
+		}
+	});
+
+	EvalFlaggedThisStep = ThisStep;
+	EvalFlaggedLastStep = LastStep;
+	NeighborsOfCounts = NewCounts;
+	NeighborsOfCells = NewCells;
+	NeighborsOfStride = Stride;
+
+	// the old contents may have been read from it, so it goes only now
+	Arena = MoveTemp(Placed);
+}
+
+bool ULifelikeRule::PatchNeighborsOf(const FNeighborhoodMaker& Maker, int Reach, const TArray<int>& BorderCells)
+{
+	// Only border cells have entries that an edge rule decides, and they only ever land on border cells.
+	// Those entries are dropped, then re-added from the new neighborhoods
+	for (int CellID : BorderCells)
+	{
+		int* List = &NeighborsOfCells[CellID * NeighborsOfStride];
+		int Kept = 0;
+		for (int i = 0; i < NeighborsOfCounts[CellID]; ++i)
+		{
+			if (!Maker.IsBorderCell(List[i], Reach))
+			{
+				List[Kept++] = List[i];
+			}
+		}
+		NeighborsOfCounts[CellID] = Kept;
+	}
+
+	for (int CellID : BorderCells)
+	{
+		for (int Neighbor : BaseMembers.Neighborhoods[CellID])
+		{
+			// entries on interior cells come from in-bounds offsets, which no edge rule changes
+			if (!Maker.IsBorderCell(Neighbor, Reach))
+			{
+				continue;
+			}
+
+			// a neighborhood the edge rule folds can list the same neighbor more than once
+			int* List = &NeighborsOfCells[Neighbor * NeighborsOfStride];
+			if (TArrayView<int>(List, NeighborsOfCounts[Neighbor]).Contains(CellID))
+			{
+				continue;
+			}
+
+			if (NeighborsOfCounts[Neighbor] == NeighborsOfStride)
+			{
+				return false;
+			}
+			List[NeighborsOfCounts[Neighbor]++] = CellID;
+		}
+	}
+	return true;
+}
+
+bool ULifelikeRule::Reconfigure(const FGridChange& Change)
+{
+	// the log's cell IDs are the old grid's
+	CatchUpSwitchSteps();
+
+	FNeighborhoodMaker Maker(Change.Grid);
+
+	if (!Change.ChangesCells())
+	{
+		TArray<int> BorderCells;
+		Maker.RemakeBorderNeighborhoods(BaseMembers.Neighborhoods, Change.RelativeNeighborhood, Change.NewRule, BorderCells);
+
+		// The new edge rule can make the neighborhoods symmetric, or stop them being so. Pairs of interior cells are untouched,
+		// and an interior cell can only list a border cell through an in-bounds offset, which no edge rule changes the reverse of.
+		// So if every pair matched before, only pairs with a border cell in them need checking. Otherwise the whole board is,
+		// as is the whole transpose when it has to be built or dropped
+		bool bWasSymmetric = bSymmetricNeighborhoods;
+		bSymmetricNeighborhoods = bWasSymmetric ?
+			AutomataFuncs::AreNeighborhoodsSymmetric(BaseMembers.Neighborhoods, BorderCells) :
+			AutomataFuncs::AreNeighborhoodsSymmetric(BaseMembers.Neighborhoods);
+
+		TArray<int> Counts;
+		TArray<int> Cells;
+		int Stride = 0;
+		if (bSymmetricNeighborhoods)
+		{
+			if (!bWasSymmetric)
+			{
+				PlaceArena(Counts, Cells, Stride, EvalFlaggedThisStep, EvalFlaggedLastStep);
+			}
+		}
+		else if (bWasSymmetric || !PatchNeighborsOf(Maker, Maker.GetEdgeReach(Change.RelativeNeighborhood), BorderCells))
+		{
+			AutomataFuncs::MakeNeighborsOf(BaseMembers.Neighborhoods, Counts, Cells, Stride);
+			PlaceArena(Counts, Cells, Stride, EvalFlaggedThisStep, EvalFlaggedLastStep);
+		}
+
+		// border cells are the only ones whose neighbors moved
+		SetGrid(*Change.Grid, Change.NewRule, true);
+
+		// The states haven't changed, so the flags from the last step still hold everywhere but the border.
+		// While a cycle replays they're stale, and every cell is evaluated again as below
+		if (!IsSettled())
+		{
+			for (int CellID : BorderCells)
+			{
+				EvalFlaggedLastStep[CellID] = true;
+			}
+			ForgetCycles();
+			return true;
+		}
+	}
+	else
+	{
+		const FBasicGrid& Grid = *Change.Grid;
+
+		TArray<TArray<int>> Neighborhoods;
+		Maker.MakeNeighborhoods(Neighborhoods, Change.RelativeNeighborhood, Change.NewRule);
+
+		// States stay at their coordinates. Without a change in row length, every surviving cell keeps its ID,
+		// so the buffers only grow or shrink at the end
+		int CopiedX = FMath::Min(Change.OldNumXCells, Grid.NumXCells);
+		int CopiedZ = FMath::Min(Change.OldNumZCells, Grid.NumZCells);
+
+		if (Change.OldNumXCells == Grid.NumXCells)
+		{
+			BaseMembers.CurrentStates.SetNumZeroed(Grid.NumCells());
+			BaseMembers.SwitchStepBuffer.SetNum(Grid.NumCells());
+			for (int CellID = CopiedZ * Grid.NumXCells; CellID < Grid.NumCells(); ++CellID)
+			{
+				BaseMembers.SwitchStepBuffer[CellID] = TNumericLimits<int32>::Min();
+			}
+		}
+		else
+		{
+			TArray<int> States;
+			TArray<float> SwitchSteps;
+			States.Init(0, Grid.NumCells());
+			SwitchSteps.Init(TNumericLimits<int32>::Min(), Grid.NumCells());
+
+			for (int z = 0; z < CopiedZ; ++z)
+			{
+				FMemory::Memcpy(&States[z * Grid.NumXCells], &BaseMembers.CurrentStates[z * Change.OldNumXCells], CopiedX * sizeof(int));
+				FMemory::Memcpy(&SwitchSteps[z * Grid.NumXCells], &BaseMembers.SwitchStepBuffer[z * Change.OldNumXCells], CopiedX * sizeof(float));
+			}
+
+			BaseMembers.CurrentStates = MoveTemp(States);
+			BaseMembers.SwitchStepBuffer = MoveTemp(SwitchSteps);
+		}
+
+		BaseMembers.Neighborhoods = MoveTemp(Neighborhoods);
+		PostNeighborhoodSetup();
+
+		SetGrid(*Change.Grid, Change.NewRule);
+	}
+
+	// New cells, or stale flags, so every cell is evaluated on the next step under its new neighborhood
+	NextStates = BaseMembers.CurrentStates;
+	SetAll(EvalFlaggedLastStep, true);
+	SetAll(EvalFlaggedThisStep, false);
+
+	ResetCycleDetection();
+
+	return true;
+}
+
+void ULifelikeRule::InitializeCellStates(float Probability, int32 Seed)
+{
+	CatchUpSwitchSteps();
+
+	TArray<uint64> Words;
+	AutomataRandom::FillBernoulli(uint32(Seed), AutomataRandom::CellStates, Probability, BaseMembers.CurrentStates.Num(), Words);
+	AutomataPacking::UnpackStates(Words.GetData(), BaseMembers.CurrentStates.Num(), 1, BaseMembers.CurrentStates);
+
+	ResetCycleDetection();
+}
+
+void ULifelikeRule::InitializeCellRules(FString BirthString, FString SurviveString)
+{
+	BirthRules = AutomataFuncs::StringToRule(BirthString);
+	SurviveRules = AutomataFuncs::StringToRule(SurviveString);
+
+	TArray<bool> BirthArrangements;
+	TArray<bool> SurviveArrangements;
+	bool bBirthValid = AutomataHensel::ParseRule(BirthString, BirthArrangements);
+	bool bSurviveValid = AutomataHensel::ParseRule(SurviveString, SurviveArrangements);
+	if (!bBirthValid || !bSurviveValid)
+	{
+		UE_LOG(LogAutomata, Warning, TEXT("%s: B%s/S%s has letters its counts don't have, which are ignored"), *GetName(), *BirthString, *SurviveString);
+	}
+
+	bIsotropic = AutomataHensel::IsNonTotalistic(BirthString) || AutomataHensel::IsNonTotalistic(SurviveString);
+
+	// totalistic rules go through the windows too, which then only differ by how many neighbors are set
+	Transitions = AutomataHensel::MakeTransitions(BirthArrangements, SurviveArrangements);
+	MakeBlockTable();
+}
+
+void ULifelikeRule::SetBaseMembers(FBaseAutomataStruct NewBaseMembers)
+{
+	ReclaimSwitchSteps();
+	BaseMembers = MoveTemp(NewBaseMembers);
+	PendingSwitchCells.Reset();
+	PendingSwitchOffsets.Reset();
+	PendingSwitchSteps.Reset();
+	PostNeighborhoodSetup();
+}
+
+void ULifelikeRule::SaveSnapshot(const FString& Path, bool bCompress)
+{
+	// The board has to be captured between steps, so this part stalls the game thread; encoding and writing don't.
+	// States and flags are packed to a bit per cell in parallel while capturing, instead of copied whole,
+	// and the switch steps are handed over rather than copied
+	CatchUpSwitchSteps();
+
+	TSharedRef<FAutomataSnapshot> Snapshot = MakeShared<FAutomataSnapshot>();
+	Snapshot->Kind = ESnapshotKind::Lifelike;
+	Snapshot->NumStates = 2;
+	Snapshot->NextStep = BaseMembers.NextStep;
+	AutomataPacking::PackStates(BaseMembers.CurrentStates, AutomataPacking::BitsForStates(2), Snapshot->PackedStates);
+	Snapshot->SwitchStepBuffer = MoveTemp(BaseMembers.SwitchStepBuffer);
+
+	// flags go stale while a cycle replays, so the restored board re-evaluates everything
+	if (IsSettled())
+	{
+		Snapshot->PackedEvalFlags.Init(~uint64(0), AutomataPacking::NumWords(EvalFlaggedLastStep.Num(), 1));
+	}
+	else
+	{
+		AutomataPacking::PackFlags(EvalFlaggedLastStep, Snapshot->PackedEvalFlags);
+	}
+
+	// the writer and the copy back only read the handed buffer
+	HandedSnapshot = Snapshot;
+	SwitchStepsReturned = Async(EAsyncExecution::ThreadPool, [this, Snapshot]()
+	{
+		BaseMembers.SwitchStepBuffer = Snapshot->SwitchStepBuffer;
+	});
+
+	FAutomataSnapshot::WriteAsync(Snapshot, Path, bCompress);
+}
+
+void ULifelikeRule::ReclaimSwitchSteps()
+{
+	if (SwitchStepsReturned.IsValid())
+	{
+		SwitchStepsReturned.Wait();
+		SwitchStepsReturned.Reset();
+		HandedSnapshot.Reset();
+	}
+}
+
+bool ULifelikeRule::LoadSnapshot(const FString& Path)
+{
+	FAutomataSnapshot Snapshot;
+	if (!Snapshot.ReadFromFile(Path))
+	{
+		return false;
+	}
+
+	if (Snapshot.Kind != ESnapshotKind::Lifelike || Snapshot.CurrentStates.Num() != BaseMembers.Neighborhoods.Num() || Snapshot.EvalFlags.Num() != EvalFlaggedLastStep.Num())
+	{
+		UE_LOG(LogAutomata, Error, TEXT("Snapshot %s does not match this grid"), *Path);
+		return false;
+	}
+
+	ReclaimSwitchSteps();
+	BaseMembers.NextStep = Snapshot.NextStep;
+	BaseMembers.CurrentStates = MoveTemp(Snapshot.CurrentStates);
+	BaseMembers.SwitchStepBuffer = MoveTemp(Snapshot.SwitchStepBuffer);
+	PendingSwitchCells.Reset();
+	PendingSwitchOffsets.Reset();
+	PendingSwitchSteps.Reset();
+	FMemory::Memcpy(EvalFlaggedLastStep.GetData(), Snapshot.EvalFlags.GetData(), EvalFlaggedLastStep.Num());
+
+	NextStates = BaseMembers.CurrentStates;
+	SetAll(EvalFlaggedThisStep, false);
+
+	ResetCycleDetection();
+
+	return true;
+}
+
+bool ULifelikeRule::LoadPattern(const FString& Path, const FBasicGrid& Grid, FIntPoint Offset)
+{
+	CatchUpSwitchSteps();
+
+	BaseMembers.CurrentStates.Init(0, BaseMembers.Neighborhoods.Num());
+	if (!AutomataPatterns::LoadPattern(Path, Grid, Offset, BaseMembers.CurrentStates))
+	{
+		return false;
+	}
+
+	// patterns are two-state, anything else is treated as alive
+	for (int& State : BaseMembers.CurrentStates)
+	{
+		State = State != 0;
+	}
+
+	NextStates = BaseMembers.CurrentStates;
+	SetAll(EvalFlaggedLastStep, true);
+	SetAll(EvalFlaggedThisStep, false);
+
+	ResetCycleDetection();
+
+	return true;
+}
+
+void ULifelikeRule::CommitCell(int CellID, int State, int32 TaskID, uint64& HashDelta)
+{
+	if (EvalFlaggedLastStep[CellID])
+	{
+		// cleared as it's read, so the array comes out of the step ready to collect the step after next
+		EvalFlaggedLastStep[CellID] = false;
+
+		NextStates[CellID] = State;
+
+		if (PostStateChange(CellID))
+		{
+			HashDelta ^= CellHashKey(CellID);
+			BlockChanges[TaskID].Add(CellID);
+		}
+	}
+}
+
+void ULifelikeRule::EvaluateCell(int CellID, int32 TaskID, uint64& HashDelta)
+{
+	if (EvalFlaggedLastStep[CellID])
+	{
+		int AliveNeighbors = GetCellAliveNeighbors(CellID);
+
+		CommitCell(	CellID,
+					BaseMembers.CurrentStates[CellID] ? int(SurviveRules[AliveNeighbors]) : int(BirthRules[AliveNeighbors]),
+					TaskID,
+					HashDelta);
+	}
+}
+
+void ULifelikeRule::ApplyCellBlock(int32 TaskID)
+{
+	int NumCells = BaseMembers.Neighborhoods.Num();
+
+	// each task hashes its own changes, so cells never contend over the state hash
+	uint64 HashDelta = 0;
+
+	int End = FMath::Min(NumCells, (TaskID + 1) * TaskSize);
+	for (int CellID = TaskID * TaskSize; CellID < End; ++CellID)
+	{
+		EvaluateCell(CellID, TaskID, HashDelta);
+	}
+
+	BlockHashDeltas[TaskID] = HashDelta;
+}
+
+void ULifelikeRule::ApplyLookupBlock(int32 TaskID)
+{
+	uint64 HashDelta = 0;
+
+	int PairsPerTask = TaskSize / (2 * NumXCells);
+	int EndPair = FMath::Min(FMath::DivideAndRoundUp(NumZCells, 2), (TaskID + 1) * PairsPerTask);
+
+	// Folded cells count each merged neighbor once, where the table would count it per offset, so they go first.
+	// Committing clears their flags, which leaves them be in the table pass
+	for (int CellID : TaskFoldedCells[TaskID])
+	{
+		if (EvalFlaggedLastStep[CellID])
+		{
+			int AliveNeighbors = GetCellAliveNeighbors(CellID);
+			int State = BaseMembers.CurrentStates[CellID] ? int(SurviveRules[AliveNeighbors]) : int(BirthRules[AliveNeighbors]);
+
+			PaddedNextStates[(CellID / NumXCells + 1) * PaddedStride + CellID % NumXCells + 1] = uint8(State);
+			CommitCell(CellID, State, TaskID, HashDelta);
+		}
+	}
+
+	// the table has every cell's result, but only flagged ones can have changed
+	auto Commit = [&](int CellID, int PaddedID, int State)
+	{
+		if (EvalFlaggedLastStep[CellID])
+		{
+			PaddedNextStates[PaddedID] = uint8(State);
+			CommitCell(CellID, State, TaskID, HashDelta);
+		}
+	};
+
+	for (int Pair = TaskID * PairsPerTask; Pair < EndPair; ++Pair)
+	{
+		int z = Pair * 2;
+		int Row = z * NumXCells;
+		int PaddedRow = (z + 1) * PaddedStride + 1;
+
+		// an odd last row pairs with padding
+		bool bLowerRow = z + 1 < NumZCells;
+
+		// padded column x of the window, grid rows z-1 to z+2 packed into a nibble
+		const uint8* Above = &PaddedStates[z * PaddedStride];
+		int Stride = PaddedStride;
+		auto Column = [Above, Stride](int x)
+		{
+			return uint32(Above[x] | Above[x + Stride] << 1 | Above[x + 2 * Stride] << 2 | Above[x + 3 * Stride] << 3);
+		};
+
+		// the window slides two columns per block, so each column is packed once
+		uint32 Window = Column(0) | Column(1) << 4;
+		for (int x = 0; x < NumXCells; x += 2)
+		{
+			Window |= Column(x + 2) << 8 | Column(x + 3) << 12;
+
+			int CellID = Row + x;
+			int Below = CellID + NumXCells;
+
+			// an odd last column pairs with padding too
+			bool bRightColumn = x + 1 < NumXCells;
+
+			bool bFlagged = EvalFlaggedLastStep[CellID] ||
+							(bRightColumn && EvalFlaggedLastStep[CellID + 1]) ||
+							(bLowerRow && EvalFlaggedLastStep[Below]) ||
+							(bLowerRow && bRightColumn && EvalFlaggedLastStep[Below + 1]);
+
+			if (bFlagged)
+			{
+				uint8 Next = BlockTable[Window];
+				int PaddedID = PaddedRow + x;
+
+				Commit(CellID, PaddedID, Next & 1);
+				if (bRightColumn)
+				{
+					Commit(CellID + 1, PaddedID + 1, (Next >> 1) & 1);
+				}
+				if (bLowerRow)
+				{
+					Commit(Below, PaddedID + PaddedStride, (Next >> 2) & 1);
+				}
+				if (bLowerRow && bRightColumn)
+				{
+					Commit(Below + 1, PaddedID + PaddedStride + 1, (Next >> 3) & 1);
+				}
+			}
+
+			Window >>= 8;
+		}
+	}
+
+	BlockHashDeltas[TaskID] = HashDelta;
+}
+
+bool ULifelikeRule::PostStateChange(int CellID)
+{
+	if (NextStates[CellID] != BaseMembers.CurrentStates[CellID])
+	{
+		EvalFlaggedThisStep[CellID] = true;
+		if (bSymmetricNeighborhoods)
+		{
+			for (int Neighbor : BaseMembers.Neighborhoods[CellID])
+			{
+				EvalFlaggedThisStep[Neighbor] = true;
+			}
+		}
+		else
+		{
+			const int* Influenced = &NeighborsOfCells[CellID * NeighborsOfStride];
+			for (int i = 0; i < NeighborsOfCounts[CellID]; ++i)
+			{
+				EvalFlaggedThisStep[Influenced[i]] = true;
+			}
+		}
+		return true;
+	}
+	return false;
+}
+
+void ULifelikeRule::TimestepPropertyShift()
+{
+	++BaseMembers.NextStep;
+
+	// Only flagged cells are written to NextStates, but an unflagged cell didn't change on the previous step,
+	// so the value it was left with two steps ago is still its current one. The buffers can swap roles outright
+	Swap(BaseMembers.CurrentStates, NextStates);
+	Swap(EvalFlaggedLastStep, EvalFlaggedThisStep);
+
+	// the padded states follow the same way, and only their ghosts need catching up
+	Swap(PaddedStates, PaddedNextStates);
+	RefreshGhosts();
+}
+
+int ULifelikeRule::GetCellAliveNeighbors(int CellID) const
+{
+	//Query the cell's neighborhood to sum its alive neighbors
+	int AliveNeighbors = 0;
+
+	for (int Neighbor : BaseMembers.Neighborhoods[CellID])
+	{
+		AliveNeighbors += BaseMembers.CurrentStates[Neighbor];
+	}
+	return AliveNeighbors;
+}
+
+void ULifelikeRule::BeginDestroy()
+{
+	Super::BeginDestroy();
+
+	// finishes any step in flight before the buffers it writes go away
+	Pool.Reset();
+	ReclaimSwitchSteps();
+}
+
+void ULifelikeRule::SetWorkerThreads(int NumThreads, bool bPinThreads, bool bPlaceBuffers)
+{
+	// a pool of just the caller runs every placement task on it
+	if (!bPlaceBuffers)
+	{
+		Pool = MakeUnique<FAutomataWorkerPool>(1);
+		PlaceBuffers();
+		PlaceArena(NeighborsOfCounts, NeighborsOfCells, NeighborsOfStride, EvalFlaggedThisStep, EvalFlaggedLastStep);
+	}
+
+	Pool = MakeUnique<FAutomataWorkerPool>(NumThreads, bPinThreads);
+
+	// the new workers may sit on other nodes than the ones that placed the buffers
+	if (bPlaceBuffers)
+	{
+		PlaceBuffers();
+		PlaceArena(NeighborsOfCounts, NeighborsOfCells, NeighborsOfStride, EvalFlaggedThisStep, EvalFlaggedLastStep);
+	}
+}
+
+void ULifelikeRule::SetCycleResponse(ECycleResponse Response)
+{
+	CycleResponse = Response;
+
+	// resuming rule evaluation from a settled board
+	if (IsSettled() && Response == ECycleResponse::Continue)
+	{
+		NextStates = BaseMembers.CurrentStates;
+		SetAll(EvalFlaggedLastStep, true);
+		SetAll(EvalFlaggedThisStep, false);
+		ResetCycleDetection();
+	}
+}
+
+void ULifelikeRule::ResetCycleDetection()
+{
+	int NumCells = BaseMembers.CurrentStates.Num();
+
+	ParallelFor(BlockHashDeltas.Num(), [&](int32 TaskID)
+	{
+		uint64 Hash = 0;
+		int End = FMath::Min(NumCells, (TaskID + 1) * TaskSize);
+		for (int CellID = TaskID * TaskSize; CellID < End; ++CellID)
+		{
+			if (BaseMembers.CurrentStates[CellID])
+			{
+				Hash ^= CellHashKey(CellID);
+			}
+		}
+		BlockHashDeltas[TaskID] = Hash;
+	});
+
+	StateHash = 0;
+	for (uint64& Hash : BlockHashDeltas)
+	{
+		StateHash ^= Hash;
+		Hash = 0;
+	}
+
+	// whatever replaced the states didn't report which cells it touched
+	bChangesKnown = false;
+	FillPaddedStates();
+
+	ForgetCycles();
+}
+
+void ULifelikeRule::ForgetCycles()
+{
+	CycleState = ECycleState::Searching;
+	CyclePeriod = 0;
+	CyclePhase = 0;
+	RecentHashes.Reset();
+	HashSteps.Reset();
+	OldestHash = 0;
+
+	RecentHashes.Add(StateHash);
+	HashSteps.Add(StateHash, int(BaseMembers.NextStep));
+
+	CycleChanges.Reset();
+	for (TArray<int>& Changes : BlockChanges)
+	{
+		Changes.Reset();
+	}
+}
+
+void ULifelikeRule::UpdateCycleDetection()
+{
+	for (uint64 HashDelta : BlockHashDeltas)
+	{
+		StateHash ^= HashDelta;
+	}
+
+	ChangedCells.Reset();
+	for (TArray<int>& Block : BlockChanges)
+	{
+		ChangedCells.Append(Block);
+		Block.Reset();
+	}
+	bChangesKnown = true;
+
+	// the step's changes were made before TimestepPropertyShift moved NextStep on
+	QueueSwitchSteps(BaseMembers.NextStep - 1);
+
+	if (CycleResponse == ECycleResponse::Continue)
+	{
+		return;
+	}
+
+	if (CycleState == ECycleState::Capturing)
+	{
+		CycleChanges.Add(ChangedCells);
+
+		if (CycleChanges.Num() == CyclePeriod)
+		{
+			SettleCycle();
+		}
+		return;
+	}
+
+	int Step = int(BaseMembers.NextStep);
+
+	if (const int* SeenStep = HashSteps.Find(StateHash))
+	{
+		CyclePeriod = Step - *SeenStep;
+		UE_LOG(LogAutomata, Log, TEXT("Board repeats the state of step %d, with period %d"), *SeenStep, CyclePeriod);
+
+		if (CycleResponse == ECycleResponse::Pause)
+		{
+			CycleState = ECycleState::Settled;
+		}
+		else
+		{
+			// one more pass through the cycle records which cells change on each of its steps
+			CycleState = ECycleState::Capturing;
+			CycleChanges.Reset();
+		}
+		return;
+	}
+
+	// only the last MaxCyclePeriod hashes are kept, so the table stays a fixed size
+	if (RecentHashes.Num() == MaxCyclePeriod)
+	{
+		HashSteps.Remove(RecentHashes[OldestHash]);
+		RecentHashes[OldestHash] = StateHash;
+		OldestHash = (OldestHash + 1) % MaxCyclePeriod;
+	}
+	else
+	{
+		RecentHashes.Add(StateHash);
+	}
+	HashSteps.Add(StateHash, Step);
+}
+
+void ULifelikeRule::QueueSwitchSteps(float Step)
+{
+	// a still board changes nothing, and its steps would otherwise pile up in the log
+	if (ChangedCells.Num() == 0)
+	{
+		return;
+	}
+
+	PendingSwitchOffsets.Add(PendingSwitchCells.Num());
+	PendingSwitchSteps.Add(Step);
+	PendingSwitchCells.Append(ChangedCells);
+
+	// Nothing may read the switch steps for a long while, so the log never outgrows the buffer it stands in for,
+	// nor holds so many small steps that catching up is mostly per-step overhead
+	if (PendingSwitchCells.Num() >= BaseMembers.CurrentStates.Num() || PendingSwitchSteps.Num() >= MaxPendingSwitchSteps)
+	{
+		CatchUpSwitchSteps();
+	}
+}
+
+void ULifelikeRule::CatchUpSwitchSteps()
+{
+	static constexpr int CellsPerTask = 16384;
+
+	ReclaimSwitchSteps();
+
+	// Steps go oldest first, so each cell ends on the step it last changed. Only the newest write survives,
+	// and a cell that last changed to dead did so on that step. A step never lists a cell twice, so its cells split freely
+	for (int Step = 0; Step < PendingSwitchSteps.Num(); ++Step)
+	{
+		int Start = PendingSwitchOffsets[Step];
+		int End = Step + 1 < PendingSwitchOffsets.Num() ? PendingSwitchOffsets[Step + 1] : PendingSwitchCells.Num();
+		float SwitchStep = PendingSwitchSteps[Step];
+
+		int NumTasks = FMath::DivideAndRoundUp(End - Start, CellsPerTask);
+		ParallelFor(NumTasks, [&](int32 TaskID)
+		{
+			int TaskEnd = FMath::Min(End, Start + (TaskID + 1) * CellsPerTask);
+			for (int i = Start + TaskID * CellsPerTask; i < TaskEnd; ++i)
+			{
+				int CellID = PendingSwitchCells[i];
+				BaseMembers.SwitchStepBuffer[CellID] =	BaseMembers.CurrentStates[CellID] ?
+														TNumericLimits<float>::Max() :
+														SwitchStep;
+			}
+		}, NumTasks == 1);
+	}
+
+	PendingSwitchCells.Reset();
+	PendingSwitchOffsets.Reset();
+	PendingSwitchSteps.Reset();
+}
+
+void ULifelikeRule::SettleCycle()
+{
+	CycleState = ECycleState::Settled;
+	CyclePhase = 0;
+
+	// gather, for every cell that changes at all, the phases it changes on
+	TMap<int, TArray<int>> PhasesOfCell;
+	for (int Phase = 0; Phase < CyclePeriod; ++Phase)
+	{
+		for (int CellID : CycleChanges[Phase])
+		{
+			PhasesOfCell.FindOrAdd(CellID).Add(Phase);
+		}
+	}
+
+	CycleCells.Reset(PhasesOfCell.Num());
+	CyclePhaseOffsets.Reset(PhasesOfCell.Num() + 1);
+	CyclePhases.Reset();
+
+	CyclePhaseOffsets.Add(0);
+	for (const TPair<int, TArray<int>>& Cell : PhasesOfCell)
+	{
+		CycleCells.Add(Cell.Key);
+		CyclePhases.Append(Cell.Value);
+		CyclePhaseOffsets.Add(CyclePhases.Num());
+	}
+}
+
+void ULifelikeRule::ReplayCycleStep()
+{
+	ChangedCells = CycleChanges[CyclePhase];
+	bChangesKnown = true;
+
+	for (int CellID : ChangedCells)
+	{
+		int& State = BaseMembers.CurrentStates[CellID];
+		State = 1 - State;
+	}
+	QueueSwitchSteps(BaseMembers.NextStep);
+
+	CyclePhase = (CyclePhase + 1) % CyclePeriod;
+	++BaseMembers.NextStep;
+}
+
+void ULifelikeRule::AdvanceCycle(int Steps)
+{
+	if (CycleState != ECycleState::Settled || CycleResponse != ECycleResponse::Replay || Steps <= 0)
+	{
+		return;
+	}
+
+	// the jump writes switch steps directly, over whatever the log would have
+	CatchUpSwitchSteps();
+
+	ParallelFor(CycleCells.Num(), [&](int32 Index)
+	{
+		int CellID = CycleCells[Index];
+
+		int Toggles = 0;
+		int LastToggle = -1;
+
+		for (int i = CyclePhaseOffsets[Index]; i < CyclePhaseOffsets[Index + 1]; ++i)
+		{
+			// steps from now until this phase first comes round
+			int First = (CyclePhases[i] - CyclePhase + CyclePeriod) % CyclePeriod;
+			if (First < Steps)
+			{
+				int Count = (Steps - 1 - First) / CyclePeriod + 1;
+				Toggles += Count;
+				LastToggle = FMath::Max(LastToggle, First + (Count - 1) * CyclePeriod);
+			}
+		}
+
+		if (Toggles % 2)
+		{
+			int& State = BaseMembers.CurrentStates[CellID];
+			State = 1 - State;
+		}
+
+		if (LastToggle >= 0)
+		{
+			BaseMembers.SwitchStepBuffer[CellID] =	BaseMembers.CurrentStates[CellID] ?
+													TNumericLimits<float>::Max() :
+													BaseMembers.NextStep + LastToggle;
+		}
+	});
+
+	// Any cell of the cycle may have changed. The last step's changes were one of its phases, so the cycle's cells
+	// cover them too, and listing only those keeps every cell once for the switch step log
+	ChangedCells = CycleCells;
+
+	CyclePhase = (CyclePhase + Steps) % CyclePeriod;
+	BaseMembers.NextStep += Steps;
+}
+
+void ULifelikeRule::StepComplete()
+{
+	if (CycleState == ECycleState::Settled)
+	{
+		if (CycleResponse == ECycleResponse::Replay)
+		{
+			ReplayCycleStep();
+		}
+		else
+		{
+			ChangedCells.Reset();
+		}
+		return;
+	}
 
-	int NumCells = BaseMembers.Neighborhoods.Num();
+	Pool->Wait();
 
-	NextStates.Init(false, NumCells);
+	TimestepPropertyShift();
 
-	EvalFlaggedThisStep.Init(true, NumCells);
-	EvalFlaggedLastStep.Init(true, NumCells);
+	UpdateCycleDetection();
 }
 
-void ULifelikeRule::InitializeCellStates(float Probability)
+void ULifelikeRule::BroadcastData()
 {
-	for (int& State : BaseMembers.CurrentStates)
+	if (HandedSnapshot.IsValid() && PendingSwitchSteps.Num() == 0)
+	{
+		BaseMembers.Display->UpdateSwitchTimes(HandedSnapshot->SwitchStepBuffer);
+		return;
+	}
+
+	CatchUpSwitchSteps();
+	BaseMembers.Display->UpdateSwitchTimes(BaseMembers.SwitchStepBuffer);
+}
+
+void ULifelikeRule::StartNewStep()
+{
+	if (CycleState == ECycleState::Settled)
+	{
+		return;
+	}
+
+	// kick off calculation of next stage
+	// kicks off the blocks on the pool's threads without blocking, StepComplete waits for them
+	if (bBlockLookup)
+	{
+		Pool->Launch(BlockHashDeltas.Num(), [this](int32 TaskID) { ApplyLookupBlock(TaskID); });
+	}
+	else
 	{
-		State = FMath::FRandRange(0, TNumericLimits<int32>::Max() - 1) < Probability* TNumericLimits<int32>::Max();
+		Pool->Launch(BlockHashDeltas.Num(), [this](int32 TaskID) { ApplyCellBlock(TaskID); });
 	}
+
 }
 
-void ULifelikeRule::InitializeCellRules(FString BirthString, FString SurviveString)
+namespace
 {
-	BirthRules = AutomataFuncs::StringToRule(BirthString);
-	SurviveRules = AutomataFuncs::StringToRule(SurviveString);
+	// cell ID offsets of the cardinal neighborhood, in the order FNeighborhoodMaker lays it out
+	const int32 CardinalX[4] = { 0, 1, 0, -1 };
+	const int32 CardinalZ[4] = { 1, 0, -1, 0 };
+
+	// Ants are this many ahead of the one being moved when their cells are prefetched.
+	// Far enough to cover a miss, and near enough that the line is still cached when the ant gets there
+	constexpr int AntPrefetchDistance = 8;
 }
 
-void ULifelikeRule::SetBaseMembers(FBaseAutomataStruct NewBaseMembers)
+void UAntRule::MoveAnts()
 {
-	BaseMembers = NewBaseMembers;
-	PostNeighborhoodSetup();
+	if (bInlineNeighbors)
+	{
+		MoveAntsInline();
+	}
+	else
+	{
+		MoveAntsTable();
+	}
 }
 
-void ULifelikeRule::ApplyCellRules()
+void UAntRule::MoveAntsInline()
 {
-	ParallelFor(BaseMembers.Neighborhoods.Num(), [&](int32 CellID)
+	const FPackedTransition* Table = Transitions.GetData();
+	uint8* Plane = CellPlane.GetData();
+	int* Changed = ChangedCells.GetData();
+
+	for (int AntID = 0; AntID < Ants.Num(); ++AntID)
 	{
-		if (EvalFlaggedLastStep[CellID])
+		if (AntID + AntPrefetchDistance < Ants.Num())
 		{
-			int AliveNeighbors = GetCellAliveNeighbors(CellID);
+			FPlatformMisc::Prefetch(Plane + Ants[AntID + AntPrefetchDistance].Cell);
+		}
 
-			NextStates[CellID] =	BaseMembers.CurrentStates[CellID] ? 
-									int(SurviveRules[AliveNeighbors]) : 
-									int(BirthRules[AliveNeighbors]);
+		FAnt& Ant = Ants[AntID];
+		*Changed++ = Ant.Cell;
 
-			PostStateChange(CellID);	
-		}
-	} /*,EParallelForFlags::ForceSingleThread*/);
+		uint8& Color = Plane[Ant.Cell];
+		FPackedTransition Rule = Table[Ant.State * NumColors + Color];
+		Ant.Orientation = (Ant.Orientation + Rule.QuarterTurn) & 3;
+		Ant.State = Rule.NextState;
+		Color = Rule.WriteColor;
+
+		// torus wrap as selects rather than a modulo
+		int32 X = Ant.X + CardinalX[Ant.Orientation];
+		int32 Z = Ant.Z + CardinalZ[Ant.Orientation];
+		X = X < 0 ? NumXCells - 1 : (X == NumXCells ? 0 : X);
+		Z = Z < 0 ? NumZCells - 1 : (Z == NumZCells ? 0 : Z);
+
+		Ant.X = X;
+		Ant.Z = Z;
+		Ant.Cell = Z * NumXCells + X;
+	}
 }
 
-void ULifelikeRule::PostStateChange(int CellID)
+void UAntRule::MoveAntsTable()
 {
-	if (NextStates[CellID] != BaseMembers.CurrentStates[CellID])
+	const FPackedTransition* Table = Transitions.GetData();
+	uint8* Plane = CellPlane.GetData();
+	int* Changed = ChangedCells.GetData();
+
+	for (int AntID = 0; AntID < Ants.Num(); ++AntID)
 	{
-		EvalFlaggedThisStep[CellID] = true;
-		for (int InfluencedCellID : NeighborsOf[CellID])
+		if (AntID + AntPrefetchDistance < Ants.Num())
 		{
-			EvalFlaggedThisStep[InfluencedCellID] = true;
+			int AheadCell = Ants[AntID + AntPrefetchDistance].Cell;
+			FPlatformMisc::Prefetch(Plane + AheadCell);
+			FPlatformMisc::Prefetch(NeighborTable.GetData() + AheadCell * NeighborStride);
 		}
 
-		BaseMembers.SwitchStepBuffer[CellID] =	NextStates[CellID] ? 
-												TNumericLimits<float>::Max() : 
-												BaseMembers.NextStep;
+		FAnt& Ant = Ants[AntID];
+		*Changed++ = Ant.Cell;
+
+		uint8& Color = Plane[Ant.Cell];
+		FPackedTransition Rule = Table[Ant.State * NumColors + Color];
+		int NumNeighbs = NeighborCounts[Ant.Cell];
+		Ant.Orientation = (Ant.Orientation + Rule.Turn % NumNeighbs + NumNeighbs) % NumNeighbs;
+		Ant.State = Rule.NextState;
+		Color = Rule.WriteColor;
+
+		Ant.Cell = NeighborTable[Ant.Cell * NeighborStride + Ant.Orientation];
 	}
 }
 
-void ULifelikeRule::TimestepPropertyShift()
+void UAntRule::PlaceAnt(FAnt& Ant, int Cell) const
 {
-	++BaseMembers.NextStep;
+	Ant.Cell = Cell;
+	Ant.X = NumXCells > 0 ? Cell % NumXCells : 0;
+	Ant.Z = NumXCells > 0 ? Cell / NumXCells : 0;
+}
 
-	ParallelFor(BaseMembers.Neighborhoods.Num(), [&](int32 CellID)
+void UAntRule::SyncCellPlane()
+{
+	CellPlane.SetNumUninitialized(BaseMembers.CurrentStates.Num());
+	ParallelFor(CellPlane.Num(), [&](int32 CellID)
 	{
-		BaseMembers.CurrentStates[CellID] = NextStates[CellID];
-		EvalFlaggedLastStep[CellID] = EvalFlaggedThisStep[CellID];
-		EvalFlaggedThisStep[CellID] = false;
-
+		CellPlane[CellID] = uint8(BaseMembers.CurrentStates[CellID]);
 	});
 }
 
-int ULifelikeRule::GetCellAliveNeighbors(int CellID) const
+void UAntRule::SetBaseMembers(FBaseAutomataStruct NewBaseMembers)
 {
-	//Query the cell's neighborhood to sum its alive neighbors
-	int AliveNeighbors = 0;
+	BaseMembers = MoveTemp(NewBaseMembers);
 
-	for (int Neighbor : BaseMembers.Neighborhoods[CellID])
+	// flatten the neighborhoods into one fixed-stride table, so a move doesn't chase a heap pointer per cell
+	int NumCells = BaseMembers.Neighborhoods.Num();
+
+	NeighborStride = 1;
+	for (const TArray<int>& Neighborhood : BaseMembers.Neighborhoods)
 	{
-		AliveNeighbors += BaseMembers.CurrentStates[Neighbor];
+		NeighborStride = FMath::Max(NeighborStride, Neighborhood.Num());
 	}
-	return AliveNeighbors;
-}
 
-void ULifelikeRule::StepComplete()
-{
-	AsyncState.Wait();
+	NeighborTable.Init(0, NumCells * NeighborStride);
+	NeighborCounts.SetNumUninitialized(NumCells);
+	ParallelFor(NumCells, [&](int32 CellID)
+	{
+		const TArray<int>& Neighborhood = BaseMembers.Neighborhoods[CellID];
+		NeighborCounts[CellID] = uint8(Neighborhood.Num());
+		FMemory::Memcpy(&NeighborTable[CellID * NeighborStride], Neighborhood.GetData(), Neighborhood.Num() * sizeof(int));
+	});
 
-	TimestepPropertyShift();
+	SyncCellPlane();
 }
 
-void ULifelikeRule::BroadcastData()
+void UAntRule::SetGrid(const FBasicGrid& Grid, BoundGridRuleset GridRule)
 {
-	BaseMembers.Display->UpdateSwitchTimes(BaseMembers.SwitchStepBuffer);
+	NumXCells = Grid.NumXCells;
+	NumZCells = Grid.NumZCells;
+
+	// below 3 cells an axis wraps onto itself, and FNeighborhoodMaker merges the duplicate neighbors
+	bInlineNeighbors =	Grid.Shape == CellShape::Square && GridRule == BoundGridRuleset::Torus &&
+						NumXCells >= 3 && NumZCells >= 3 && NeighborStride == 4;
+
+	for (FAnt& Ant : Ants)
+	{
+		PlaceAnt(Ant, Ant.Cell);
+	}
 }
 
-void ULifelikeRule::StartNewStep()
+void UAntRule::InitializeAnts(int NumAnts, int32 Seed)
 {
-	// kick off calculation of next stage
-	AsyncState = Async(EAsyncExecution::TaskGraph, [&]() {ApplyCellRules(); });
+	int NumCells = BaseMembers.Neighborhoods.Num();
+	int NumNeighbs = BaseMembers.Neighborhoods[0].Num();
+
+	Ants.SetNumUninitialized(NumAnts);
+	ChangedCells.SetNumUninitialized(NumAnts);
 
+	ParallelFor(NumAnts, [&](int32 AntID)
+	{
+		PlaceAnt(Ants[AntID], AutomataRandom::Range(AutomataRandom::Hash(uint32(Seed), AutomataRandom::AntPositions, AntID), NumCells));
+		Ants[AntID].Orientation = AutomataRandom::Range(AutomataRandom::Hash(uint32(Seed), AutomataRandom::AntOrientations, AntID), NumNeighbs);
+		Ants[AntID].State = 0;
+	});
 }
 
-void UAntRule::MoveAnts()
+void UAntRule::InitializeSequence(TArray<int> Seq)
 {
-	int NumAnts = AntPositions.Num();
-	int NumStates = CellSequence.Num();
-
-	for (int Ant = 0; Ant < NumAnts; ++Ant)
+	// a single-state turmite that advances every cell it leaves to the next color
+	TArray<FTurmiteTransition> Table;
+	for (int Color = 0; Color < Seq.Num(); ++Color)
 	{
+		FTurmiteTransition& Transition = Table.AddDefaulted_GetRef();
+		Transition.Color = Color;
+		Transition.WriteColor = (Color + 1) % Seq.Num();
+		Transition.Turn = Seq[Color];
+	}
 
-		int& AntCell = AntPositions[Ant];
-		int& AntOrientation = AntOrientations[Ant];
-		
-		int& HostState = BaseMembers.CurrentStates[AntCell];
+	InitializeTurmite(Table);
+}
 
-		// change ant orientation
-		const TArray<int>& AntNeighborhood = BaseMembers.Neighborhoods[AntCell];
-		int NumNeighbs = AntNeighborhood.Num();
-		AntOrientation += CellSequence[HostState] + NumNeighbs;
-		AntOrientation %= NumNeighbs;
+void UAntRule::InitializeTurmite(const TArray<FTurmiteTransition>& Table)
+{
+	int NumAntStates = 1;
+	NumColors = 2;
+	for (const FTurmiteTransition& Transition : Table)
+	{
+		NumAntStates = FMath::Max3(NumAntStates, Transition.AntState + 1, Transition.NextState + 1);
+		NumColors = FMath::Max3(NumColors, Transition.Color + 1, Transition.WriteColor + 1);
+	}
 
-		// change host cell state
-		int OldHostState = HostState;
-		HostState += 1;
-		HostState %= NumStates;
+	// colors live in a byte plane, ant states in 16 bits
+	if (NumColors > 256 || NumAntStates > 256)
+	{
+		UE_LOG(LogAutomata, Error, TEXT("Turmite needs %d colors and %d states, at most 256 of each are supported"), NumColors, NumAntStates);
+		NumColors = FMath::Min(NumColors, 256);
+		NumAntStates = FMath::Min(NumAntStates, 256);
+	}
 
+	Transitions.SetNumUninitialized(NumAntStates * NumColors);
+	for (int AntState = 0; AntState < NumAntStates; ++AntState)
+	{
+		for (int Color = 0; Color < NumColors; ++Color)
+		{
+			Transitions[AntState * NumColors + Color] = { uint8(Color), uint8(AntState), 0, 0 };
+		}
+	}
 
-		BaseMembers.SwitchStepBuffer[AntCell] = BaseMembers.NextStep;
+	for (const FTurmiteTransition& Transition : Table)
+	{
+		if (Transition.AntState < 0 || Transition.AntState >= NumAntStates || Transition.Color < 0 || Transition.Color >= NumColors ||
+			Transition.WriteColor < 0 || Transition.WriteColor >= NumColors || Transition.NextState < 0 || Transition.NextState >= NumAntStates)
+		{
+			UE_LOG(LogAutomata, Warning, TEXT("Skipping out of range turmite transition for state %d, color %d"), Transition.AntState, Transition.Color);
+			continue;
+		}
 
-		// move ant along
-		AntCell = AntNeighborhood[AntOrientation];
+		FPackedTransition& Packed = Transitions[Transition.AntState * NumColors + Transition.Color];
+		Packed.WriteColor = uint8(Transition.WriteColor);
+		Packed.NextState = uint8(Transition.NextState);
+		Packed.QuarterTurn = uint8(((Transition.Turn % 4) + 4) % 4);
+		Packed.Turn = int8(FMath::Clamp(Transition.Turn, -128, 127));
 	}
 }
 
-void UAntRule::SetBaseMembers(FBaseAutomataStruct NewBaseMembers)
+void UAntRule::SaveSnapshot(const FString& Path, bool bCompress)
 {
-	BaseMembers = NewBaseMembers;
+	TSharedRef<FAutomataSnapshot> Snapshot = MakeShared<FAutomataSnapshot>();
+	Snapshot->Kind = ESnapshotKind::Ant;
+	Snapshot->NumStates = NumColors;
+	Snapshot->NumAntStates = Transitions.Num() / NumColors;
+	Snapshot->NextStep = BaseMembers.NextStep;
+	Snapshot->CurrentStates = BaseMembers.CurrentStates;
+	Snapshot->SwitchStepBuffer = BaseMembers.SwitchStepBuffer;
+	for (const FAnt& Ant : Ants)
+	{
+		Snapshot->AntPositions.Add(Ant.Cell);
+		Snapshot->AntOrientations.Add(Ant.Orientation);
+		Snapshot->AntStates.Add(Ant.State);
+	}
+
+	FAutomataSnapshot::WriteAsync(Snapshot, Path, bCompress);
 }
 
-void UAntRule::InitializeAnts(int NumAnts)
+bool UAntRule::LoadSnapshot(const FString& Path)
 {
-	AntPositions.Init(0, NumAnts);
-	for (int& AntPos : AntPositions)
+	FAutomataSnapshot Snapshot;
+	if (!Snapshot.ReadFromFile(Path))
+	{
+		return false;
+	}
+
+	if (Snapshot.Kind != ESnapshotKind::Ant || Snapshot.CurrentStates.Num() != BaseMembers.Neighborhoods.Num() || Snapshot.NumStates != NumColors)
+	{
+		UE_LOG(LogAutomata, Error, TEXT("Snapshot %s does not match this grid and cell sequence"), *Path);
+		return false;
+	}
+
+	int NumAntStates = Transitions.Num() / NumColors;
+	if (Snapshot.NumAntStates != 0 && Snapshot.NumAntStates != NumAntStates)
+	{
+		UE_LOG(LogAutomata, Error, TEXT("Snapshot %s was taken with a %d state turmite, this one has %d"), *Path, Snapshot.NumAntStates, NumAntStates);
+		return false;
+	}
+
+	// colors and ant states index the transition table, orientations the neighbor table or cardinal offsets
+	for (int State : Snapshot.CurrentStates)
+	{
+		if (State < 0 || State >= NumColors)
+		{
+			UE_LOG(LogAutomata, Error, TEXT("Snapshot %s has a cell color outside of this rule's %d"), *Path, NumColors);
+			return false;
+		}
+	}
+
+	for (int AntID = 0; AntID < Snapshot.AntPositions.Num(); ++AntID)
 	{
-		AntPos = FMath::RandRange(0, BaseMembers.Neighborhoods.Num() - 1);
+		int AntPos = Snapshot.AntPositions[AntID];
+		if (!BaseMembers.Neighborhoods.IsValidIndex(AntPos))
+		{
+			UE_LOG(LogAutomata, Error, TEXT("Snapshot %s places an ant outside the grid"), *Path);
+			return false;
+		}
+
+		int NumOrientations = bInlineNeighbors ? 4 : NeighborCounts[AntPos];
+		int Orientation = Snapshot.AntOrientations[AntID];
+		int AntState = Snapshot.AntStates.IsValidIndex(AntID) ? Snapshot.AntStates[AntID] : 0;
+		if (Orientation < 0 || Orientation >= NumOrientations || AntState < 0 || AntState >= NumAntStates)
+		{
+			UE_LOG(LogAutomata, Error, TEXT("Snapshot %s has an ant facing or in a state this grid and turmite don't have"), *Path);
+			return false;
+		}
 	}
 
-	AntOrientations.Init(0, NumAnts);
-	for (int& AntOr : AntOrientations)
+	BaseMembers.NextStep = Snapshot.NextStep;
+	BaseMembers.CurrentStates = MoveTemp(Snapshot.CurrentStates);
+	BaseMembers.SwitchStepBuffer = MoveTemp(Snapshot.SwitchStepBuffer);
+	int NumAnts = Snapshot.AntPositions.Num();
+	Ants.SetNumUninitialized(NumAnts);
+	ChangedCells.SetNumUninitialized(NumAnts);
+	for (int AntID = 0; AntID < NumAnts; ++AntID)
 	{
-		AntOr = FMath::RandRange(0, BaseMembers.Neighborhoods[0].Num() - 1);
+		PlaceAnt(Ants[AntID], Snapshot.AntPositions[AntID]);
+		Ants[AntID].Orientation = uint16(Snapshot.AntOrientations[AntID]);
+		// snapshots from before turmites have no ant states
+		Ants[AntID].State = Snapshot.AntStates.IsValidIndex(AntID) ? uint16(Snapshot.AntStates[AntID]) : 0;
 	}
+
+	SyncCellPlane();
+	bChangesKnown = false;
+
+	return true;
 }
 
-void UAntRule::InitializeSequence(TArray<int> Seq)
+bool UAntRule::LoadPattern(const FString& Path, const FBasicGrid& Grid, FIntPoint Offset)
 {
-	CellSequence = Seq;
+	BaseMembers.CurrentStates.Init(0, BaseMembers.Neighborhoods.Num());
+	if (!AutomataPatterns::LoadPattern(Path, Grid, Offset, BaseMembers.CurrentStates))
+	{
+		return false;
+	}
+
+	int NumStates = NumColors;
+	for (int& State : BaseMembers.CurrentStates)
+	{
+		State %= NumStates;
+	}
+
+	SyncCellPlane();
+	bChangesKnown = false;
+
+	return true;
 }
 
 void UAntRule::StepComplete()
 {
 	AsyncState.Wait();
+
+	// the move only wrote the byte plane, the shared buffers are caught up here for the cells the ants left
+	for (int CellID : ChangedCells)
+	{
+		BaseMembers.CurrentStates[CellID] = CellPlane[CellID];
+		BaseMembers.SwitchStepBuffer[CellID] = BaseMembers.NextStep;
+	}
+
 	BaseMembers.NextStep++;
+	bChangesKnown = true;
 }
 
 void UAntRule::BroadcastData()
@@ -186,27 +1582,241 @@ void UAntRule::StartNewStep()
 }
 
 
-static void AutomataFuncs::MakeNeighborsOf(TArray<TArray<int>>& NeighborsOf, TArray<TArray<int>>& Neighborhoods)
+void USparseLifeRule::BeginDestroy()
+{
+	Super::BeginDestroy();
+
+	// the step in flight writes the plane
+	if (AsyncState.IsValid())
+	{
+		AsyncState.Wait();
+	}
+}
+
+void USparseLifeRule::SetBaseMembers(FBaseAutomataStruct NewBaseMembers)
+{
+	// the window comes from SetWindow, and neighborhoods are implied by the plane
+	BaseMembers = MoveTemp(NewBaseMembers);
+	BaseMembers.Neighborhoods.Empty();
+}
+
+void USparseLifeRule::SetWindow(const FBasicGrid& Grid, FIntPoint Origin)
+{
+	NumXCells = Grid.NumXCells;
+	NumZCells = Grid.NumZCells;
+	WindowOrigin = Origin;
+
+	BaseMembers.CurrentStates.Init(0, NumXCells * NumZCells);
+	BaseMembers.SwitchStepBuffer.Init(TNumericLimits<int32>::Min(), NumXCells * NumZCells);
+	RefreshWindow();
+}
+
+void USparseLifeRule::SetWindowOrigin(FIntPoint Origin)
+{
+	WindowOrigin = Origin;
+	RefreshWindow();
+}
+
+void USparseLifeRule::RefreshWindow()
+{
+	Life.ReadWindow(WindowOrigin, NumXCells, NumZCells, BaseMembers.CurrentStates);
+
+	// cells scrolled into view have no history, so they show as having always been in their state
+	for (int CellID = 0; CellID < BaseMembers.CurrentStates.Num(); ++CellID)
+	{
+		BaseMembers.SwitchStepBuffer[CellID] =	BaseMembers.CurrentStates[CellID] ?
+												TNumericLimits<float>::Max() :
+												TNumericLimits<int32>::Min();
+	}
+
+	bChangesKnown = false;
+}
+
+void USparseLifeRule::InitializeCellRules(FString BirthString, FString SurviveString)
+{
+	TArray<bool> BirthRules = AutomataFuncs::StringToRule(BirthString);
+	if (BirthRules[0])
+	{
+		UE_LOG(LogAutomata, Warning, TEXT("Birth on 0 neighbors would fill the unbounded plane, and is ignored"));
+	}
+
+	if (AutomataHensel::IsNonTotalistic(BirthString) || AutomataHensel::IsNonTotalistic(SurviveString))
+	{
+		UE_LOG(LogAutomata, Warning, TEXT("The unbounded plane only steps outer totalistic rules, so the letters in B%s/S%s are ignored"), *BirthString, *SurviveString);
+	}
+
+	Life.SetRules(BirthRules, AutomataFuncs::StringToRule(SurviveString));
+}
+
+void USparseLifeRule::InitializeCellStates(float Probability, int32 Seed)
+{
+	TArray<uint64> Words;
+	TArray<int> States;
+	AutomataRandom::FillBernoulli(uint32(Seed), AutomataRandom::CellStates, Probability, NumXCells * NumZCells, Words);
+	AutomataPacking::UnpackStates(Words.GetData(), NumXCells * NumZCells, 1, States);
+
+	Life.WriteWindow(WindowOrigin, NumXCells, NumZCells, States);
+	RefreshWindow();
+}
+
+bool USparseLifeRule::LoadPattern(const FString& Path, const FBasicGrid& Grid, FIntPoint Offset)
+{
+	// Runs go straight into the plane's chunks, so a pattern larger than the window keeps the cells outside it.
+	// A malformed pattern may have handed over some runs before failing, so they're only applied once it's parsed
+	TArray<TPair<FIntPoint, int>> Runs;
+
+	FIntPoint Origin = WindowOrigin + Offset;
+	bool bLoaded = AutomataPatterns::LoadPatternRuns(Path, Origin, [&Runs](int64 X, int64 Z, int64 Count, int State)
+	{
+		// the plane's coordinates are ints, and runs reaching past them are cut short
+		int64 First = FMath::Max<int64>(X, MIN_int32);
+		int64 Last = FMath::Min<int64>(X + Count, MAX_int32);
+		if (Z >= MIN_int32 && Z <= MAX_int32 && First < Last)
+		{
+			Runs.Emplace(FIntPoint(int32(First), int32(Z)), int32(FMath::Min<int64>(Last - First, MAX_int32)));
+		}
+	});
+
+	if (!bLoaded)
+	{
+		return false;
+	}
+
+	Life.Clear();
+	for (const TPair<FIntPoint, int>& Run : Runs)
+	{
+		Life.SetRun(Run.Key, Run.Value);
+	}
+	RefreshWindow();
+
+	return true;
+}
+
+bool USparseLifeRule::Reconfigure(const FGridChange& Change)
+{
+	if (Change.Grid->Shape != CellShape::Square)
+	{
+		return false;
+	}
+
+	SetWindow(*Change.Grid, WindowOrigin);
+	return true;
+}
+
+void USparseLifeRule::StepComplete()
+{
+	AsyncState.Wait();
+
+	// a changed cell of a two-state board has flipped
+	for (int CellID : ChangedCells)
+	{
+		int& State = BaseMembers.CurrentStates[CellID];
+		State = !State;
+		BaseMembers.SwitchStepBuffer[CellID] = State ? TNumericLimits<float>::Max() : BaseMembers.NextStep;
+	}
+
+	BaseMembers.NextStep++;
+	bChangesKnown = true;
+}
+
+void USparseLifeRule::BroadcastData()
+{
+	BaseMembers.Display->UpdateSwitchTimes(BaseMembers.SwitchStepBuffer);
+}
+
+void USparseLifeRule::StartNewStep()
+{
+	// the window only moves between steps, so its changes are picked out of the stepped chunks here too
+	AsyncState = Async(EAsyncExecution::TaskGraph, [this]()
+	{
+		Life.Step();
+		Life.ReadWindowChanges(WindowOrigin, NumXCells, NumZCells, ChangedCells);
+	});
+}
+
+static void AutomataFuncs::MakeNeighborsOf(const TArray<TArray<int>>& Neighborhoods, TArray<int>& OutCounts, TArray<int>& OutCells, int& OutStride)
 {
-	TArray<int> MemoryDummy;
-	NeighborsOf.Init(MemoryDummy, Neighborhoods.Num());
+	int NumCells = Neighborhoods.Num();
+
+	// a neighbor repeated within a neighborhood, as on tiny wrapped grids, is only counted once
+	auto IsFirstOccurrence = [](const TArray<int>& Neighborhood, int Index)
+	{
+		for (int Earlier = 0; Earlier < Index; ++Earlier)
+		{
+			if (Neighborhood[Earlier] == Neighborhood[Index])
+			{
+				return false;
+			}
+		}
+		return true;
+	};
+
+	OutCounts.Init(0, NumCells);
+	for (int i = 0; i < NumCells; ++i)
+	{
+		for (int Index = 0; Index < Neighborhoods[i].Num(); ++Index)
+		{
+			if (IsFirstOccurrence(Neighborhoods[i], Index))
+			{
+				++OutCounts[Neighborhoods[i][Index]];
+			}
+		}
+	}
 
-	TSet<int> SetDummy;
-	TArray<TSet<int>> DupeGuard;
-	DupeGuard.Init(SetDummy, NeighborsOf.Num());
+	OutStride = 1;
+	for (int Count : OutCounts)
+	{
+		OutStride = FMath::Max(OutStride, Count);
+	}
 
-	for (int i = 0; i < NeighborsOf.Num(); ++i)
+	// each cell's list comes out in ascending order
+	OutCells.SetNumUninitialized(NumCells * OutStride);
+	OutCounts.Init(0, NumCells);
+	for (int i = 0; i < NumCells; ++i)
 	{
-		for (int Neighbor : Neighborhoods[i])
+		for (int Index = 0; Index < Neighborhoods[i].Num(); ++Index)
 		{
-			DupeGuard[Neighbor].Add(i);
+			if (IsFirstOccurrence(Neighborhoods[i], Index))
+			{
+				int Neighbor = Neighborhoods[i][Index];
+				OutCells[Neighbor * OutStride + OutCounts[Neighbor]++] = i;
+			}
 		}
 	}
+}
+
+bool AutomataFuncs::AreNeighborhoodsSymmetric(const TArray<TArray<int>>& Neighborhoods)
+{
+	TAtomic<bool> bSymmetric(true);
+
+	ParallelFor(Neighborhoods.Num(), [&](int32 CellID)
+	{
+		for (int Neighbor : Neighborhoods[CellID])
+		{
+			if (!Neighborhoods[Neighbor].Contains(CellID))
+			{
+				bSymmetric = false;
+				return;
+			}
+		}
+	});
+
+	return bSymmetric;
+}
 
-	for (int i = 0; i < NeighborsOf.Num(); ++i)
+bool AutomataFuncs::AreNeighborhoodsSymmetric(const TArray<TArray<int>>& Neighborhoods, const TArray<int>& Cells)
+{
+	for (int CellID : Cells)
 	{
-		NeighborsOf[i] = DupeGuard[i].Array();
+		for (int Neighbor : Neighborhoods[CellID])
+		{
+			if (!Neighborhoods[Neighbor].Contains(CellID))
+			{
+				return false;
+			}
+		}
 	}
+	return true;
 }
 
 TArray<bool> AutomataFuncs::StringToRule(FString RuleDigits)
@@ -1,9 +1,24 @@
 #pragma once
 
 #include "AutomataInterface.h"
+#include "AutomataArena.h"
+#include "AutomataWorkerPool.h"
+#include "GridRules.h"
+#include "SparseLife.h"
 #include "Rulesets.generated.h"
 
+struct FAutomataSnapshot;
 
+UENUM()
+enum class ECycleResponse : uint8
+{
+	// cycles aren't looked for
+	Continue,
+	// stop stepping once the board repeats
+	Pause,
+	// keep stepping by replaying the changes of the cycle, without evaluating any rules
+	Replay
+};
 
 UCLASS()
 class ULifelikeRule : public UObject, public IAutomata
@@ -17,44 +32,262 @@ class ULifelikeRule : public UObject, public IAutomata
 	//Set that stores the survival rules for the automata
 	TArray<bool> SurviveRules;
 
+	// Ping-pongs with CurrentStates: each step writes here, and the two swap once it completes.
+	// Matches CurrentStates on every cell not flagged for evaluation
 	TArray<int> NextStates;
 
-	// Flags for each cell, describing whether they require evaluation
-	TArray<bool> EvalFlaggedThisStep;
-	TArray<bool> EvalFlaggedLastStep;
+	// holds the flags and NeighborsOf, which keep their size for as long as the grid does
+	FAutomataArena Arena;
+
+	// Flags for each cell, describing whether they require evaluation. Swapped each step like the states
+	TArrayView<bool> EvalFlaggedThisStep;
+	TArrayView<bool> EvalFlaggedLastStep;
+
+	// For each cell, the NeighborsOfCounts[CellID] cells that have it as a neighbor, from NeighborsOfCells[CellID * NeighborsOfStride].
+	// Only different from Neighborhoods in asymmetric neighborhoods. A fixed stride lets an edge rule change patch lists in place
+	TArrayView<int> NeighborsOfCounts;
+	TArrayView<int> NeighborsOfCells;
+	int NeighborsOfStride = 0;
+
+	// Set when every cell is a neighbor of each of its neighbors, as with Moore and axial neighborhoods under most edge rules.
+	// Neighborhoods then stand in for NeighborsOf, which is left empty
+	bool bSymmetricNeighborhoods = false;
+
+	// persistent threads that calculate the next step asynchronously, one block of cells per task
+	TUniquePtr<FAutomataWorkerPool> Pool;
+
+	// cells are placed in blocks, each first touched by the worker that steps it
+	static constexpr int BlockSize = 4096;
+
+	// Cells stepped per task, each task keeping its own share of the per-step results.
+	// BlockSize, or the whole row pairs that come closest to it under the block lookup
+	int TaskSize = BlockSize;
 
-	// for each cell, describes the cells that have it as a neighbor
-	// only different from Neighborhoods in asymmetric neighborhoods
-	TArray<TArray<int>> NeighborsOf;
+	// Next state of a cell for each 3x3 window around it, laid out as in AutomataHensel
+	TArray<bool> Transitions;
 
-	// responsible for calculating the next step asynchronously
-	TFuture<void> AsyncState;
+	// Set if the rules are written in Hensel notation, so a cell's next state depends on where its live neighbors are.
+	// Only honored under the block lookup, the count alone decides otherwise
+	bool bIsotropic = false;
+
+	// Next states of a 2x2 block of cells, indexed by the 4x4 window around it with bit (Column * 4 + Row) set per live cell.
+	// Output bits are the top-left, top-right, bottom-left and bottom-right cells. Built from Transitions, so any rule steps through it
+	TArray<uint8> BlockTable;
+
+	// set on square Moore grids of at least 4x4, whose interior cells are stepped a 2x2 block per lookup
+	bool bBlockLookup = false;
+	int NumXCells = 0;
+	int NumZCells = 0;
+
+	// Under the block lookup, the states as bytes with a ring of ghost cells around the grid, plus a column and row
+	// of padding on odd sizes so every 2x2 block is whole. Ping-pongs like NextStates, and the ghosts copy
+	// the cells the edge rule puts there after every step, so edge cells read their neighbors like any other
+	TArray<uint8> PaddedStates;
+	TArray<uint8> PaddedNextStates;
+	int PaddedStride = 0;
+
+	// padded index of each ghost the edge rule puts a cell behind, and of that cell. Ghosts it drops stay dead
+	TArray<int> GhostCells;
+	TArray<int> GhostSources;
+
+	// Under the block lookup, border cells whose edge rule lands several offsets on one neighbor, stepped per cell instead.
+	// Split by the task that steps them
+	TArray<int> FoldedCells;
+	TArray<TArray<int>> TaskFoldedCells;
+
+	// longest period that can be detected
+	static constexpr int MaxCyclePeriod = 1024;
+
+	enum class ECycleState : uint8
+	{
+		Searching,
+		// the cycle's period is known, and its changes are being recorded
+		Capturing,
+		// no more rules are evaluated
+		Settled
+	};
+
+	ECycleResponse CycleResponse = ECycleResponse::Continue;
+	ECycleState CycleState = ECycleState::Searching;
+
+	// Zobrist hash of CurrentStates, updated only from the cells that changed each step
+	uint64 StateHash = 0;
+	TArray<uint64> BlockHashDeltas;
+
+	// hashes of the last MaxCyclePeriod steps, and the step each was seen on
+	TArray<uint64> RecentHashes;
+	TMap<uint64, int> HashSteps;
+	int OldestHash = 0;
+
+	int CyclePeriod = 0;
+	int CyclePhase = 0;
+
+	// cells that changed during the last step, gathered per block while evaluating
+	TArray<int> ChangedCells;
+	TArray<TArray<int>> BlockChanges;
+	bool bChangesKnown = false;
+
+	// Steps whose changes aren't in SwitchStepBuffer yet: their cells back to back, where each step's cells start,
+	// and the switch step each was taken on. Only written out when something reads the switch steps
+	TArray<int> PendingSwitchCells;
+	TArray<int> PendingSwitchOffsets;
+	TArray<float> PendingSwitchSteps;
+
+	static constexpr int MaxPendingSwitchSteps = 1024;
+
+	// A snapshot is handed SwitchStepBuffer outright, and a task copies it back for the rule off the game thread.
+	// Nothing writes the buffer between catch ups, so only catching up waits for the copy.
+	// Until then, a broadcast with nothing pending sends the snapshot's buffer instead
+	TSharedPtr<const FAutomataSnapshot> HandedSnapshot;
+	TFuture<void> SwitchStepsReturned;
+
+	// waits for the switch steps handed to a snapshot to be copied back
+	void ReclaimSwitchSteps();
+
+	// cells that change on each step of the cycle
+	TArray<TArray<int>> CycleChanges;
+
+	// every cell that changes during the cycle, and the phases it changes on
+	TArray<int> CycleCells;
+	TArray<int> CyclePhaseOffsets;
+	TArray<int> CyclePhases;
+
+	// returns whether the cell changed
+	bool PostStateChange(int CellID);
+
+	// sets a flagged cell's next state and clears its flag. Nothing happens to an unflagged cell
+	void CommitCell(int CellID, int State, int32 TaskID, uint64& HashDelta);
+
+	// counts a flagged cell's neighbors through its neighborhood, and commits the result
+	void EvaluateCell(int CellID, int32 TaskID, uint64& HashDelta);
+
+	void ApplyCellBlock(int32 TaskID);
 
+	// steps a task's row pairs through BlockTable, reading the padded states
+	void ApplyLookupBlock(int32 TaskID);
 
-	void PostStateChange(int CellID);
+	// copies every cell into both padded buffers, and refreshes the ghosts
+	void FillPaddedStates();
 
-	void ApplyCellRules();
+	void RefreshGhosts();
+
+	void MakeBlockTable();
+
+	// sizes the per-task results for the current stepping mode
+	void SetupTasks();
 
 	void TimestepPropertyShift();
 
 	int GetCellAliveNeighbors(int CellID) const;
 
+	// rehashes the whole board, and forgets any cycle found on the old states
+	void ResetCycleDetection();
+
+	// forgets any cycle found so far, keeping the hash of the current states
+	void ForgetCycles();
+
+	// reallocates the per-cell buffers with each block first touched by the worker that steps it
+	void PlaceBuffers();
+
+	// Builds a new arena from these contents the same way, and releases the old one.
+	// Empty Counts leave NeighborsOf out, for symmetric neighborhoods
+	void PlaceArena(TArrayView<const int> Counts, TArrayView<const int> Cells, int Stride, TArrayView<const bool> ThisStepFlags, TArrayView<const bool> LastStepFlags);
+
+	// Moves the border cells' entries in NeighborsOf over to their rebuilt neighborhoods.
+	// False if a list outgrew the stride, leaving NeighborsOf to be rebuilt whole
+	bool PatchNeighborsOf(const FNeighborhoodMaker& Maker, int Reach, const TArray<int>& BorderCells);
+
+	void UpdateCycleDetection();
+
+	// Queues ChangedCells as switched on Step, skipping steps that changed nothing.
+	// Catches up once the queue holds as many entries as there are cells, or MaxPendingSwitchSteps steps
+	void QueueSwitchSteps(float Step);
+
+	void SettleCycle();
+
+	void ReplayCycleStep();
+
 	// many arrays depend on the number of cells,
 	// which is described by the Neighborhood array
 	void PostNeighborhoodSetup();
 
 	public:
 
-	void InitializeCellStates(float Probability);
+	void BeginDestroy() override;
+
+	// identical for a given seed regardless of thread count
+	void InitializeCellStates(float Probability, int32 Seed);
+
+	// Birth and survival counts, each optionally followed by Hensel letters, e.g. "2n3" and "23-q"
 	void InitializeCellRules(FString BirthString, FString SurviveString);
+
+	// Lets the interior of a square grid with Moore neighborhoods step through the block lookup, and isotropic rules apply.
+	// Only between steps. Neighborhoods of any other kind are found and left on the per-cell path.
+	// bStatesKept says the cells and their states are as they were at the last call, so only the ghost ring is redone
+	void SetGrid(const FBasicGrid& Grid, BoundGridRuleset Rule, bool bStatesKept = false);
+
+	// Replaces the worker pool, only between steps. NumThreads counts the calling thread, and 0 picks one per core.
+	// Pinned workers are spread over NUMA nodes. The grid is re-placed so each node holds the rows it steps,
+	// unless bPlaceBuffers is false, when the calling thread touches every page instead, as a baseline for placement
+	void SetWorkerThreads(int NumThreads, bool bPinThreads, bool bPlaceBuffers = true);
+
+	void SetCycleResponse(ECycleResponse Response);
+
+	// whether a cycle was found and rules are no longer evaluated
+	bool IsSettled() const { return CycleState == ECycleState::Settled; }
+
+	// Jumps a replaying cycle forward without stepping through it.
+	// Each cell's state and switch step follow from the phases it changes on.
+	void AdvanceCycle(int Steps);
 	
 	void SetBaseMembers(FBaseAutomataStruct NewBaseMembers) override;
 
+	void SaveSnapshot(const FString& Path, bool bCompress) override;
+	bool LoadSnapshot(const FString& Path) override;
+
+	bool LoadPattern(const FString& Path, const FBasicGrid& Grid, FIntPoint Offset) override;
+
+	// An edge rule change only rebuilds the border's neighborhoods and patches their NeighborsOf entries.
+	// A resize rebuilds the neighborhoods, and copies states across row by row
+	bool Reconfigure(const FGridChange& Change) override;
+
+	const FBaseAutomataStruct* GetBaseMembers() const override { return &BaseMembers; }
+	const TArray<int>* GetChangedCells() const override { return bChangesKnown ? &ChangedCells : nullptr; }
+
+	// Steps only log which cells changed, and switch steps are worked out from the log here.
+	// Broadcasting and snapshots call it themselves
+	void CatchUpSwitchSteps() override;
+
 	void StepComplete() override;
 	void BroadcastData() override;
 	void StartNewStep() override;
 };
 
+// One entry of a turmite's transition table: what an ant in AntState does on a cell of Color
+USTRUCT(Blueprintable)
+struct FTurmiteTransition
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Blueprintable, EditAnywhere)
+		int AntState = 0;
+
+	UPROPERTY(Blueprintable, EditAnywhere)
+		int Color = 0;
+
+	// color the cell is left as
+	UPROPERTY(Blueprintable, EditAnywhere)
+		int WriteColor = 1;
+
+	// number of neighbors to rotate by, e.g. 1 is a right turn on a square grid and -1 a left
+	UPROPERTY(Blueprintable, EditAnywhere)
+		int Turn = 1;
+
+	// the ant's state after the move
+	UPROPERTY(Blueprintable, EditAnywhere)
+		int NextState = 0;
+};
+
 UCLASS()
 class UAntRule : public UObject, public IAutomata
 {
@@ -62,36 +295,168 @@ class UAntRule : public UObject, public IAutomata
 
 	FBaseAutomataStruct BaseMembers;
 
-	// Ruleset that determines the tile's effect on the ant, e.g. {right, left} would be {1, -1}, or {1,3}
-	TArray<int> CellSequence = { 1, -1 };
-
-	// for each ant, describes its orientation: which neighbor it will move to to change its position
-	TArray<int> AntOrientations = { 0 };
-
-	// describes each ant's position, used to query cell states and neighborhoods
-	TArray<int> AntPositions = { 0 };
+	// everything a move needs about one ant, so each ant touches a single record
+	struct FAnt
+	{
+		int32 Cell;
+		// grid coordinate, used on the inline path
+		int32 X;
+		int32 Z;
+		// which neighbor the ant will move to
+		uint16 Orientation;
+		// internal turmite state
+		uint16 State;
+	};
+
+	TArray<FAnt> Ants = { {0, 0, 0, 0, 0} };
+
+	// cell states as bytes, which is all a move reads and writes.
+	// CurrentStates and SwitchStepBuffer are caught up from ChangedCells once the step completes
+	TArray<uint8> CellPlane;
+
+	// a transition table entry, packed into one word so a move is a single load with no branching on the rule
+	struct FPackedTransition
+	{
+		uint8 WriteColor;
+		uint8 NextState;
+		// turn reduced to a non-negative count of quarter turns, for the inline square path
+		uint8 QuarterTurn;
+		int8 Turn;
+	};
+
+	// indexed by AntState * NumColors + Color. Defaults to Langton's ant
+	TArray<FPackedTransition> Transitions = { {1, 0, 1, 1}, {0, 0, 3, -1} };
+	int NumColors = 2;
+
+	// Neighborhoods flattened to a fixed stride, with the count of each cell's real entries
+	TArray<int> NeighborTable;
+	TArray<uint8> NeighborCounts;
+	int NeighborStride = 1;
+
+	// On square tori a neighbor is computed from the ant's coordinate, so no table is read at all
+	bool bInlineNeighbors = false;
+	int NumXCells = 0;
+	int NumZCells = 0;
 
 	// responsible for calculating the next step asynchronously
 	TFuture<void> AsyncState;
 
+	// cells the ants left during the last step, one per ant
+	TArray<int> ChangedCells = { 0 };
+	bool bChangesKnown = false;
+
+	void MoveAntsInline();
+	void MoveAntsTable();
+
+	void PlaceAnt(FAnt& Ant, int Cell) const;
+
+	// rebuilds CellPlane after CurrentStates is replaced
+	void SyncCellPlane();
+
 	void MoveAnts();
 
 public:
 
 	void SetBaseMembers(FBaseAutomataStruct NewBaseMembers) override;
 
-	void InitializeAnts(int NumAnts);
+	// lets neighbors be computed inline when the grid allows it
+	void SetGrid(const FBasicGrid& Grid, BoundGridRuleset GridRule);
+
+	void InitializeAnts(int NumAnts, int32 Seed);
 
+	// Cells cycle through the sequence's colors, and an ant on color n turns by Seq[n],
+	// e.g. {right, left} would be {1, -1}, or {1,3}
 	void InitializeSequence(TArray<int> Seq);
 
+	// General turmite. States and colors not covered by the table leave the cell and ant unchanged and don't turn
+	void InitializeTurmite(const TArray<FTurmiteTransition>& Table);
+
+	void SaveSnapshot(const FString& Path, bool bCompress) override;
+	bool LoadSnapshot(const FString& Path) override;
+
+	bool LoadPattern(const FString& Path, const FBasicGrid& Grid, FIntPoint Offset) override;
+
+	const FBaseAutomataStruct* GetBaseMembers() const override { return &BaseMembers; }
+	int GetNumStates() const override { return NumColors; }
+	bool BroadcastsStates() const override { return true; }
+	const TArray<int>* GetChangedCells() const override { return bChangesKnown ? &ChangedCells : nullptr; }
+
 	void StepComplete() override;
 	void BroadcastData() override;
 	void StartNewStep() override;
 
 };
 
+// Lifelike rules on the unbounded plane of FSparseLife, shown through a movable window of the grid's size.
+// Stepping only touches live chunks, so patterns grow for as long as memory lasts instead of meeting an edge.
+// Only two-state Moore rules are supported
+UCLASS()
+class USparseLifeRule : public UObject, public IAutomata
+{
+	GENERATED_BODY()
+
+	// the window's cells, laid out as a grid of its size
+	FBaseAutomataStruct BaseMembers;
+
+	FSparseLife Life;
+
+	FIntPoint WindowOrigin = FIntPoint(0, 0);
+	int NumXCells = 0;
+	int NumZCells = 0;
+
+	// responsible for calculating the next step asynchronously
+	TFuture<void> AsyncState;
+
+	// window cells that changed during the last step, picked out of the stepped chunks by the step's task
+	TArray<int> ChangedCells;
+	bool bChangesKnown = false;
+
+	// rereads the window from the plane, e.g. after it moved
+	void RefreshWindow();
+
+public:
+
+	void BeginDestroy() override;
+
+	// sizes the window to the grid, and places its first cell at Origin
+	void SetWindow(const FBasicGrid& Grid, FIntPoint Origin);
+
+	// pans the window without changing any cells. Only valid between steps
+	void SetWindowOrigin(FIntPoint Origin);
+
+	void InitializeCellRules(FString BirthString, FString SurviveString);
+
+	// fills the window with the same random cells ULifelikeRule would give a grid of its size
+	void InitializeCellStates(float Probability, int32 Seed);
+
+	int GetNumChunks() const { return Life.GetNumChunks(); }
+
+	void SetBaseMembers(FBaseAutomataStruct NewBaseMembers) override;
+
+	// Replaces the plane with the pattern, placed at Offset from the window's first cell.
+	// Cells beyond the window are kept, and scroll into view as it moves
+	bool LoadPattern(const FString& Path, const FBasicGrid& Grid, FIntPoint Offset) override;
+
+	// Edge rules don't apply to the plane, so only a resize does anything: the window takes the new size
+	bool Reconfigure(const FGridChange& Change) override;
+
+	const FBaseAutomataStruct* GetBaseMembers() const override { return &BaseMembers; }
+	const TArray<int>* GetChangedCells() const override { return bChangesKnown ? &ChangedCells : nullptr; }
+
+	void StepComplete() override;
+	void BroadcastData() override;
+	void StartNewStep() override;
+};
+
 namespace AutomataFuncs {
-	static void MakeNeighborsOf(TArray<TArray<int>>& NeighborsOf, TArray<TArray<int>>& Neighborhoods);
+	// the transposed neighborhood graph, in the fixed stride layout ULifelikeRule keeps it in
+	static void MakeNeighborsOf(const TArray<TArray<int>>& Neighborhoods, TArray<int>& OutCounts, TArray<int>& OutCells, int& OutStride);
+
+	// whether each cell appears in the neighborhood of every one of its neighbors, making the graph its own transpose
+	bool AreNeighborhoodsSymmetric(const TArray<TArray<int>>& Neighborhoods);
+
+	// the same, only for pairs with one of Cells in them that the cell lists
+	bool AreNeighborhoodsSymmetric(const TArray<TArray<int>>& Neighborhoods, const TArray<int>& Cells);
 
-	static TArray<bool> StringToRule(FString RuleDigits);
+	TArray<bool> StringToRule(FString RuleDigits);
 }
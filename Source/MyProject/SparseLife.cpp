@@ -0,0 +1,291 @@
+#include "SparseLife.h"
+
+#include "LifeLanes.h"
+
+constexpr int FSparseLife::ChunkBits;
+constexpr int FSparseLife::ChunkSize;
+
+namespace
+{
+	const FSparseLife::FChunk EmptyChunk = {};
+}
+
+void FSparseLife::SetRules(const TArray<bool>& BirthRules, const TArray<bool>& SurviveRules)
+{
+	BirthMask = LifeLanes::RuleMask(BirthRules) & ~1u;
+	SurviveMask = LifeLanes::RuleMask(SurviveRules);
+}
+
+void FSparseLife::Clear()
+{
+	Chunks.Empty();
+	ChangedKeys.Reset();
+	ChangedBits.Reset();
+}
+
+bool FSparseLife::GetCell(FIntPoint Coord) const
+{
+	const FChunk* Chunk = Chunks.Find(ChunkOf(Coord));
+	return Chunk != nullptr && ((Chunk->Rows[Coord.Y & (ChunkSize - 1)] >> (Coord.X & (ChunkSize - 1))) & 1);
+}
+
+void FSparseLife::SetCell(FIntPoint Coord, bool bAlive)
+{
+	uint64 Bit = uint64(1) << (Coord.X & (ChunkSize - 1));
+	int Row = Coord.Y & (ChunkSize - 1);
+
+	if (bAlive)
+	{
+		FChunk* Chunk = Chunks.Find(ChunkOf(Coord));
+		if (Chunk == nullptr)
+		{
+			Chunk = &Chunks.Add(ChunkOf(Coord), EmptyChunk);
+		}
+		Chunk->Rows[Row] |= Bit;
+	}
+	else if (FChunk* Chunk = Chunks.Find(ChunkOf(Coord)))
+	{
+		Chunk->Rows[Row] &= ~Bit;
+	}
+}
+
+void FSparseLife::SetRun(FIntPoint Start, int Count)
+{
+	int Row = Start.Y & (ChunkSize - 1);
+
+	for (int X = Start.X, End = Start.X + Count; X < End; )
+	{
+		int Bit = X & (ChunkSize - 1);
+		int Span = FMath::Min(End - X, ChunkSize - Bit);
+		uint64 Mask = (Span == ChunkSize ? ~uint64(0) : (uint64(1) << Span) - 1) << Bit;
+
+		FIntPoint Key = ChunkOf(FIntPoint(X, Start.Y));
+		FChunk* Chunk = Chunks.Find(Key);
+		if (Chunk == nullptr)
+		{
+			Chunk = &Chunks.Add(Key, EmptyChunk);
+		}
+		Chunk->Rows[Row] |= Mask;
+
+		X += Span;
+	}
+}
+
+bool FSparseLife::IsEmpty(const FChunk& Chunk)
+{
+	uint64 Any = 0;
+	for (uint64 Row : Chunk.Rows)
+	{
+		Any |= Row;
+	}
+	return Any == 0;
+}
+
+void FSparseLife::RemoveEmptyChunks()
+{
+	for (auto It = Chunks.CreateIterator(); It; ++It)
+	{
+		if (IsEmpty(It.Value()))
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+void FSparseLife::Step()
+{
+	constexpr uint64 FirstColumn = 1;
+	constexpr uint64 LastColumn = uint64(1) << (ChunkSize - 1);
+
+	// a neighboring chunk only needs stepping if a live cell sits on the edge facing it
+	TSet<FIntPoint> Candidates;
+	Candidates.Reserve(Chunks.Num() * 2);
+
+	for (const TPair<FIntPoint, FChunk>& Pair : Chunks)
+	{
+		const FIntPoint& Key = Pair.Key;
+		const FChunk& Chunk = Pair.Value;
+
+		uint64 Columns = 0;
+		for (uint64 Row : Chunk.Rows)
+		{
+			Columns |= Row;
+		}
+
+		uint64 Top = Chunk.Rows[0];
+		uint64 Bottom = Chunk.Rows[ChunkSize - 1];
+
+		Candidates.Add(Key);
+		if (Top)						Candidates.Add(Key + FIntPoint(0, -1));
+		if (Bottom)						Candidates.Add(Key + FIntPoint(0, 1));
+		if (Columns & FirstColumn)		Candidates.Add(Key + FIntPoint(-1, 0));
+		if (Columns & LastColumn)		Candidates.Add(Key + FIntPoint(1, 0));
+		if (Top & FirstColumn)			Candidates.Add(Key + FIntPoint(-1, -1));
+		if (Top & LastColumn)			Candidates.Add(Key + FIntPoint(1, -1));
+		if (Bottom & FirstColumn)		Candidates.Add(Key + FIntPoint(-1, 1));
+		if (Bottom & LastColumn)		Candidates.Add(Key + FIntPoint(1, 1));
+	}
+
+	TArray<FIntPoint> Keys = Candidates.Array();
+	TArray<FChunk> Results;
+	TArray<FChunk> Changes;
+	Results.SetNumUninitialized(Keys.Num());
+	Changes.SetNumUninitialized(Keys.Num());
+
+	// every chunk reads only the current map, so they all step at once.
+	// Every chunk a cell could change in is a candidate, so the changes are complete
+	ParallelFor(Keys.Num(), [&](int32 Index)
+	{
+		StepChunk(Keys[Index], Results[Index]);
+
+		const FChunk* Old = Chunks.Find(Keys[Index]);
+		for (int Row = 0; Row < ChunkSize; ++Row)
+		{
+			Changes[Index].Rows[Row] = Results[Index].Rows[Row] ^ (Old != nullptr ? Old->Rows[Row] : 0);
+		}
+	});
+
+	TMap<FIntPoint, FChunk> Next;
+	Next.Reserve(Keys.Num());
+	ChangedKeys.Reset();
+	ChangedBits.Reset();
+	for (int Index = 0; Index < Keys.Num(); ++Index)
+	{
+		if (!IsEmpty(Results[Index]))
+		{
+			Next.Add(Keys[Index], Results[Index]);
+		}
+		if (!IsEmpty(Changes[Index]))
+		{
+			ChangedKeys.Add(Keys[Index]);
+			ChangedBits.Add(Changes[Index]);
+		}
+	}
+	Chunks = MoveTemp(Next);
+}
+
+void FSparseLife::ReadWindowChanges(FIntPoint Origin, int NumXCells, int NumZCells, TArray<int>& OutChangedCells) const
+{
+	OutChangedCells.Reset();
+
+	FIntPoint First = ChunkOf(Origin);
+	FIntPoint Last = ChunkOf(Origin + FIntPoint(NumXCells - 1, NumZCells - 1));
+
+	for (int Index = 0; Index < ChangedKeys.Num(); ++Index)
+	{
+		FIntPoint Key = ChangedKeys[Index];
+		if (Key.X < First.X || Key.X > Last.X || Key.Y < First.Y || Key.Y > Last.Y)
+		{
+			continue;
+		}
+
+		int BeginZ = FMath::Max(Key.Y * ChunkSize, Origin.Y);
+		int EndZ = FMath::Min((Key.Y + 1) * ChunkSize, Origin.Y + NumZCells);
+		int BeginX = FMath::Max(Key.X * ChunkSize, Origin.X);
+		int EndX = FMath::Min((Key.X + 1) * ChunkSize, Origin.X + NumXCells);
+
+		for (int z = BeginZ; z < EndZ; ++z)
+		{
+			int WindowRow = (z - Origin.Y) * NumXCells - Origin.X;
+
+			for (uint64 Bits = ChangedBits[Index].Rows[z & (ChunkSize - 1)]; Bits != 0; Bits &= Bits - 1)
+			{
+				int x = Key.X * ChunkSize + int(FMath::CountTrailingZeros64(Bits));
+				if (x >= BeginX && x < EndX)
+				{
+					OutChangedCells.Add(WindowRow + x);
+				}
+			}
+		}
+	}
+}
+
+void FSparseLife::StepChunk(FIntPoint Key, FChunk& OutChunk) const
+{
+	// the chunk and its eight neighbors, [row][column], with missing ones reading as empty
+	const FChunk* Around[3][3];
+	for (int dz = 0; dz < 3; ++dz)
+	{
+		for (int dx = 0; dx < 3; ++dx)
+		{
+			const FChunk* Chunk = Chunks.Find(Key + FIntPoint(dx - 1, dz - 1));
+			Around[dz][dx] = Chunk != nullptr ? Chunk : &EmptyChunk;
+		}
+	}
+
+	// a row's cells alongside each one's west and east neighbor, shifted into the cell's lane
+	auto RowAt = [&](int Row, uint64& Center, uint64& FromWest, uint64& FromEast)
+	{
+		int ChunkRow = Row < 0 ? 0 : (Row >= ChunkSize ? 2 : 1);
+		int Local = Row & (ChunkSize - 1);
+
+		Center = Around[ChunkRow][1]->Rows[Local];
+		FromWest = (Center << 1) | (Around[ChunkRow][0]->Rows[Local] >> (ChunkSize - 1));
+		FromEast = (Center >> 1) | (Around[ChunkRow][2]->Rows[Local] << (ChunkSize - 1));
+	};
+
+	for (int Row = 0; Row < ChunkSize; ++Row)
+	{
+		uint64 Above, AboveWest, AboveEast;
+		uint64 Alive, West, East;
+		uint64 Below, BelowWest, BelowEast;
+		RowAt(Row - 1, Above, AboveWest, AboveEast);
+		RowAt(Row, Alive, West, East);
+		RowAt(Row + 1, Below, BelowWest, BelowEast);
+
+		const uint64 Neighbors[8] = { Above, AboveWest, AboveEast, West, East, Below, BelowWest, BelowEast };
+		OutChunk.Rows[Row] = LifeLanes::Step(Alive, Neighbors, BirthMask, SurviveMask);
+	}
+}
+
+void FSparseLife::ReadWindow(FIntPoint Origin, int NumXCells, int NumZCells, TArray<int>& OutStates) const
+{
+	OutStates.Init(0, NumXCells * NumZCells);
+
+	FIntPoint First = ChunkOf(Origin);
+	FIntPoint Last = ChunkOf(Origin + FIntPoint(NumXCells - 1, NumZCells - 1));
+
+	// walks the chunks covering the window, so empty space costs a lookup per chunk rather than per cell
+	for (int ChunkZ = First.Y; ChunkZ <= Last.Y; ++ChunkZ)
+	{
+		for (int ChunkX = First.X; ChunkX <= Last.X; ++ChunkX)
+		{
+			const FChunk* Chunk = Chunks.Find(FIntPoint(ChunkX, ChunkZ));
+			if (Chunk == nullptr)
+			{
+				continue;
+			}
+
+			int BeginZ = FMath::Max(ChunkZ * ChunkSize, Origin.Y);
+			int EndZ = FMath::Min((ChunkZ + 1) * ChunkSize, Origin.Y + NumZCells);
+			int BeginX = FMath::Max(ChunkX * ChunkSize, Origin.X);
+			int EndX = FMath::Min((ChunkX + 1) * ChunkSize, Origin.X + NumXCells);
+
+			for (int z = BeginZ; z < EndZ; ++z)
+			{
+				int WindowRow = (z - Origin.Y) * NumXCells - Origin.X;
+
+				for (uint64 Bits = Chunk->Rows[z & (ChunkSize - 1)]; Bits != 0; Bits &= Bits - 1)
+				{
+					int x = ChunkX * ChunkSize + int(FMath::CountTrailingZeros64(Bits));
+					if (x >= BeginX && x < EndX)
+					{
+						OutStates[WindowRow + x] = 1;
+					}
+				}
+			}
+		}
+	}
+}
+
+void FSparseLife::WriteWindow(FIntPoint Origin, int NumXCells, int NumZCells, const TArray<int>& States)
+{
+	for (int z = 0; z < NumZCells; ++z)
+	{
+		for (int x = 0; x < NumXCells; ++x)
+		{
+			SetCell(Origin + FIntPoint(x, z), States[z * NumXCells + x] != 0);
+		}
+	}
+	RemoveEmptyChunks();
+}
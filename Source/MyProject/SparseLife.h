@@ -0,0 +1,72 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// An unbounded two-state lifelike board, kept as 64x64 bit-packed chunks keyed by chunk coordinate.
+// A chunk is allocated when a cell in it is born and freed once it empties, so memory and stepping cost
+// follow the live cells rather than any bounds. Cells use the grid's (x, z) coordinates extended to the
+// whole plane, with Moore neighborhoods
+class FSparseLife
+{
+public:
+
+	static constexpr int ChunkBits = 6;
+	static constexpr int ChunkSize = 1 << ChunkBits;
+
+	// row z of the chunk is Rows[z], with cell x in bit x
+	struct FChunk
+	{
+		uint64 Rows[ChunkSize];
+	};
+
+	// Rules are indexed by live neighbor count. Birth on 0 would fill the whole plane, so it's ignored
+	void SetRules(const TArray<bool>& BirthRules, const TArray<bool>& SurviveRules);
+
+	void Clear();
+
+	bool GetCell(FIntPoint Coord) const;
+	void SetCell(FIntPoint Coord, bool bAlive);
+
+	// brings Count cells of a row to life from Start, a chunk row word at a time
+	void SetRun(FIntPoint Start, int Count);
+
+	// Steps every live chunk, and the neighboring chunks its edges could spill into.
+	// Keeps which cells of each stepped chunk changed, for ReadWindowChanges
+	void Step();
+
+	// Window cells the last step changed, laid out as in ReadWindow. Only chunks that were stepped are looked at,
+	// so the cost follows the activity in the window rather than its size
+	void ReadWindowChanges(FIntPoint Origin, int NumXCells, int NumZCells, TArray<int>& OutChangedCells) const;
+
+	// Cells of the rectangle from Origin, with the window cell (x, z) at OutStates[z * NumXCells + x],
+	// so a window lines up with an FBasicGrid of the same size
+	void ReadWindow(FIntPoint Origin, int NumXCells, int NumZCells, TArray<int>& OutStates) const;
+
+	// sets the rectangle from Origin to States, nonzero being alive
+	void WriteWindow(FIntPoint Origin, int NumXCells, int NumZCells, const TArray<int>& States);
+
+	int GetNumChunks() const { return Chunks.Num(); }
+
+private:
+
+	TMap<FIntPoint, FChunk> Chunks;
+
+	// stepped chunks with any cell that changed on the last step, and those cells' bits
+	TArray<FIntPoint> ChangedKeys;
+	TArray<FChunk> ChangedBits;
+
+	// bit k set if the rule applies at k live neighbors
+	uint32 BirthMask = 0;
+	uint32 SurviveMask = 0;
+
+	static FIntPoint ChunkOf(FIntPoint Coord)
+	{
+		return FIntPoint(Coord.X >> ChunkBits, Coord.Y >> ChunkBits);
+	}
+
+	static bool IsEmpty(const FChunk& Chunk);
+
+	void StepChunk(FIntPoint Key, FChunk& OutChunk) const;
+
+	void RemoveEmptyChunks();
+};
@@ -0,0 +1,105 @@
+#include "StatePacking.h"
+
+int AutomataPacking::BitsForStates(int NumStates)
+{
+	int Bits = 1;
+	while (Bits < 32 && (int64(1) << Bits) < NumStates)
+	{
+		Bits *= 2;
+	}
+	return Bits;
+}
+
+int AutomataPacking::CellsPerWord(int BitsPerCell)
+{
+	return 64 / BitsPerCell;
+}
+
+int AutomataPacking::NumWords(int NumCells, int BitsPerCell)
+{
+	int PerWord = CellsPerWord(BitsPerCell);
+	return (NumCells + PerWord - 1) / PerWord;
+}
+
+void AutomataPacking::PackStates(const TArray<int>& States, int BitsPerCell, TArray<uint64>& OutWords)
+{
+	OutWords.SetNumUninitialized(NumWords(States.Num(), BitsPerCell));
+	PackStates(States, BitsPerCell, OutWords.GetData());
+}
+
+void AutomataPacking::PackStates(const TArray<int>& States, int BitsPerCell, uint64* OutWords)
+{
+	int NumCells = States.Num();
+	int PerWord = CellsPerWord(BitsPerCell);
+	uint64 Mask = (uint64(1) << BitsPerCell) - 1;
+
+	// every word is owned by exactly one iteration, so no synchronization is needed
+	ParallelFor(NumWords(NumCells, BitsPerCell), [&](int32 WordID)
+	{
+		int FirstCell = WordID * PerWord;
+		int LastCell = FMath::Min(FirstCell + PerWord, NumCells);
+
+		uint64 Word = 0;
+		for (int CellID = FirstCell; CellID < LastCell; ++CellID)
+		{
+			Word |= (uint64(States[CellID]) & Mask) << ((CellID - FirstCell) * BitsPerCell);
+		}
+		OutWords[WordID] = Word;
+	});
+}
+
+void AutomataPacking::UnpackStates(const uint64* Words, int NumCells, int BitsPerCell, TArray<int>& OutStates)
+{
+	int PerWord = CellsPerWord(BitsPerCell);
+	uint64 Mask = (uint64(1) << BitsPerCell) - 1;
+
+	OutStates.SetNumUninitialized(NumCells);
+
+	ParallelFor(NumWords(NumCells, BitsPerCell), [&](int32 WordID)
+	{
+		int FirstCell = WordID * PerWord;
+		int LastCell = FMath::Min(FirstCell + PerWord, NumCells);
+
+		uint64 Word = Words[WordID];
+		for (int CellID = FirstCell; CellID < LastCell; ++CellID)
+		{
+			OutStates[CellID] = int((Word >> ((CellID - FirstCell) * BitsPerCell)) & Mask);
+		}
+	});
+}
+
+void AutomataPacking::PackFlags(TArrayView<const bool> Flags, TArray<uint64>& OutWords)
+{
+	int NumCells = Flags.Num();
+	OutWords.SetNumUninitialized(NumWords(NumCells, 1));
+
+	ParallelFor(OutWords.Num(), [&](int32 WordID)
+	{
+		int FirstCell = WordID * 64;
+		int LastCell = FMath::Min(FirstCell + 64, NumCells);
+
+		uint64 Word = 0;
+		for (int CellID = FirstCell; CellID < LastCell; ++CellID)
+		{
+			Word |= uint64(Flags[CellID]) << (CellID - FirstCell);
+		}
+		OutWords[WordID] = Word;
+	});
+}
+
+void AutomataPacking::UnpackFlags(const uint64* Words, int NumCells, TArray<bool>& OutFlags)
+{
+	OutFlags.SetNumUninitialized(NumCells);
+
+	ParallelFor(NumWords(NumCells, 1), [&](int32 WordID)
+	{
+		int FirstCell = WordID * 64;
+		int LastCell = FMath::Min(FirstCell + 64, NumCells);
+
+		uint64 Word = Words[WordID];
+		for (int CellID = FirstCell; CellID < LastCell; ++CellID)
+		{
+			OutFlags[CellID] = bool((Word >> (CellID - FirstCell)) & 1);
+		}
+	});
+}
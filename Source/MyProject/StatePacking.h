@@ -0,0 +1,28 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Helpers for storing cell states in as few bits as possible.
+// Cells are packed least-significant bits first, and a cell never straddles two words,
+// so BitsPerCell is always a power of two no larger than 32.
+namespace AutomataPacking
+{
+	// smallest power-of-two number of bits that can represent every state in [0, NumStates)
+	int BitsForStates(int NumStates);
+
+	int CellsPerWord(int BitsPerCell);
+
+	int NumWords(int NumCells, int BitsPerCell);
+
+	void PackStates(const TArray<int>& States, int BitsPerCell, TArray<uint64>& OutWords);
+
+	// writes to a raw pointer, with room for NumWords(States.Num(), BitsPerCell), e.g. straight into shared memory
+	void PackStates(const TArray<int>& States, int BitsPerCell, uint64* OutWords);
+
+	// reads from a raw pointer so that callers can unpack straight out of mapped memory
+	void UnpackStates(const uint64* Words, int NumCells, int BitsPerCell, TArray<int>& OutStates);
+
+	void PackFlags(TArrayView<const bool> Flags, TArray<uint64>& OutWords);
+
+	void UnpackFlags(const uint64* Words, int NumCells, TArray<bool>& OutFlags);
+}